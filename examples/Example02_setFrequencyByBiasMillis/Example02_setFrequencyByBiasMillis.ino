@@ -28,6 +28,10 @@
 
 #include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
 
+#if !SFE_STP3593LF_FLOATING_POINT_LOOP
+#error This example needs the floating-point loop (SFE_STP3593LF_ENABLE_PI_LOOP, not SFE_STP3593LF_FIXED_POINT)
+#endif
+
 SfeSTP3593LFArdI2C myOCXO;
 
 void setup()
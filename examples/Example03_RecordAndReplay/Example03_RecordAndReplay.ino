@@ -0,0 +1,127 @@
+/*
+  Record the inputs to the STP3593LF discipline loop, then replay them.
+
+  This example shows how to capture exactly what setFrequencyByBiasMillis saw,
+  so that a field incident can be reproduced - bit for bit - on the bench.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  In the field you would record to an SD card File:
+    File traceFile = SD.open("/trace.stp", FILE_WRITE);
+    SfeSTP3593LFRecorder myRecorder(traceFile);
+    myOCXO.setRecorder(&myRecorder);
+  and replay it later with SfeSTP3593LFReplay::begin(traceFile).
+
+  To keep this example self-contained, the trace is recorded into a RAM buffer
+  from a driver on the in-memory (mock) bus. Each bias record is 18 bytes,
+  so the buffer below holds ~10 minutes of one-second epochs. Use a board with
+  plenty of RAM (e.g. ESP32).
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_Recorder.h>
+
+#if !SFE_STP3593LF_ENABLE_TELEMETRY
+#error This example needs the telemetry (SFE_STP3593LF_ENABLE_TELEMETRY) and the floating-point loop
+#endif
+
+// A Stream which writes to and reads from a RAM buffer
+class MemoryStream : public Stream
+{
+public:
+  MemoryStream(uint8_t *buffer, size_t size) : _buffer(buffer), _size(size), _head(0), _tail(0) {}
+  size_t write(uint8_t b)
+  {
+    if (_head >= _size)
+      return 0;
+    _buffer[_head++] = b;
+    return 1;
+  }
+  int available() { return _head - _tail; }
+  int read() { return (_tail < _head) ? _buffer[_tail++] : -1; }
+  int peek() { return (_tail < _head) ? _buffer[_tail] : -1; }
+  void rewind() { _tail = 0; }
+
+private:
+  uint8_t *_buffer;
+  size_t _size;
+  size_t _head;
+  size_t _tail;
+};
+
+const size_t traceSize = 12000;
+uint8_t traceBuffer[traceSize];
+MemoryStream trace(traceBuffer, traceSize);
+
+SfeSTP3593LFMock myOCXO; // The driver - on the in-memory bus
+SfeSTP3593LFRecorder myRecorder(trace);
+SfeSTP3593LFReplay myReplay;
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  myOCXO.begin();
+  myOCXO.setMaxFrequencyChangePPB(3.0);
+
+  // Start recording before the first setFrequencyBy... call
+  myOCXO.setRecorder(&myRecorder);
+
+  // Simulate 600 epochs: an oscillator which is 20ppb fast at 500000, with 2ns of bias noise
+  Serial.println("Recording 600 epochs...");
+  double phase = 150.0e-9; // Seconds
+  randomSeed(1);
+  for (int epoch = 0; epoch < 600; epoch++)
+  {
+    phase += 20.0e-9 + (((double)myOCXO.getFrequencyControlWord() - 500000.0) * kSfeSTP3593LFFreqControlResolution);
+    double noise = ((double)random(-1000, 1001)) * 2.0e-12;
+    myOCXO.updateDiscipline((phase + noise) * 1000.0); // Bias in millis
+  }
+
+  myOCXO.setRecorder(nullptr); // Stop recording
+
+  Serial.print("Recorded ");
+  Serial.print(myRecorder.getRecordCount());
+  Serial.print(" records in ");
+  Serial.print(myRecorder.getByteCount());
+  Serial.println(" bytes");
+  Serial.print("Final frequency control word: ");
+  Serial.println(myOCXO.getFrequencyControlWord());
+
+  // Replay the trace - as fast as the CPU allows
+  if (!myReplay.begin(trace))
+  {
+    Serial.println("Trace header is invalid!");
+    while (1); // Do nothing more
+  }
+
+  unsigned long start = micros();
+  uint32_t records = myReplay.run();
+  unsigned long elapsed = micros() - start;
+
+  Serial.print("Replayed ");
+  Serial.print(records);
+  Serial.print(" records in ");
+  Serial.print(elapsed);
+  Serial.println(" us");
+  Serial.print("Final frequency control word: ");
+  Serial.println(myReplay.getFrequencyControlWord());
+  Serial.print("Mismatches: ");
+  Serial.println(myReplay.getMismatchCount()); // Should be zero
+}
+
+void loop()
+{
+  // Nothing to do here
+}
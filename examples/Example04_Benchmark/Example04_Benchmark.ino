@@ -0,0 +1,235 @@
+/*
+  Benchmark the STP3593LF driver against the in-memory bus.
+
+  This example measures the cost of each public driver call - calls per second,
+  CPU cycles per call and I2C bytes per call - with the I2C bus replaced by
+  SfeSTP3593LFMockBus. The timings are the library's own overhead: the real
+  bus time (~100us per byte at 100kHz) comes on top. Run it before and after
+  a library change to catch performance regressions before they reach firmware.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  Cycles are read from the CPU cycle counter on ESP32 and on Cortex-M3/M4/M7 (DWT).
+  On other platforms they are estimated from micros() and F_CPU.
+
+  The second table is the time-to-first-write for each begin mode: begin, then
+  the first loop correction (which reads the word if begin did not). The bus
+  time to the first write is estimated from the bytes on the bus at 100kHz and
+  400kHz (9 bits per byte); the CPU time is measured. Lazy and Probe move the
+  read out of begin - shortening boot - rather than removing it.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+
+#if !SFE_STP3593LF_FLOATING_POINT_LOOP
+#error This example needs the floating-point loop (SFE_STP3593LF_ENABLE_PI_LOOP, not SFE_STP3593LF_FIXED_POINT)
+#endif
+
+SfeSTP3593LFMock myOCXO; // The driver - on the in-memory bus
+
+const uint32_t iterations = 2000;
+
+// The cycle counter
+#if defined(ARDUINO_ARCH_ESP32)
+void cycleCounterBegin() {}
+uint32_t cycleCount() { return ESP.getCycleCount(); }
+#define HAVE_CYCLE_COUNTER 1
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+void cycleCounterBegin()
+{
+  volatile uint32_t *DEMCR = (volatile uint32_t *)0xE000EDFC;
+  volatile uint32_t *DWT_CTRL = (volatile uint32_t *)0xE0001000;
+  volatile uint32_t *DWT_CYCCNT = (volatile uint32_t *)0xE0001004;
+  *DEMCR |= 0x01000000; // TRCENA
+  *DWT_CYCCNT = 0;
+  *DWT_CTRL |= 1; // CYCCNTENA
+}
+uint32_t cycleCount() { return *(volatile uint32_t *)0xE0001004; }
+#define HAVE_CYCLE_COUNTER 1
+#else
+void cycleCounterBegin() {}
+uint32_t cycleCount() { return 0; }
+#define HAVE_CYCLE_COUNTER 0
+#endif
+
+// The calls to benchmark. Each is called with the iteration number
+bool benchBegin(uint32_t) { return myOCXO.begin(); }
+bool benchReadFrequencyControlWord(uint32_t) { return myOCXO.readFrequencyControlWord(); }
+bool benchGetFrequencyControlWord(uint32_t) { return (myOCXO.getFrequencyControlWord() <= kSfeSTP3593LFFreqControlMaxValue); }
+bool benchSetFrequencyControlWord(uint32_t i) { return myOCXO.setFrequencyControlWord(500000 + (i & 0xFF)); }
+bool benchSetFrequencyByBiasMillis(uint32_t i) { return myOCXO.setFrequencyByBiasMillis((i & 1) ? 10.0e-6 : -10.0e-6); }
+bool benchUpdateDiscipline(uint32_t i) { return myOCXO.updateDiscipline((i & 1) ? 10.0e-6 : -10.0e-6); }
+bool benchSetFrequencyByPhasePicoseconds(uint32_t i) { return myOCXO.setFrequencyByPhasePicoseconds((i & 1) ? 10000 : -10000); }
+bool benchSaveFrequencyControlValue(uint32_t) { return myOCXO.saveFrequencyControlValue(); }
+
+typedef bool (*benchFunction)(uint32_t i);
+
+typedef struct
+{
+  const char *name;
+  benchFunction function;
+} benchmark_t;
+
+const benchmark_t benchmarks[] = {
+  { "begin", benchBegin },
+  { "readFrequencyControlWord", benchReadFrequencyControlWord },
+  { "getFrequencyControlWord", benchGetFrequencyControlWord },
+  { "setFrequencyControlWord", benchSetFrequencyControlWord },
+  { "setFrequencyByBiasMillis", benchSetFrequencyByBiasMillis },
+  { "updateDiscipline", benchUpdateDiscipline },
+  { "setFrequencyByPhasePicoseconds", benchSetFrequencyByPhasePicoseconds },
+  { "saveFrequencyControlValue", benchSaveFrequencyControlValue },
+};
+const int numBenchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+void runBenchmark(const benchmark_t &bench)
+{
+  SfeSTP3593LFMockBus &bus = myOCXO.getMockBus();
+  bus.resetCounters();
+
+  uint32_t failures = 0;
+  uint32_t startCycles = cycleCount();
+  unsigned long startMicros = micros();
+
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    if (!bench.function(i))
+      failures++;
+  }
+
+  unsigned long elapsedMicros = micros() - startMicros;
+  uint32_t elapsedCycles = cycleCount() - startCycles;
+
+  if (elapsedMicros == 0)
+    elapsedMicros = 1;
+  double callsPerSecond = ((double)iterations * 1.0e6) / (double)elapsedMicros;
+  double cyclesPerCall;
+#if HAVE_CYCLE_COUNTER
+  cyclesPerCall = (double)elapsedCycles / (double)iterations;
+#elif defined(F_CPU)
+  (void)elapsedCycles; // No cycle counter. Estimate from the elapsed time
+  cyclesPerCall = ((double)elapsedMicros * ((double)F_CPU / 1.0e6)) / (double)iterations;
+#else
+  (void)elapsedCycles;
+  cyclesPerCall = 0.0; // Unknown
+#endif
+  double bytesPerCall = (double)(bus.getBytesWritten() + bus.getBytesRead()) / (double)iterations;
+  double transactionsPerCall = (double)bus.getTransactions() / (double)iterations;
+
+  Serial.print(bench.name);
+  Serial.print(",");
+  Serial.print(callsPerSecond, 0);
+  Serial.print(",");
+  Serial.print(cyclesPerCall, 1);
+  Serial.print(",");
+  Serial.print(bytesPerCall, 2);
+  Serial.print(",");
+  Serial.print(transactionsPerCall, 2);
+  Serial.print(",");
+  Serial.println(failures);
+}
+
+// The begin modes - for the time-to-first-write table
+typedef struct
+{
+  const char *name;
+  sfeSTP3593LFBeginMode_t mode;
+} beginMode_t;
+
+const beginMode_t beginModes[] = {
+  { "emulator", kSfeSTP3593LFBeginEmulator },
+  { "verified", kSfeSTP3593LFBeginVerified },
+  { "probe", kSfeSTP3593LFBeginProbe },
+  { "lazy", kSfeSTP3593LFBeginLazy },
+};
+const int numBeginModes = sizeof(beginModes) / sizeof(beginModes[0]);
+
+void runBeginMode(const beginMode_t &beginMode)
+{
+  const uint32_t repeats = 100;
+  uint32_t beginBytes = 0;
+  uint32_t bytes = 0;
+  uint32_t transactions = 0;
+  uint32_t failures = 0;
+  unsigned long elapsedMicros = 0;
+
+  for (uint32_t i = 0; i < repeats; i++)
+  {
+    SfeSTP3593LFMock ocxo; // A fresh driver each time: nothing learned, nothing read
+    ocxo.setBeginMode(beginMode.mode);
+
+    unsigned long startMicros = micros();
+    bool result = ocxo.begin();
+    SfeSTP3593LFMockBus &bus = ocxo.getMockBus();
+    beginBytes += bus.getBytesWritten() + bus.getBytesRead();
+    if (result)
+      result = ocxo.setFrequencyByPhasePicoseconds(10000); // The first write
+    elapsedMicros += micros() - startMicros;
+
+    if (!result)
+      failures++;
+    bytes += bus.getBytesWritten() + bus.getBytesRead();
+    transactions += bus.getTransactions();
+  }
+
+  double bytesPerStart = (double)bytes / (double)repeats;
+
+  Serial.print(beginMode.name);
+  Serial.print(",");
+  Serial.print((double)beginBytes / (double)repeats, 1);
+  Serial.print(",");
+  Serial.print((double)transactions / (double)repeats, 1);
+  Serial.print(",");
+  Serial.print(bytesPerStart, 1);
+  Serial.print(",");
+  Serial.print(bytesPerStart * 90.0, 0); // 9 bits per byte at 10us per bit
+  Serial.print(",");
+  Serial.print(bytesPerStart * 22.5, 0); // 9 bits per byte at 2.5us per bit
+  Serial.print(",");
+  Serial.print((double)elapsedMicros / (double)repeats, 2);
+  Serial.print(",");
+  Serial.println(failures);
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  cycleCounterBegin();
+
+  if (!myOCXO.begin())
+  {
+    Serial.println("Mock STP3593LF did not begin!");
+    while (1); // Do nothing more
+  }
+
+  Serial.print("Iterations per call: ");
+  Serial.println(iterations);
+  Serial.println("call,calls/s,cycles/call,bus bytes/call,bus transactions/call,failures");
+
+  for (int i = 0; i < numBenchmarks; i++)
+    runBenchmark(benchmarks[i]);
+
+  Serial.println();
+  Serial.println("begin mode,begin bus bytes,bus transactions,bus bytes,bus us at 100kHz,bus us at 400kHz,cpu us,failures");
+
+  for (int i = 0; i < numBeginModes; i++)
+    runBeginMode(beginModes[i]);
+}
+
+void loop()
+{
+  // Nothing to do here
+}
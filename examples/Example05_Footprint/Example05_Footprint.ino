@@ -0,0 +1,102 @@
+/*
+  Exercise every enabled feature of the STP3593LF library - for footprint measurement.
+
+  This example is built once per feature configuration by extras/footprint.sh,
+  which reports the text / data / bss of each build. It calls each enabled
+  feature with values read from the Serial console, so the linker keeps the
+  code (and the compiler cannot fold it away).
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  It also runs: type a phase (PPS-to-oscillator, in picoseconds) and press Enter.
+  The feature switches are described in SparkFun_STP3593LF_Config.h.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+#include <SparkFun_STP3593LF_Recorder.h>
+#endif
+
+SfeSTP3593LFArdI2C myOCXO;
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+SfeSTP3593LFRecorder myRecorder(Serial);
+#endif
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  Wire.begin(); // Begin the I2C bus
+
+  if (!myOCXO.begin())
+  {
+    Serial.println("STP3593LF not detected! Please check the address and try again...");
+    while (1); // Do nothing more
+  }
+
+#if SFE_STP3593LF_ENABLE_VERIFICATION
+  myOCXO.setWriteVerification(true);
+#endif
+
+#if SFE_STP3593LF_ENABLE_DITHER
+  myOCXO.enableDither(true);
+#endif
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+  myOCXO.setMaxFrequencyChangePPB(3);
+  myOCXO.setTICConfiguration(12500, 32, 10000000);
+#endif
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+  myOCXO.enableTemperatureCompensation(true);
+#endif
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+  myOCXO.useEstimatedFreqControlResolution(true);
+#endif
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+  myOCXO.setRecorder(&myRecorder); // Binary trace on Serial
+#endif
+}
+
+void loop()
+{
+#if SFE_STP3593LF_ENABLE_DITHER
+  myOCXO.serviceDither();
+#endif
+
+  if (Serial.available() == 0)
+    return;
+
+  int32_t phase = Serial.parseInt(); // Picoseconds
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+  myOCXO.setTemperature(25.0 + ((double)(phase & 0xFF) / 100.0));
+  myOCXO.updateDiscipline((double)phase * 1.0e-9); // Picoseconds to milliseconds
+#endif
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+  myOCXO.setFrequencyByTICCount((uint32_t)phase);
+#else
+  myOCXO.setFrequencyControlWord((uint32_t)phase);
+#endif
+
+  if ((phase & 0xFFFF) == 0)
+    myOCXO.saveFrequencyControlValue();
+
+  Serial.println(myOCXO.getFrequencyControlWord());
+}
@@ -0,0 +1,170 @@
+/*
+  Stress the thread-safe STP3593LF driver from two tasks at once.
+
+  This example shows how to share one oscillator between a PPS task and a
+  housekeeping task. Both tasks step the frequency control word as fast as they
+  can, while a third reader polls the lock-free getFrequencyControlWord. At the
+  end the word must equal the sum of every step: no update may be lost, and the
+  reader must never see the word go backwards.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  On ESP32 the writers are FreeRTOS tasks, one pinned to each core, and the
+  lock is a FreeRTOS mutex. On a host build they are std::threads and the lock
+  is a std::mutex. The driver is on the in-memory (mock) bus.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+#include <SparkFun_STP3593LF_ThreadSafe.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+typedef SfeSTP3593LFRTOSLock LockPolicy;
+#elif SFE_STP3593LF_HAVE_STD_LOCK
+#include <thread>
+typedef SfeSTP3593LFStdLock LockPolicy;
+#else
+#error This example needs an ESP32 (or a host build with std::thread)
+#endif
+
+SfeSTP3593LFThreadSafe<SfeSTP3593LFMock, LockPolicy> myOCXO; // The driver - on the in-memory bus
+
+const uint32_t iterations = 20000; // Per writer
+const int32_t ppsStep = 1;
+const int32_t housekeepingStep = 2;
+
+volatile uint32_t writersDone = 0;
+volatile uint32_t writeFailures = 0;
+
+// The PPS task: small steps, as fast as possible
+void ppsWork()
+{
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    if (!myOCXO.adjustFrequencyControlWord(ppsStep))
+      __atomic_add_fetch(&writeFailures, 1, __ATOMIC_RELAXED);
+  }
+  __atomic_add_fetch(&writersDone, 1, __ATOMIC_RELEASE);
+}
+
+// The housekeeping task: larger steps, and a register read every 16 steps
+void housekeepingWork()
+{
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    if (!myOCXO.adjustFrequencyControlWord(housekeepingStep))
+      __atomic_add_fetch(&writeFailures, 1, __ATOMIC_RELAXED);
+    if ((i & 0x0F) == 0)
+    {
+      if (!myOCXO.access([](SfeSTP3593LFMock &ocxo) { return ocxo.readFrequencyControlWord(); }))
+        __atomic_add_fetch(&writeFailures, 1, __ATOMIC_RELAXED);
+    }
+  }
+  __atomic_add_fetch(&writersDone, 1, __ATOMIC_RELEASE);
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+void ppsTask(void *parameter)
+{
+  ppsWork();
+  vTaskDelete(nullptr);
+}
+
+void housekeepingTask(void *parameter)
+{
+  housekeepingWork();
+  vTaskDelete(nullptr);
+}
+#endif
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  if (!myOCXO.begin())
+  {
+    Serial.println("Mock STP3593LF did not begin!");
+    while (1); // Do nothing more
+  }
+
+  uint32_t startWord = myOCXO.getFrequencyControlWord();
+  uint32_t expectedWord = startWord + (iterations * (uint32_t)(ppsStep + housekeepingStep));
+
+  unsigned long start = micros();
+
+#if defined(ARDUINO_ARCH_ESP32)
+  xTaskCreatePinnedToCore(ppsTask, "pps", 4096, nullptr, 2, nullptr, 0);
+  xTaskCreatePinnedToCore(housekeepingTask, "housekeeping", 4096, nullptr, 1, nullptr, 1);
+#else
+  std::thread ppsThread(ppsWork);
+  std::thread housekeepingThread(housekeepingWork);
+#endif
+
+  // Meanwhile, poll the lock-free read. The steps are all positive: the word must never go backwards
+  uint32_t reads = 0;
+  uint32_t badReads = 0;
+  uint32_t lastWord = startWord;
+  while (__atomic_load_n(&writersDone, __ATOMIC_ACQUIRE) < 2)
+  {
+    uint32_t word = myOCXO.getFrequencyControlWord();
+    if ((word < lastWord) || (word > expectedWord))
+      badReads++;
+    lastWord = word;
+    reads++;
+#if defined(ARDUINO_ARCH_ESP32)
+    if ((reads & 0xFF) == 0)
+      delay(1); // Let the housekeeping task (same core) run
+#endif
+  }
+
+  unsigned long elapsed = micros() - start;
+
+#if !defined(ARDUINO_ARCH_ESP32)
+  ppsThread.join();
+  housekeepingThread.join();
+#endif
+
+  uint32_t finalWord = myOCXO.getFrequencyControlWord();
+  uint32_t deviceWord = myOCXO.access([](SfeSTP3593LFMock &ocxo) { return ocxo.getMockBus().getWord(); });
+
+  Serial.print("Writes: ");
+  Serial.print(iterations * 2);
+  Serial.print(" in ");
+  Serial.print(elapsed);
+  Serial.println(" us");
+  Serial.print("Lock-free reads: ");
+  Serial.println(reads);
+  Serial.print("Expected word: ");
+  Serial.print(expectedWord);
+  Serial.print("  Driver word: ");
+  Serial.print(finalWord);
+  Serial.print("  Device word: ");
+  Serial.println(deviceWord);
+  Serial.print("Lost LSBs: ");
+  Serial.println((int32_t)(expectedWord - finalWord));
+  Serial.print("Out-of-order reads: ");
+  Serial.println(badReads);
+  Serial.print("Failures: ");
+  Serial.println(writeFailures);
+
+  if ((finalWord == expectedWord) && (deviceWord == expectedWord) && (badReads == 0) && (writeFailures == 0))
+    Serial.println("PASS");
+  else
+    Serial.println("FAIL");
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -0,0 +1,104 @@
+/*
+  Discipline the STP3593LF OCXO from a PPS interrupt, via the sample queue.
+
+  This example shows how to split the discipline loop in two: the PPS interrupt
+  captures the time-interval-counter (TIC) count and queues it - wait-free, with
+  bounded latency - and the I2C write happens later, in task context, when the
+  queue is serviced. No bus transaction is ever made from the interrupt.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  Connect the GNSS PPS output to ppsPin.
+
+  On ESP32, startDisciplineTask starts a FreeRTOS task which sleeps until a
+  sample is queued. On other boards, loop() calls serviceDiscipline.
+
+  For a real TIC, replace micros() in ppsISR with the capture register of a
+  timer clocked by the OCXO 10MHz output - and change setTICConfiguration to
+  match (tick 100000ps, the timer width, 10000000 counts per epoch).
+  micros() is clocked by the microcontroller, not the OCXO, so here it only
+  demonstrates the plumbing.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+
+#if !SFE_STP3593LF_ENABLE_PI_LOOP
+#error This example needs the PI loop (SFE_STP3593LF_ENABLE_PI_LOOP)
+#endif
+
+SfeSTP3593LFArdI2C myOCXO;
+
+const int ppsPin = 4; // Change this to suit your board
+
+// The PPS interrupt: capture and queue. Nothing else
+#if defined(ARDUINO_ARCH_ESP32)
+void IRAM_ATTR ppsISR()
+#else
+void ppsISR()
+#endif
+{
+  myOCXO.queueTICCount((uint32_t)micros()); // A full queue drops the sample - see getSampleQueueOverflows
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  Wire.begin(); // Begin the I2C bus
+
+  if (!myOCXO.begin())
+  {
+    Serial.println("STP3593LF not detected! Please check the address and try again...");
+    while (1); // Do nothing more
+  }
+
+  myOCXO.setMaxFrequencyChangePPB(3); // Set the maximum frequency change in PPB
+  myOCXO.setTICConfiguration(1000000, 32, 1000000); // micros(): 1us per count, 32 bits, 1000000 counts per second
+  myOCXO.setQueueGainsQ16(kSfeSTP3593LFDefaultPkQ16, kSfeSTP3593LFDefaultIkQ16);
+
+#if defined(ARDUINO_ARCH_ESP32)
+  if (!myOCXO.startDisciplineTask(5, 1)) // Priority 5, core 1
+  {
+    Serial.println("Could not start the discipline task!");
+    while (1); // Do nothing more
+  }
+#endif
+
+  pinMode(ppsPin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ppsPin), ppsISR, RISING);
+}
+
+void loop()
+{
+#if !defined(ARDUINO_ARCH_ESP32)
+  myOCXO.serviceDiscipline(); // Apply any queued samples
+#endif
+
+  static unsigned long lastPrint = 0;
+  if (millis() - lastPrint >= 1000)
+  {
+    lastPrint = millis();
+
+    Serial.print("Control word: ");
+    Serial.print(myOCXO.getFrequencyControlWord());
+    Serial.print("  Phase (ps): ");
+    Serial.print((long)myOCXO.getTICPhasePicoseconds());
+    Serial.print("  Max latency (us): ");
+    Serial.print(myOCXO.getMaxSampleLatencyMicros());
+    Serial.print("  Overflows: ");
+    Serial.print(myOCXO.getSampleQueueOverflows());
+    Serial.print("  Write failures: ");
+    Serial.println(myOCXO.getSampleWriteFailures());
+  }
+}
@@ -0,0 +1,124 @@
+/*
+  Share one I2C port between the STP3593LF and a slow sensor.
+
+  This example shows how to keep the DAC write on time when the same Wire bus
+  also carries a long sensor read. The PPS interrupt queues the TIC capture and
+  reserves the bus for the OCXO: its next write must start within
+  writeDeadlineMicros. The sensor read is only started if it will be finished
+  before that deadline.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  Connect the GNSS PPS output to ppsPin. sensorAddress is any other device on
+  the bus - the example reads sensorBytes from it in one transaction.
+
+  On ESP32 the OCXO writes are made by the discipline task (startDisciplineTask)
+  and the scheduler arbitrates between it and loop(). On other boards loop()
+  makes both, and tryAcquire defers the sensor read instead.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_BusScheduler.h>
+
+#if !SFE_STP3593LF_ENABLE_PI_LOOP
+#error This example needs the PI loop (SFE_STP3593LF_ENABLE_PI_LOOP)
+#endif
+
+SfeSTP3593LFBusScheduler myScheduler; // Arbitrates Wire
+SfeSTP3593LFScheduledArdI2C myOCXO; // The OCXO - a client of myScheduler
+
+const int ppsPin = 4; // Change this to suit your board
+const uint8_t sensorAddress = 0x40; // Change this to suit your sensor
+const uint8_t sensorBytes = 32; // A long read: ~3ms at 100kHz
+const uint32_t sensorMicros = 4000; // The expected length of the sensor read, with margin
+const uint32_t writeDeadlineMicros = 5000; // The OCXO write must start within 5ms of the PPS edge
+
+const uint8_t ocxoPriority = 10; // Higher is more urgent
+const uint8_t sensorPriority = 1;
+uint8_t sensorClient;
+
+// The PPS interrupt: capture, queue and reserve the bus. Nothing else
+#if defined(ARDUINO_ARCH_ESP32)
+void IRAM_ATTR ppsISR()
+#else
+void ppsISR()
+#endif
+{
+  uint32_t now = micros(); // Replace with the capture register of a timer clocked by the OCXO
+  myOCXO.queueTICCount(now);
+  myOCXO.reserveBus(now + writeDeadlineMicros);
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  Wire.begin(); // Begin the I2C bus
+
+  if (!myOCXO.begin(myScheduler, ocxoPriority, Wire))
+  {
+    Serial.println("STP3593LF not detected! Please check the address and try again...");
+    while (1); // Do nothing more
+  }
+
+  sensorClient = myScheduler.addClient(sensorPriority);
+
+  myOCXO.setMaxFrequencyChangePPB(3); // Set the maximum frequency change in PPB
+  myOCXO.setTICConfiguration(1000000, 32, 1000000); // micros(): 1us per count, 32 bits, 1000000 counts per second
+
+#if defined(ARDUINO_ARCH_ESP32)
+  myOCXO.startDisciplineTask(5, 1); // Priority 5, core 1
+#endif
+
+  pinMode(ppsPin, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ppsPin), ppsISR, RISING);
+}
+
+void loop()
+{
+#if !defined(ARDUINO_ARCH_ESP32)
+  myOCXO.serviceDiscipline(); // Apply any queued samples - on time: the sensor read below keeps clear of the deadline
+#endif
+
+  // The slow sensor read - only if it will not delay the OCXO
+  if (myScheduler.tryAcquire(sensorClient, sensorMicros))
+  {
+    Wire.requestFrom(sensorAddress, sensorBytes);
+    while (Wire.available())
+      Wire.read();
+    myScheduler.release(sensorClient);
+  }
+
+  static unsigned long lastPrint = 0;
+  if (millis() - lastPrint >= 10000)
+  {
+    lastPrint = millis();
+
+    sfeSTP3593LFBusClientStats_t ocxoStats;
+    sfeSTP3593LFBusClientStats_t sensorStats;
+    myScheduler.getClientStats(myOCXO.getBusClient(), ocxoStats);
+    myScheduler.getClientStats(sensorClient, sensorStats);
+
+    Serial.print("OCXO: transactions ");
+    Serial.print(ocxoStats.grants);
+    Serial.print("  max wait (us) ");
+    Serial.print(ocxoStats.maxWaitMicros);
+    Serial.print("  deadline misses ");
+    Serial.print(ocxoStats.deadlineMisses);
+    Serial.print("    Sensor: reads ");
+    Serial.print(sensorStats.grants);
+    Serial.print("  deferred ");
+    Serial.println(sensorStats.deferrals);
+  }
+}
@@ -0,0 +1,107 @@
+/*
+  Warm-start the STP3593LF discipline loop from a snapshot in EEPROM.
+
+  This example shows how to keep the learned loop state - the integrator, the
+  gains, the state machine and the estimators - across a reboot, so the loop
+  resumes in Tracking and re-locks in seconds instead of minutes.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  Type the GNSS RX clock bias in nanoseconds, once per second, and press Enter.
+  Every snapshotEpochs epochs the snapshot is written to EEPROM. Reset the
+  board: the next begin restores it.
+
+  The snapshot is at most kSfeSTP3593LFSnapshotMaxSize bytes. It carries a CRC,
+  so a blank or worn EEPROM simply gives a cold start.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <EEPROM.h>
+
+#if !SFE_STP3593LF_FLOATING_POINT_LOOP
+#error This example needs the floating-point loop (SFE_STP3593LF_ENABLE_PI_LOOP, not SFE_STP3593LF_FIXED_POINT)
+#endif
+
+SfeSTP3593LFArdI2C myOCXO;
+
+const int eepromAddress = 0; // Where the snapshot is stored
+const uint32_t snapshotEpochs = 600; // Save every 10 minutes - EEPROM endurance is limited
+
+uint8_t snapshot[kSfeSTP3593LFSnapshotMaxSize];
+uint32_t epochs = 0;
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_RP2040)
+  EEPROM.begin(kSfeSTP3593LFSnapshotMaxSize); // These cores emulate EEPROM in flash
+#endif
+
+  for (size_t i = 0; i < sizeof(snapshot); i++)
+    snapshot[i] = EEPROM.read(eepromAddress + i);
+
+  Wire.begin(); // Begin the I2C bus
+
+  myOCXO.setWarmStart(snapshot, sizeof(snapshot)); // begin restores it - if it is valid
+
+  unsigned long start = millis();
+  if (!myOCXO.begin())
+  {
+    Serial.println("STP3593LF not detected! Please check the address and try again...");
+    while (1); // Do nothing more
+  }
+  unsigned long elapsed = millis() - start;
+
+  Serial.print(myOCXO.getWarmStarted() ? "Warm start" : "Cold start");
+  Serial.print(" in ");
+  Serial.print(elapsed);
+  Serial.print(" ms. Frequency control word is ");
+  Serial.print(myOCXO.getFrequencyControlWord());
+  Serial.print(". Discipline state is ");
+  Serial.println((int)myOCXO.getDisciplineState());
+}
+
+void loop()
+{
+  if (Serial.available() == 0)
+    return;
+
+  double bias = Serial.parseFloat() * 1.0e-6; // Nanoseconds to milliseconds
+  while (Serial.available())
+    Serial.read(); // Discard the line ending
+
+  myOCXO.updateDiscipline(bias);
+
+  Serial.print("Word: ");
+  Serial.print(myOCXO.getFrequencyControlWord());
+  Serial.print("  State: ");
+  Serial.println((int)myOCXO.getDisciplineState());
+
+  if ((++epochs % snapshotEpochs) == 0)
+  {
+    size_t length = myOCXO.getSnapshot(snapshot, sizeof(snapshot));
+    for (size_t i = 0; i < length; i++)
+    {
+      if (EEPROM.read(eepromAddress + i) != snapshot[i])
+        EEPROM.write(eepromAddress + i, snapshot[i]); // Only write the bytes which have changed
+    }
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_RP2040)
+    EEPROM.commit();
+#endif
+    Serial.print("Snapshot saved: ");
+    Serial.print(length);
+    Serial.println(" bytes");
+  }
+}
@@ -0,0 +1,158 @@
+/*
+  Discipline the STP3593LF OCXO at a faster - or irregular - update rate.
+
+  This example shows how setFrequencyByTimedBiasMillis keeps the loop behaving
+  the same at any update rate. Each bias is passed with its timestamp; the driver
+  measures the time step (dt) since the previous sample and scales the integral
+  step by it, so the integral slews at the same rate however often it is fed.
+  The gains tuned at one update per second need no retuning at five updates per
+  second, and a missed sample (a gap) is limited to setMaxTimeStepMillis so it
+  cannot wind up the integral.
+
+  The timed runs settle alike at every rate: the loop bandwidth is set by the
+  gains, not by the update rate. The untimed 5Hz run settles sooner only because
+  its integral gain is five times too high - which is retuning by accident.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  To keep this example self-contained, the oscillator and the GNSS receiver are
+  simulated on the in-memory (mock) bus: an oscillator which is 20ppb fast at
+  500000, with 2ns of bias noise. Four runs are compared:
+    1Hz untimed : setFrequencyByBiasMillis once per second - the reference
+    1Hz timed   : setFrequencyByTimedBiasMillis once per second - identical to the reference
+    5Hz untimed : setFrequencyByBiasMillis five times per second - every sample is
+                  treated as one second, so the integral runs five times too fast
+    5Hz timed   : setFrequencyByTimedBiasMillis five times per second, with 1ms of
+                  timestamp jitter and a 10 second outage
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+
+#if !SFE_STP3593LF_FLOATING_POINT_LOOP
+#error This example needs the floating-point loop (SFE_STP3593LF_ENABLE_PI_LOOP, not SFE_STP3593LF_FIXED_POINT)
+#endif
+
+const uint32_t runSeconds = 900;
+const double settledNanos = 10.0; // The run has settled once |phase| stays below this
+
+SfeSTP3593LFMock reference; // The 1Hz untimed run. The timed 1Hz run is checked against it word for word
+
+// Simulate one run. Returns the settling time in seconds (0 if it never settled)
+uint32_t simulate(SfeSTP3593LFMock &ocxo, uint32_t periodMicros, bool timed, bool outage, double &rmsNanos, uint32_t &mismatches)
+{
+  ocxo.begin();
+  ocxo.setMaxFrequencyChangePPB(50.0);
+  reference.begin();
+  reference.setMaxFrequencyChangePPB(50.0);
+
+  randomSeed(1);
+  double phase = 150.0e-9; // Seconds
+  uint32_t now = 0; // The simulated micros()
+  uint32_t settledAt = 0;
+  double sumSquares = 0.0;
+  uint32_t squares = 0;
+  mismatches = 0;
+
+  while (now < (runSeconds * 1000000))
+  {
+    // The time step, with up to 1ms of timestamp jitter at 5Hz
+    uint32_t step = periodMicros;
+    if (periodMicros < 1000000)
+      step += random(-1000, 1001);
+    if (outage && (now >= 300000000) && (now < 310000000))
+      step = 10000000; // No samples for 10 seconds
+    now += step;
+
+    phase += (20.0e-9 + (((double)ocxo.getFrequencyControlWord() - 500000.0) * kSfeSTP3593LFFreqControlResolution)) * ((double)step / 1.0e6);
+    double noise = ((double)random(-1000, 1001)) * 2.0e-12;
+    double bias = (phase + noise) * 1000.0; // Bias in millis
+
+    if (timed)
+      ocxo.setFrequencyByTimedBiasMillis(now, bias);
+    else
+      ocxo.setFrequencyByBiasMillis(bias);
+
+    if (timed && (periodMicros == 1000000))
+    {
+      reference.setFrequencyByBiasMillis(bias);
+      if (reference.getFrequencyControlWord() != ocxo.getFrequencyControlWord())
+        mismatches++;
+    }
+
+    double phaseNanos = phase * 1.0e9;
+    if ((phaseNanos > settledNanos) || (phaseNanos < (0.0 - settledNanos)))
+      settledAt = 0;
+    else if (settledAt == 0)
+      settledAt = now / 1000000;
+
+    if (now >= ((runSeconds - 300) * 1000000)) // The last five minutes
+    {
+      sumSquares += phaseNanos * phaseNanos;
+      squares++;
+    }
+  }
+
+  rmsNanos = sqrt(sumSquares / squares);
+  return settledAt;
+}
+
+void report(const char *name, SfeSTP3593LFMock &ocxo, uint32_t periodMicros, bool timed, bool outage)
+{
+  double rmsNanos;
+  uint32_t mismatches;
+  uint32_t settled = simulate(ocxo, periodMicros, timed, outage, rmsNanos, mismatches);
+
+  Serial.print(name);
+  Serial.print(",");
+  if (settled > 0)
+    Serial.print(settled);
+  else
+    Serial.print("never");
+  Serial.print(",");
+  Serial.print(rmsNanos, 3);
+  Serial.print(",");
+  Serial.print(ocxo.getFrequencyControlWord());
+  Serial.print(",");
+  if (timed)
+  {
+    Serial.print(ocxo.getTimeStepGaps());
+    Serial.print(",");
+    if (periodMicros == 1000000)
+      Serial.print(mismatches);
+    else
+      Serial.print("-");
+  }
+  else
+    Serial.print("-,-");
+  Serial.println();
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  SfeSTP3593LFMock run1, run2, run3, run4;
+
+  Serial.println("run,settled (s),last 5 min RMS (ns),final word,gaps,mismatches vs 1Hz untimed");
+  report("1Hz untimed", run1, 1000000, false, false);
+  report("1Hz timed", run2, 1000000, true, false);
+  report("5Hz untimed", run3, 200000, false, false);
+  report("5Hz timed", run4, 200000, true, true);
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -0,0 +1,84 @@
+/*
+  Set the frequency of the STP3593LF OCXO more finely than one LSB - by dithering.
+
+  This example shows how to reach a fractional frequency control word. Each
+  one-second epoch is divided into slots; a sigma-delta modulator chooses the
+  word or the word above for each slot, so the average frequency over the epoch
+  lands between the two. The residual carries from epoch to epoch, so the
+  long-term average is exact to 1/65536 LSB.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  At 8E-13 per LSB, one LSB is visible in the short-tau Allan deviation of a
+  locked loop. Dithering trades it for bus traffic: at most slotsPerEpoch writes
+  per second, reported by getDitherWritesPerEpoch. A fraction of 0.5 toggles every
+  slot; a fraction near 0 or 1 writes twice per epoch at most.
+
+  With dithering enabled, updateDiscipline and setFrequencyByPhasePicoseconds
+  set the fractional word themselves. Here the fraction is stepped by hand.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+
+#if !SFE_STP3593LF_ENABLE_DITHER
+#error This example needs the dither (SFE_STP3593LF_ENABLE_DITHER)
+#endif
+
+SfeSTP3593LFArdI2C myOCXO;
+
+const uint8_t slotsPerEpoch = 16; // 62.5ms slots: at most 16 writes per second
+
+uint32_t baseWord;
+uint16_t fraction = 0;
+unsigned long lastEpoch;
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  Wire.begin(); // Begin the I2C bus
+
+  if (!myOCXO.begin())
+  {
+    Serial.println("STP3593LF not detected! Please check the address and try again...");
+    while (1); // Do nothing more
+  }
+
+  myOCXO.enableDither(true, slotsPerEpoch);
+
+  baseWord = myOCXO.getFrequencyControlWord();
+  myOCXO.setDitheredFrequencyControlWord(baseWord, fraction);
+  lastEpoch = millis();
+
+  Serial.println("fraction (LSB),writes in the last epoch,total writes");
+}
+
+void loop()
+{
+  myOCXO.serviceDither(); // Call as often as possible - at least slotsPerEpoch times per second
+
+  if (millis() - lastEpoch < 1000)
+    return;
+  lastEpoch += 1000;
+
+  // Step the fraction by 1/16 LSB each epoch
+  fraction += 0x1000;
+  myOCXO.setDitheredFrequencyControlWord(baseWord, fraction);
+
+  Serial.print((double)fraction / 65536.0, 4);
+  Serial.print(",");
+  Serial.print(myOCXO.getDitherWritesPerEpoch());
+  Serial.print(",");
+  Serial.println(myOCXO.getDitherWrites());
+}
@@ -0,0 +1,130 @@
+/*
+  Discipline the STP3593LF OCXO without a rounding bias - using error feedback.
+
+  This example shows how enableErrorFeedback removes the bias which rounding
+  adds to the loop output. The loop computes proportional plus integral as a
+  fraction of an LSB, but the register takes a whole word: rounding discards
+  the remainder every epoch. When the loop output sits still - as it does once
+  the loop has settled - the same remainder is discarded every time, so the
+  average frequency is off by up to half an LSB (4E-13) and the integral has to
+  wind the phase error up until its correction makes the word flip.
+
+  With error feedback, each epoch's remainder is added to the next epoch's
+  output before it is rounded. The word then alternates between its neighbours
+  in the right proportion, and the rounding errors cancel: the average word
+  follows the loop output to a small fraction of an LSB.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  To keep this example self-contained, the oscillator and the GNSS receiver are
+  simulated on the in-memory (mock) bus: an oscillator which needs a word of
+  475000.37 to be on frequency, with 1ps of bias noise. Each run settles for
+  15 minutes and is then measured for an hour:
+    rounding error   : the mean of the word written minus the loop output. About
+                       -0.08 LSB without error feedback; about 0.005 LSB with it
+    frequency error  : the mean of the word written minus 475000.37. The integral
+                       hides the rounding bias from the long-term mean - by
+                       carrying a phase error which offsets it - so both are ~0
+    worst 64s error  : the worst 64-second mean frequency error
+    phase            : the RMS phase error. Lower with error feedback: the loop no
+                       longer has to wind up a phase error to make the word flip
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+
+#if !SFE_STP3593LF_FLOATING_POINT_LOOP
+#error This example needs the floating-point loop (SFE_STP3593LF_ENABLE_PI_LOOP, not SFE_STP3593LF_FIXED_POINT)
+#endif
+
+const double idealWord = 475000.37; // The word which puts the simulated oscillator on frequency
+const uint32_t settleSeconds = 900;
+const uint32_t measureSeconds = 3600;
+const uint32_t windowSeconds = 64; // The averaging window for the worst-case frequency error
+const double noiseSeconds = 1.0e-12; // The bias noise
+
+void simulate(bool errorFeedback)
+{
+  SfeSTP3593LFMock ocxo;
+  ocxo.begin();
+  ocxo.setMaxFrequencyChangePPB(50.0);
+  ocxo.setFrequencyControlWord(475000);
+  ocxo.enableErrorFeedback(errorFeedback);
+
+  randomSeed(1);
+  double phase = 0.0; // Seconds
+  double sumRoundingError = 0.0; // The word written minus the loop output
+  double sumWordError = 0.0; // The word written minus the word the oscillator needs
+  double sumSquares = 0.0;
+  double windowSum = 0.0;
+  double worstWindow = 0.0;
+  uint32_t writes = 0;
+
+  for (uint32_t second = 0; second < (settleSeconds + measureSeconds); second++)
+  {
+    uint32_t before = ocxo.getFrequencyControlWord();
+
+    double noise = ((double)random(-1000, 1001)) * noiseSeconds / 1000.0;
+    ocxo.setFrequencyByBiasMillis((phase + noise) * 1000.0);
+
+    uint32_t word = ocxo.getFrequencyControlWord();
+    double wordError = (double)word - idealWord;
+    phase += wordError * kSfeSTP3593LFFreqControlResolution; // One second at this frequency error
+
+    if (second < settleSeconds)
+      continue;
+
+    // The word written minus the loop output - which is the word plus the discarded remainder
+    sumRoundingError -= ocxo.getQuantizationResidualQ16() / 65536.0;
+    sumWordError += wordError;
+    sumSquares += phase * phase;
+    if (word != before)
+      writes++;
+
+    windowSum += wordError;
+    if (((second - settleSeconds) % windowSeconds) == (windowSeconds - 1))
+    {
+      double window = windowSum / windowSeconds;
+      if (fabs(window) > worstWindow)
+        worstWindow = fabs(window);
+      windowSum = 0.0;
+    }
+  }
+
+  Serial.print(errorFeedback ? "on" : "off");
+  Serial.print(",");
+  Serial.print(sumRoundingError / measureSeconds, 4);
+  Serial.print(",");
+  Serial.print(sumWordError / measureSeconds, 4);
+  Serial.print(",");
+  Serial.print(worstWindow, 4);
+  Serial.print(",");
+  Serial.print(sqrt(sumSquares / measureSeconds) * 1.0e12, 2);
+  Serial.print(",");
+  Serial.println(writes);
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  Serial.println("error feedback,rounding error (LSB),frequency error (LSB),worst 64s error (LSB),RMS phase (ps),writes");
+  simulate(false);
+  simulate(true);
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -0,0 +1,77 @@
+/*
+  Set the frequency of the STP3593LF OCXO in ppb.
+
+  This example shows how to steer the oscillator in physical units. The driver
+  models the reference word - the word which gives zero frequency offset. It is
+  seeded from the first word read, which is the saved value reloaded at start-up,
+  and updateDiscipline refines it while the loop is locked. setFrequencyOffsetPPB
+  converts an offset to a word once, relative to the reference word, and writes it.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  The offsets are only as good as the reference word and the resolution (8E-13 per
+  LSB, or the calibration table if one is in use). If you know the word which puts
+  your oscillator on frequency, pass it to setReferenceWord.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+
+#if !SFE_STP3593LF_FLOATING_POINT_LOOP
+#error This example needs the floating-point loop (SFE_STP3593LF_ENABLE_PI_LOOP, not SFE_STP3593LF_FIXED_POINT)
+#endif
+
+SfeSTP3593LFArdI2C myOCXO;
+
+const double offsets[] = {0.0, 10.0, 100.0, -100.0, -10.0, 0.0}; // ppb
+const uint8_t numOffsets = sizeof(offsets) / sizeof(offsets[0]);
+uint8_t offsetIndex = 0;
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  Wire.begin(); // Begin the I2C bus
+
+  if (!myOCXO.begin())
+  {
+    Serial.println("STP3593LF not detected! Please check the address and try again...");
+    while (1); // Do nothing more
+  }
+
+  Serial.print("Reference word (seeded from the saved value): ");
+  Serial.println(myOCXO.getReferenceWord());
+
+  Serial.println("requested (ppb),word,offset (ppb)");
+}
+
+void loop()
+{
+  if (offsetIndex < numOffsets)
+  {
+    if (myOCXO.setFrequencyOffsetPPB(offsets[offsetIndex]))
+    {
+      Serial.print(offsets[offsetIndex], 1);
+      Serial.print(",");
+      Serial.print(myOCXO.getFrequencyControlWord());
+      Serial.print(",");
+      Serial.println(myOCXO.getFrequencyOffsetPPB(), 6);
+    }
+    else
+      Serial.println("Write failed!");
+
+    offsetIndex++;
+  }
+
+  delay(10000); // Hold each offset for 10 seconds
+}
@@ -0,0 +1,109 @@
+/*
+  Steer a known time offset out of the STP3593LF OCXO.
+
+  This example shows how to remove a phase (time) offset - e.g. after the time
+  of your clock has been stepped by hand - without stepping the clock again.
+  beginPhaseSteering plans a frequency offset which, held for the duration,
+  moves the phase by exactly the correction; updatePhaseSteering applies it one
+  epoch at a time and restores the original word at the end.
+
+  The offset is limited to setMaxFrequencyChangePPB: a correction too large for
+  the duration takes longer. The trajectory holds a constant offset to within
+  one LSB, so a steer takes at most three writes. What is left at the end is
+  the part of the correction smaller than one LSB for one epoch (0.8ps).
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  To keep this example self-contained, the oscillator is simulated on the
+  in-memory (mock) bus: an oscillator which is on frequency at its start-up
+  word. Two corrections are steered out: -500ns over ten minutes, and +2us
+  requested over ten seconds - which is limited to 50ppb, and so takes 40.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+
+#if !SFE_STP3593LF_ENABLE_PI_LOOP
+#error This example needs the discipline loop (SFE_STP3593LF_ENABLE_PI_LOOP)
+#endif
+
+SfeSTP3593LFMock myOCXO;
+
+// Steer out a correction and print the progress. The simulated phase is the time the oscillator has gained
+void steer(int32_t nanos, uint32_t durationEpochs, uint32_t printEpochs)
+{
+  uint32_t onFrequency = myOCXO.getFrequencyControlWord();
+  double phasePicos = 0.0;
+
+  if (!myOCXO.beginPhaseSteering(nanos, durationEpochs))
+  {
+    Serial.println("beginPhaseSteering failed!");
+    return;
+  }
+
+  Serial.print("Steering ");
+  Serial.print(nanos);
+  Serial.print("ns over ");
+  Serial.print(durationEpochs);
+  Serial.print("s. Planned: ");
+  Serial.print(myOCXO.getPhaseSteeringEpochs());
+  Serial.println("s");
+  Serial.println("epoch,progress (%),word,phase (ps),residual (ps)");
+
+  uint32_t epoch = 0;
+  bool running = true;
+  while (running)
+  {
+    // One epoch at the word in effect
+    phasePicos += ((double)myOCXO.getFrequencyControlWord() - (double)onFrequency) * (kSfeSTP3593LFFreqControlResolution * 1.0e12);
+    epoch++;
+
+    running = myOCXO.updatePhaseSteering();
+
+    if (((epoch % printEpochs) == 0) || (!running))
+    {
+      Serial.print(epoch);
+      Serial.print(",");
+      Serial.print(myOCXO.getPhaseSteeringProgress());
+      Serial.print(",");
+      Serial.print(myOCXO.getFrequencyControlWord());
+      Serial.print(",");
+      Serial.print(phasePicos, 1);
+      Serial.print(",");
+      Serial.println((double)myOCXO.getPhaseSteeringResidualPicoseconds(), 0);
+    }
+  }
+
+  Serial.print("Writes: ");
+  Serial.println(myOCXO.getPhaseSteeringWrites());
+  if (myOCXO.getPhaseSteeringResult() != kSfeSTP3593LFSteeringComplete)
+    Serial.println("The original word was not restored!");
+  Serial.println();
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  myOCXO.begin();
+  myOCXO.setMaxFrequencyChangePPB(50);
+
+  steer(-500, 600, 60);
+  steer(2000, 10, 5);
+}
+
+void loop()
+{
+  // Nothing to do here
+}
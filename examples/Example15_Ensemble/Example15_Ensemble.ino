@@ -0,0 +1,147 @@
+/*
+  Hold time through a GNSS outage with an ensemble of STP3593LF OCXOs.
+
+  This example shows how SfeSTP3593LFEnsemble combines several oscillators into
+  one time scale. Each epoch, each oscillator's phase is measured against a
+  common reference; the ensemble weights each oscillator by its stability and
+  steers every one of them towards the weighted time scale. Each output then
+  keeps better time than the oscillator would on its own.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  To keep this example self-contained, the oscillators are simulated on the
+  in-memory (mock) bus, through twenty one-day GNSS outages: four OCXOs, on
+  frequency at the start of each outage, with white and random-walk frequency
+  noise - the fourth three times as noisy as the first. The common reference is
+  a poor local clock (1E-11 white frequency noise): it cancels. Each measurement
+  has 1ps of noise.
+
+  The time errors are against true time, which only the simulation knows:
+    free-running : the RMS time error of the oscillator on its own
+    steered      : the RMS time error of its output, steered to the ensemble
+    ensemble     : the RMS time error of the ensemble time scale
+  over all twenty outages. One outage is a small sample: any one oscillator can be
+  lucky. Averaged, the ensemble beats the best of them.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+#include <SparkFun_STP3593LF_Ensemble.h>
+
+#if !SFE_STP3593LF_FLOATING_POINT_LOOP
+#error This example needs the floating-point loop (SFE_STP3593LF_ENABLE_PI_LOOP, not SFE_STP3593LF_FIXED_POINT)
+#endif
+
+const uint8_t numOscillators = 4;
+const uint32_t outageSeconds = 86400;
+const uint8_t numOutages = 20;
+
+const double whiteFM[numOscillators] = {1.0e-12, 1.5e-12, 2.0e-12, 3.0e-12}; // Per epoch
+const double randomWalkFM[numOscillators] = {1.0e-15, 1.5e-15, 2.0e-15, 3.0e-15}; // Per epoch
+
+// Approximately normal, zero mean, unit variance
+double gaussian(void)
+{
+  double sum = 0.0;
+  for (uint8_t i = 0; i < 12; i++)
+    sum += (double)random(0, 1000000) / 1000000.0;
+  return sum - 6.0;
+}
+
+double freeSquares[numOscillators]; // Sums of squared time errors (seconds^2)
+double steeredSquares[numOscillators];
+double ensembleSquares;
+double weights[numOscillators]; // Sums of the final weights
+
+// Simulate one outage: fresh oscillators and a fresh ensemble
+void simulate(void)
+{
+  SfeSTP3593LFMock myOCXO[numOscillators];
+  SfeSTP3593LFEnsemble myEnsemble;
+
+  uint32_t freeWord[numOscillators];
+  for (uint8_t i = 0; i < numOscillators; i++)
+  {
+    myOCXO[i].begin();
+    myEnsemble.addMember(myOCXO[i]);
+    freeWord[i] = myOCXO[i].getFrequencyControlWord();
+  }
+
+  double freePhase[numOscillators] = {0.0}; // Seconds: the time error of each free-running oscillator
+  double steeringPhase[numOscillators] = {0.0}; // Seconds: the time added by steering
+  double frequency[numOscillators] = {0.0}; // The random-walk part of the frequency
+  double referencePhase = 0.0; // Seconds: the time error of the common reference
+
+  for (uint32_t second = 1; second <= outageSeconds; second++)
+  {
+    // One epoch: the oscillators run at their noisy frequencies, plus steering
+    for (uint8_t i = 0; i < numOscillators; i++)
+    {
+      frequency[i] += randomWalkFM[i] * gaussian();
+      freePhase[i] += frequency[i] + (whiteFM[i] * gaussian());
+      steeringPhase[i] += ((double)myOCXO[i].getFrequencyControlWord() - (double)freeWord[i]) * kSfeSTP3593LFFreqControlResolution;
+    }
+    referencePhase += 1.0e-11 * gaussian();
+
+    // Measure each oscillator against the common reference - and update the ensemble
+    for (uint8_t i = 0; i < numOscillators; i++)
+    {
+      double measured = ((freePhase[i] + steeringPhase[i] - referencePhase) * 1.0e12) + gaussian();
+      myEnsemble.setMemberPhasePicoseconds(i, (int32_t)floor(measured + 0.5));
+    }
+    myEnsemble.update();
+
+    for (uint8_t i = 0; i < numOscillators; i++)
+    {
+      freeSquares[i] += freePhase[i] * freePhase[i];
+      double steered = freePhase[i] + steeringPhase[i];
+      steeredSquares[i] += steered * steered;
+    }
+    double ensemble = (myEnsemble.getEnsemblePhasePicoseconds() * 1.0e-12) + referencePhase;
+    ensembleSquares += ensemble * ensemble;
+  }
+
+  for (uint8_t i = 0; i < numOscillators; i++)
+    weights[i] += myEnsemble.getMemberWeight(i);
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  randomSeed(1);
+
+  for (uint8_t outage = 0; outage < numOutages; outage++)
+    simulate();
+
+  Serial.println("oscillator,mean final weight,free-running RMS (ns),steered RMS (ns)");
+  double samples = (double)outageSeconds * (double)numOutages;
+  for (uint8_t i = 0; i < numOscillators; i++)
+  {
+    Serial.print(i);
+    Serial.print(",");
+    Serial.print(weights[i] / numOutages, 3);
+    Serial.print(",");
+    Serial.print(sqrt(freeSquares[i] / samples) * 1.0e9, 3);
+    Serial.print(",");
+    Serial.println(sqrt(steeredSquares[i] / samples) * 1.0e9, 3);
+  }
+  Serial.print("ensemble RMS (ns): ");
+  Serial.println(sqrt(ensembleSquares / samples) * 1.0e9, 3);
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -0,0 +1,131 @@
+/*
+  Watch the long-term behavior of the disciplined STP3593LF OCXO - per minute, hour and day.
+
+  This example shows how SfeSTP3593LFAggregator keeps running statistics of the
+  frequency control word and the clock bias without storing every sample. Each
+  loop step updates the count, min, max, mean and variance of the minute, the
+  hour and the day in progress; completed intervals are kept in fixed-size rings.
+  Aging shows as the drift of the daily mean word; the temperature cycle shows
+  as the swing of the hourly means.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  To keep this example self-contained, the oscillator and the GNSS receiver are
+  simulated on the in-memory (mock) bus for three days: an oscillator which is
+  20ppb fast at 500000, aging at +1ppb per day, with a +/-2ppb daily temperature
+  cycle and 2ns of bias noise. On hardware, attach the aggregator the same way
+  and query it whenever you like.
+
+  The ring sizes are set by SFE_STP3593LF_MINUTE_AGGREGATES, _HOUR_AGGREGATES
+  and _DAY_AGGREGATES - see SparkFun_STP3593LF_Config.h.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+#include <SparkFun_STP3593LF_Aggregator.h>
+
+#if !SFE_STP3593LF_ENABLE_STATISTICS
+#error This example needs the statistics (SFE_STP3593LF_ENABLE_STATISTICS) and the floating-point loop
+#endif
+
+const uint32_t runSeconds = 3 * 86400;
+
+SfeSTP3593LFMock myOCXO;
+SfeSTP3593LFAggregator aggregates;
+
+void printAggregate(sfeSTP3593LFAggregate_t &word, sfeSTP3593LFAggregate_t &bias)
+{
+  Serial.print(word.mean, 1);
+  Serial.print(",");
+  Serial.print(word.min, 0);
+  Serial.print(",");
+  Serial.print(word.max, 0);
+  Serial.print(",");
+  Serial.print(sqrt(word.variance), 2);
+  Serial.print(",");
+  Serial.print(bias.mean, 3);
+  Serial.print(",");
+  Serial.println(sqrt(bias.variance), 3);
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  myOCXO.begin();
+  myOCXO.setAggregator(&aggregates); // Every setFrequencyBy... call now adds one sample
+
+  randomSeed(1);
+  double phase = 150.0e-9; // Seconds
+  for (uint32_t second = 0; second < runSeconds; second++)
+  {
+    double day = (double)second / 86400.0;
+    double offset = 20.0e-9 + (day * 1.0e-9) + (2.0e-9 * sin(2.0 * PI * day)); // Aging and the temperature cycle
+    phase += offset + (((double)myOCXO.getFrequencyControlWord() - 500000.0) * kSfeSTP3593LFFreqControlResolution);
+    double noise = ((double)random(-1000, 1001)) * 2.0e-12;
+    myOCXO.setFrequencyByBiasMillis((phase + noise) * 1000.0); // Bias in millis
+  }
+
+  Serial.print("Samples: ");
+  Serial.print(aggregates.getSampleCount());
+  Serial.print("  Elapsed (s): ");
+  Serial.println(aggregates.getElapsedSeconds());
+  Serial.println();
+
+  sfeSTP3593LFAggregate_t word, bias;
+
+  // The last day, hour by hour - oldest first
+  Serial.println("hour,word mean,word min,word max,word std dev,bias mean (ns),bias std dev (ns)");
+  uint8_t hours = aggregates.getAggregateCount(kSfeSTP3593LFPerHour);
+  for (uint8_t age = hours; age >= 1; age--)
+  {
+    aggregates.getAggregate(kSfeSTP3593LFSeriesWord, kSfeSTP3593LFPerHour, age, word);
+    aggregates.getAggregate(kSfeSTP3593LFSeriesInput, kSfeSTP3593LFPerHour, age, bias);
+    Serial.print("-");
+    Serial.print(age);
+    Serial.print(",");
+    printAggregate(word, bias);
+  }
+  Serial.println();
+
+  // Each day - the daily mean word drifts by the aging: +1ppb is 1250 LSBs
+  Serial.println("day,word mean,word min,word max,word std dev,bias mean (ns),bias std dev (ns)");
+  uint8_t days = aggregates.getAggregateCount(kSfeSTP3593LFPerDay);
+  for (uint8_t age = days; age >= 1; age--)
+  {
+    aggregates.getAggregate(kSfeSTP3593LFSeriesWord, kSfeSTP3593LFPerDay, age, word);
+    aggregates.getAggregate(kSfeSTP3593LFSeriesInput, kSfeSTP3593LFPerDay, age, bias);
+    Serial.print("-");
+    Serial.print(age);
+    Serial.print(",");
+    printAggregate(word, bias);
+  }
+  Serial.println();
+
+  // Combine intervals: the last 6 hours. The result is the same as one pass over every sample
+  unsigned long start = micros();
+  aggregates.getSummary(kSfeSTP3593LFSeriesWord, kSfeSTP3593LFPerHour, 6, word);
+  aggregates.getSummary(kSfeSTP3593LFSeriesInput, kSfeSTP3593LFPerHour, 6, bias);
+  unsigned long took = micros() - start;
+  Serial.println("summary,word mean,word min,word max,word std dev,bias mean (ns),bias std dev (ns)");
+  Serial.print("last 6h,");
+  printAggregate(word, bias);
+  Serial.print("Query time (us): ");
+  Serial.println(took);
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -0,0 +1,112 @@
+/*
+  Forecast when aging will pull the STP3593LF OCXO to the end of its control range.
+
+  This example shows how getPullRangeForecast predicts the time left before the
+  disciplined control word reaches 0 or 1000000 - after which the loop can no
+  longer correct the frequency. Each hour, the mean control word is added to a
+  least-squares trend; the forecast is the distance to the rail over the trend,
+  with bounds from the trend's uncertainty. getPullRangeWarning is raised when
+  the earliest time to a rail falls below setPullRangeWarningDays: time to
+  schedule a recalibration or a replacement.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  To keep this example self-contained, the oscillator and the GNSS receiver are
+  simulated on the in-memory (mock) bus for 40 days: an oscillator which is
+  already 300ppb fast (a word of 125000), aging at +2ppb per day - 2500 LSBs per
+  day towards 0 - with a +/-3ppb daily temperature cycle and 2ns of bias noise.
+  It reaches the rail after ~50 days.
+
+  The trend survives a restart in the warm-start snapshot (see Example09).
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+
+#if !SFE_STP3593LF_ENABLE_STATISTICS
+#error This example needs the statistics (SFE_STP3593LF_ENABLE_STATISTICS) and the floating-point loop
+#endif
+
+const uint32_t runDays = 40;
+const double warningDays = 30.0;
+
+SfeSTP3593LFMock myOCXO;
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+  myOCXO.begin();
+  myOCXO.setFrequencyControlWord(125000); // Where the last calibration left it
+  myOCXO.setPullRangeWarningDays(warningDays);
+
+  Serial.println("day,word,trend (LSB/day),forecast (days),earliest (days),latest (days),true (days),warning");
+
+  randomSeed(1);
+  double phase = 0.0; // Seconds
+  bool warned = false;
+  for (uint32_t second = 1; second <= (runDays * 86400); second++)
+  {
+    double day = (double)second / 86400.0;
+    double offset = 300.0e-9 + (day * 2.0e-9) + (3.0e-9 * sin(2.0 * PI * day)); // Aging and the temperature cycle
+    phase += offset + (((double)myOCXO.getFrequencyControlWord() - 500000.0) * kSfeSTP3593LFFreqControlResolution);
+    double noise = ((double)random(-1000, 1001)) * 2.0e-12;
+    myOCXO.setFrequencyByBiasMillis((phase + noise) * 1000.0); // Bias in millis
+
+    if ((!warned) && myOCXO.getPullRangeWarning())
+    {
+      warned = true;
+      Serial.print("Warning raised at day ");
+      Serial.println(day, 2);
+    }
+
+    if ((second % (2 * 86400)) != 0) // Report every other day
+      continue;
+
+    double days, earliestDays, latestDays;
+    bool valid = myOCXO.getPullRangeForecast(days, earliestDays, latestDays);
+
+    // The truth: the word which cancels the mean offset reaches 0 when 500000 * 8E-13 = 400ppb
+    double trueDays = ((400.0e-9 - 300.0e-9) / 2.0e-9) - day;
+
+    Serial.print(day, 0);
+    Serial.print(",");
+    Serial.print(myOCXO.getFrequencyControlWord());
+    Serial.print(",");
+    Serial.print(myOCXO.getPullRangeTrendPerDay(), 1);
+    Serial.print(",");
+    if (valid)
+    {
+      Serial.print(days, 1);
+      Serial.print(",");
+      Serial.print(earliestDays, 1);
+      Serial.print(",");
+      if (latestDays < kSfeSTP3593LFPullRangeNeverDays)
+        Serial.print(latestDays, 1);
+      else
+        Serial.print("never");
+    }
+    else
+      Serial.print("-,-,-");
+    Serial.print(",");
+    Serial.print(trueDays, 1);
+    Serial.print(",");
+    Serial.println(myOCXO.getPullRangeWarning() ? "yes" : "no");
+  }
+}
+
+void loop()
+{
+  // Nothing to do here
+}
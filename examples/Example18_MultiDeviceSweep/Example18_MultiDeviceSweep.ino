@@ -0,0 +1,178 @@
+/*
+  Time a sweep across several STP3593LF OCXOs on one I2C bus.
+
+  This example shows how the time to read and write every oscillator grows
+  with the number of oscillators and the bus clock. Each sweep reads the
+  frequency control word of every oscillator, then writes it back nudged by
+  one LSB - what a multi-oscillator loop does each second. The sweep time is
+  measured at 100kHz and 400kHz, for 1, 2, 4... of the oscillators, and compared
+  with the bus time: 9 bits per byte.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  The real STP3593LF is fixed at 0x70, so several on one bus need a
+  multiplexer. To benchmark without a rack of hardware, run the
+  STP3593LF_Emulator sketch on another board: it emulates one independent
+  oscillator per I2C port, at the addresses in its deviceConfigs table. Put
+  the same addresses in ocxoAddresses below. Oscillators which do not begin
+  are left out of the sweep. The emulator answers one address per I2C port,
+  so it emulates only as many oscillators as the board has ports.
+
+  To sweep more oscillators - or to run without hardware, e.g. on a host
+  build - set SWEEP_MOCK_PORT to 1. The sweep then runs on an in-memory port
+  (SfeSTP3593LFMockPort) with numOCXOs oscillators, up to
+  kSfeSTP3593LFMockMaxDevices. The sweep times are then the library's own CPU
+  time, and the bus time is from the bytes the port counted.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+
+#ifndef SWEEP_MOCK_PORT
+#define SWEEP_MOCK_PORT 0 // Change this to 1 to sweep oscillators on the in-memory port instead of Wire
+#endif
+
+#if SWEEP_MOCK_PORT
+#include <SparkFun_STP3593LF_MockBus.h>
+
+const int numOCXOs = 8; // Up to kSfeSTP3593LFMockMaxDevices. At 0x70, 0x71...
+
+SfeSTP3593LFMockPort myPort;
+SfeSTP3593LFMock myOCXOs[numOCXOs];
+#else
+const uint8_t ocxoAddresses[] = { 0x70, 0x71 }; // Change these to match the emulator
+const int numOCXOs = sizeof(ocxoAddresses) / sizeof(ocxoAddresses[0]);
+
+SfeSTP3593LFArdI2C myOCXOs[numOCXOs];
+#endif
+
+bool begun[numOCXOs];
+
+const uint32_t sweeps = 100;
+const uint32_t busClocks[] = { 100000, 400000 };
+
+// The bytes on the bus per oscillator: the read (address, register, address, 4 bytes)
+// and the write (address, register, 4 bytes)
+const uint32_t readBytes = 7;
+const uint32_t writeBytes = 6;
+
+// Sweep the first count oscillators which have begun
+void runSweeps(uint32_t busClock, int count)
+{
+#if SWEEP_MOCK_PORT
+  myPort.resetCounters();
+#else
+  Wire.setClock(busClock);
+#endif
+
+  int swept = 0;
+  int last = 0; // One past the last oscillator in the sweep
+  while ((last < numOCXOs) && (swept < count))
+  {
+    if (begun[last])
+      swept++;
+    last++;
+  }
+
+  uint32_t failures = 0;
+  unsigned long readMicros = 0;
+  unsigned long writeMicros = 0;
+  for (uint32_t sweep = 0; sweep < sweeps; sweep++)
+  {
+    unsigned long startMicros = micros();
+    for (int i = 0; i < last; i++)
+    {
+      if (begun[i] && (!myOCXOs[i].readFrequencyControlWord()))
+        failures++;
+    }
+    unsigned long midMicros = micros();
+    for (int i = 0; i < last; i++)
+    {
+      if (begun[i] && (!myOCXOs[i].adjustFrequencyControlWord((sweep & 1) ? -1 : 1)))
+        failures++;
+    }
+    unsigned long endMicros = micros();
+    readMicros += midMicros - startMicros;
+    writeMicros += endMicros - midMicros;
+  }
+
+#if SWEEP_MOCK_PORT
+  double busMicros = (double)myPort.getBusMicros(busClock) / (double)sweeps; // From the bytes the port counted
+#else
+  double busMicros = (double)(swept * (readBytes + writeBytes)) * 9.0 * 1.0e6 / (double)busClock;
+#endif
+
+  Serial.print(busClock);
+  Serial.print(",");
+  Serial.print(swept);
+  Serial.print(",");
+  Serial.print((double)readMicros / (double)sweeps, 1);
+  Serial.print(",");
+  Serial.print((double)writeMicros / (double)sweeps, 1);
+  Serial.print(",");
+  Serial.print((double)(readMicros + writeMicros) / (double)sweeps / (double)(swept > 0 ? swept : 1), 1);
+  Serial.print(",");
+  Serial.print(busMicros, 1);
+  Serial.print(",");
+  Serial.println(failures);
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Example");
+
+#if SWEEP_MOCK_PORT
+  for (int i = 0; i < numOCXOs; i++)
+    myPort.addDevice(0x70 + i, 500000 + (i * 1000)); // Each oscillator at a different word
+#else
+  Wire.begin(); // Begin the I2C bus
+#endif
+
+  for (int i = 0; i < numOCXOs; i++)
+  {
+#if SWEEP_MOCK_PORT
+    uint8_t address = 0x70 + i;
+    begun[i] = myOCXOs[i].begin(myPort, address);
+#else
+    uint8_t address = ocxoAddresses[i];
+    begun[i] = myOCXOs[i].begin(Wire, address);
+#endif
+    Serial.print("0x");
+    Serial.print(address, HEX);
+    if (begun[i])
+    {
+      Serial.print(" word: ");
+      Serial.println(myOCXOs[i].getFrequencyControlWord());
+    }
+    else
+      Serial.println(" not detected");
+  }
+
+  Serial.println("bus clock (Hz),oscillators,read sweep (us),write sweep (us),per oscillator (us),bus time (us),failures");
+
+  for (unsigned int i = 0; i < (sizeof(busClocks) / sizeof(busClocks[0])); i++)
+  {
+    for (int count = 1; count < numOCXOs; count *= 2)
+      runSweeps(busClocks[i], count);
+    runSweeps(busClocks[i], numOCXOs);
+  }
+
+#if !SWEEP_MOCK_PORT
+  Wire.setClock(100000);
+#endif
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -1,5 +1,5 @@
 /*
-  Emulate the STP3593LF OCXO.
+  Emulate one or more STP3593LF OCXOs.
 
   By: Paul Clark
   SparkFun Electronics
@@ -7,51 +7,753 @@
   SparkFun code, firmware, and software is released under the MIT License.
   Please see LICENSE.md for further details.
 
-  Note: This code doesn't update the registerAddress correctly - on ESP32 (3.0.1).
-        registerAddress is only updated _after_ the registers have been read...
+  The emulator models the registers the library uses:
+    0x41 : Read Frequency Control - reports the 32-bit frequency control word (MSB first)
+    0xA0 : Write DAC - sets the frequency control word (MSB first). Limited to 1000000
+    0xC2 : Save Frequency Control Value - saves the word to non-volatile memory
+  Reading any other register returns 0xFF.
+
+  Several oscillators: each entry in deviceConfigs is an independent oscillator
+  - its own address, register file, saved word and frequency model. An Arduino
+  I2C port answers one address, so each oscillator needs its own port (Wire,
+  Wire1...) and the ports' SDA and SCL pins are joined to the same bus. The
+  number of oscillators is limited by the ports the board has: two on ESP32 and
+  RP2040, up to MAX_DEVICES here. For more, run the emulator on several boards
+  with different addresses. The real STP3593LF is fixed at 0x70: the driver
+  takes any address (begin(Wire, address)) so firmware can sweep the emulated
+  oscillators - see Example18_MultiDeviceSweep.
+
+  The saved words are kept in EEPROM and reloaded at power-up - or when p
+  (power cycle) is sent over Serial. e erases them: the next power-up loads
+  the factory value (500000). The save is written from loop(), not from the
+  I2C handler, so the bus is not held up while the EEPROM is busy. On cores
+  without EEPROM (e.g. SAMD) the saved words are kept in RAM: p reloads them,
+  but a reset of the emulator board loads the factory value.
+
+  Fault scenarios: faults are injected by commands sent over Serial, one per
+  line - typed, or sent by a host script. The oscillator is chosen by address:
+    nak <address> <ms>               Stop answering (NAK) for ms
+    delay <address> <us> [count]     Stretch the clock for us before each of the next count reads
+    range <address> [word] [count]   Report word (default 2000000) for the next count reads
+    reset <address>                  Revert to the saved word - an oscillator reset
+    corrupt <address> [mask] [count] XOR mask (default 0x1) into the next count words read
+    @<ms> <fault command>            Schedule a fault ms after run
+    run                              Start - or restart - the schedule
+    clear                            Clear the schedule
+    list                             List the schedule
+  count defaults to 1. Numbers may be hex (0x...). For example:
+    @1000 nak 0x70 300
+    @5000 reset 0x70
+    @9000 corrupt 0x70 0x10000 2
+    run
+  Each fault is printed (with millis) when it is injected. When it is over -
+  the NAK burst ends, the last faulty read is served or the reset happens - the
+  emulator times the master's next DAC write and prints it: how long the
+  firmware took to detect the fault and recover. Faults injected are counted
+  in the once-per-second status.
+
+  A NAK burst is made by ending the oscillator's I2C port and beginning it
+  again - the address is then not acknowledged. A delay stretches the clock
+  while the request handler waits; on the original ESP32 the response is queued
+  before the read, so the delay does not reach the bus there.
+
+  The frequency output responds to the DAC: a 10MHz oscillator which is
+  intrinsicOffset fast at 500000, pulled by 8E-13 per LSB. Once per second the
+  emulator prints each oscillator's word, saved word, output frequency and the
+  phase accumulated against a perfect 10MHz.
+
+  The register pointer: on most cores the pointer byte is received before the
+  master's read is requested, and the read is answered from the register it
+  points at. The original ESP32 only delivers the pointer after the read has
+  completed, so there the 0x41 response is preloaded (slaveWrite) after every
+  transaction instead - 0x41 being the only readable register. Either way the
+  first read after begin returns the correct word: no double read is needed.
 
 */
 
 #include <Wire.h>
 
-#define I2C_DEV_ADDR 0x70
+// The saved words are kept in EEPROM on the cores which have it. Elsewhere (e.g. SAMD, mbed)
+// they are kept in RAM: they survive p (power cycle) but not a real reset of the emulator
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_MEGAAVR) || defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || (defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED)) || defined(ARDUINO_ARCH_STM32) || defined(TEENSYDUINO)
+#define HAVE_EEPROM 1
+#else
+#define HAVE_EEPROM 0
+#endif
+
+#if HAVE_EEPROM && (defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266) || defined(ARDUINO_ARCH_RP2040))
+#define EEPROM_IN_FLASH 1 // These cores emulate EEPROM in flash: begin and commit are needed
+#else
+#define EEPROM_IN_FLASH 0
+#endif
+
+#if HAVE_EEPROM
+#include <EEPROM.h>
+#endif
+
+// The registers
+#define REG_READ_FREQUENCY_CONTROL 0x41
+#define REG_WRITE_DAC 0xA0
+#define REG_SAVE_FREQUENCY 0xC2
 
-// Emulate a single 32-bit register for reading and writing
-// Although, in reality, data is read from 0x41 and written to 0xA0
 #define NUM_REG_BYTES (4)
-volatile uint8_t registerBytes[NUM_REG_BYTES] = { 0x00, 0x07, 0xA1, 0x20 }; // Default to 500000 (MSB first)
-volatile uint8_t registerAddress = 0;
+
+#define MAX_DEVICES (4) // One set of I2C handlers per device - see below
+
+#if defined(CONFIG_IDF_TARGET_ESP32)
+#define PRELOAD_RESPONSE 1 // The original ESP32 delivers the register pointer after the read
+#else
+#define PRELOAD_RESPONSE 0
+#endif
+
+#if defined(ARDUINO_ARCH_RP2040) || (defined(SOC_I2C_NUM) && (SOC_I2C_NUM > 1)) || (defined(SOC_HP_I2C_NUM) && (SOC_HP_I2C_NUM > 1)) || (defined(WIRE_INTERFACES_COUNT) && (WIRE_INTERFACES_COUNT > 1))
+#define HAVE_WIRE1 1
+#else
+#define HAVE_WIRE1 0
+#endif
+
+// The configuration of one emulated oscillator
+typedef struct
+{
+  uint8_t address; // The I2C address
+  TwoWire *port; // The I2C port. One oscillator per port
+  int sda; // The SDA pin. -1 for the port's default
+  int scl; // The SCL pin. -1 for the port's default
+  double intrinsicOffset; // The fractional frequency offset at 500000
+} deviceConfig_t;
+
+// The emulated oscillators. Change these to suit your board. On ESP32 and RP2040,
+// Wire1 has no default pins on many boards: set its sda and scl to pins joined to the bus
+const deviceConfig_t deviceConfigs[] = {
+  { 0x70, &Wire, -1, -1, 20.0e-9 },
+#if HAVE_WIRE1
+  { 0x71, &Wire1, -1, -1, -35.0e-9 },
+#endif
+};
+
+const int numDevices = sizeof(deviceConfigs) / sizeof(deviceConfigs[0]);
+
+const uint32_t maxWord = 1000000;
+const uint32_t factoryWord = 500000;
+const double nominalHz = 10.0e6;
+const double resolution = 8.0e-13; // Fractional frequency per LSB
+
+// The non-volatile memory of each oscillator: magic (2), word (4), inverted word (4)
+const int nvmAddress = 0;
+const int nvmSize = 10;
+const uint8_t nvmMagic[2] = { 'S', 'P' };
+
+// The faults
+typedef enum
+{
+  FAULT_NAK = 0,
+  FAULT_DELAY,
+  FAULT_RANGE,
+  FAULT_RESET,
+  FAULT_CORRUPT,
+  NUM_FAULTS
+} fault_t;
+
+const char *const faultNames[NUM_FAULTS] = { "nak", "delay", "range", "reset", "corrupt" };
+
+// A fault - injected now or scheduled
+typedef struct
+{
+  uint32_t atMillis; // When to inject the fault - after run
+  uint8_t device; // The oscillator
+  uint8_t fault; // The fault_t
+  uint32_t value; // The NAK ms, delay us, word or corruption mask
+  uint32_t count; // The number of reads affected
+  bool injected; // true once a scheduled fault has been injected
+} faultEvent_t;
+
+#define MAX_EVENTS (16)
+
+faultEvent_t schedule[MAX_EVENTS]; // The scheduled faults
+int numEvents = 0;
+bool scheduleRunning = false;
+unsigned long scheduleStartMillis = 0;
+
+// The state of one emulated oscillator
+typedef struct
+{
+  volatile uint32_t dacWord; // The frequency control word in use
+  volatile uint8_t registerPointer; // Set by the first byte of each write
+  volatile bool savePending; // 0xC2 received - the save is done in loop()
+  volatile uint32_t dacWrites; // The number of 0xA0 writes
+  volatile uint32_t reads; // The number of reads
+  volatile uint32_t malformed; // The number of writes with the wrong length
+  uint32_t savedWord; // The word in the non-volatile memory
+  bool savedValid; // true if the non-volatile memory holds a word
+  uint32_t saves; // The number of saves
+  double phaseSeconds; // The phase of the output against a perfect 10MHz
+
+  // The faults in progress
+  bool nakActive; // true while the port is ended
+  unsigned long nakEndMillis; // When the NAK burst ends
+  volatile uint32_t delayMicros; // The clock stretch of each delayed read
+  volatile uint32_t delayCount; // The number of reads still to delay
+  volatile uint32_t rangeWord; // The word reported by out-of-range reads
+  volatile uint32_t rangeCount; // The number of reads still to report rangeWord
+  volatile uint32_t corruptMask; // XORed into corrupted reads
+  volatile uint32_t corruptCount; // The number of reads still to corrupt
+  uint32_t faults; // The number of faults injected
+
+  // The recovery: the time from the end of a fault to the master's next DAC write
+  volatile bool recoveryPending; // A fault has ended. Waiting for a DAC write
+  volatile bool recoveryReport; // A recovery time is waiting to be printed
+  volatile unsigned long faultEndMillis; // When the last fault ended
+  volatile unsigned long recoveryMillis; // The time from faultEndMillis to the DAC write
+} emulatedOCXO_t;
+
+emulatedOCXO_t devices[numDevices];
+
+// Fill bytes with the response for a read at register
+void fillResponse(int device, uint8_t reg, uint8_t *bytes)
+{
+  if (reg != REG_READ_FREQUENCY_CONTROL)
+  {
+    for (int i = 0; i < NUM_REG_BYTES; i++)
+      bytes[i] = 0xFF; // Not a readable register
+    return;
+  }
+
+  emulatedOCXO_t &ocxo = devices[device];
+  uint32_t word = ocxo.dacWord;
+  if (ocxo.rangeCount > 0)
+    word = ocxo.rangeWord;
+  if (ocxo.corruptCount > 0)
+    word ^= ocxo.corruptMask;
+  bytes[0] = (uint8_t)(word >> 24); // MSB first
+  bytes[1] = (uint8_t)(word >> 16);
+  bytes[2] = (uint8_t)(word >> 8);
+  bytes[3] = (uint8_t)(word >> 0);
+}
+
+#if PRELOAD_RESPONSE
+// Queue the 0x41 response for the next read. slaveWrite replaces any response still queued
+void preloadResponse(int device)
+{
+  uint8_t bytes[NUM_REG_BYTES];
+  fillResponse(device, REG_READ_FREQUENCY_CONTROL, bytes);
+  deviceConfigs[device].port->slaveWrite(bytes, NUM_REG_BYTES);
+}
+#endif
+
+// A fault is over: time the master's next DAC write
+void faultEnded(int device)
+{
+  emulatedOCXO_t &ocxo = devices[device];
+  ocxo.faultEndMillis = millis();
+  ocxo.recoveryPending = true;
+}
+
+// Use up one read of a count-based fault
+void consumeFaultRead(int device, volatile uint32_t &count)
+{
+  if (count == 0)
+    return;
+  count = count - 1;
+  if (count == 0)
+    faultEnded(device);
+}
 
 // On Request:
-// Write bytes from registerBytes
-void requestHandler()
+// Write the bytes of the register the pointer selects
+void onRequest(int device)
 {
-  // Ignore registerAddress
-  for (int i = 0; i < NUM_REG_BYTES; i++)
-    Wire.write(registerBytes[i]);
+  emulatedOCXO_t &ocxo = devices[device];
+
+  if (ocxo.delayCount > 0)
+  {
+    uint32_t stretch = ocxo.delayMicros; // The clock is stretched while the handler waits
+    while (stretch > 10000)
+    {
+      delayMicroseconds(10000);
+      stretch -= 10000;
+    }
+    delayMicroseconds(stretch);
+  }
+
+#if PRELOAD_RESPONSE
+  bool wordRead = true; // The preloaded response is always the word
+#else
+  uint8_t bytes[NUM_REG_BYTES];
+  fillResponse(device, ocxo.registerPointer, bytes);
+  deviceConfigs[device].port->write(bytes, NUM_REG_BYTES);
+  bool wordRead = (ocxo.registerPointer == REG_READ_FREQUENCY_CONTROL);
+#endif
+  ocxo.reads = ocxo.reads + 1;
+
+  if (wordRead)
+  {
+    consumeFaultRead(device, ocxo.delayCount);
+    consumeFaultRead(device, ocxo.rangeCount);
+    consumeFaultRead(device, ocxo.corruptCount);
+  }
 }
 
 // On Receive:
-// Copy the first incoming byte into registerAddress (see notes above)
-// Copy the remaining bytes into registerBytes
-void receiveHandler(int len)
+// The first byte is the register pointer. 0xA0 is followed by the four bytes of the word
+void onReceive(int device)
 {
-  int count = -1;
-  while (Wire.available())
+  emulatedOCXO_t &ocxo = devices[device];
+  TwoWire *port = deviceConfigs[device].port;
+
+  uint8_t bytes[1 + NUM_REG_BYTES];
+  int count = 0;
+  while (port->available())
   {
-    uint8_t b = Wire.read();
-    switch (count)
+    uint8_t b = port->read();
+    if (count < (1 + NUM_REG_BYTES))
+      bytes[count] = b;
+    count++;
+  }
+
+  if (count > 0) // Zero bytes is a ping
+  {
+    ocxo.registerPointer = bytes[0];
+
+    if (ocxo.registerPointer == REG_WRITE_DAC)
     {
-      case -1:
-        registerAddress = b;
-        break;
-      default:
-        // Ignore registerAddress
-        if (count < NUM_REG_BYTES)
-          registerBytes[count] = b;
-        break;
+      if (count == (1 + NUM_REG_BYTES))
+      {
+        uint32_t word = ((uint32_t)bytes[1]) << 24;
+        word |= ((uint32_t)bytes[2]) << 16;
+        word |= ((uint32_t)bytes[3]) << 8;
+        word |= ((uint32_t)bytes[4]) << 0;
+        if (word > maxWord)
+          word = maxWord;
+        ocxo.dacWord = word;
+        ocxo.dacWrites = ocxo.dacWrites + 1;
+        if (ocxo.recoveryPending)
+        {
+          ocxo.recoveryMillis = millis() - ocxo.faultEndMillis;
+          ocxo.recoveryPending = false;
+          ocxo.recoveryReport = true;
+        }
+      }
+      else if (count > 1) // A pointer only is fine: a read of 0xA0 returns 0xFF
+        ocxo.malformed = ocxo.malformed + 1;
     }
-    count++;
+    else if (ocxo.registerPointer == REG_SAVE_FREQUENCY)
+    {
+      if (count == 1)
+        ocxo.savePending = true;
+      else
+        ocxo.malformed = ocxo.malformed + 1;
+    }
+    else if ((ocxo.registerPointer == REG_READ_FREQUENCY_CONTROL) && (count != 1))
+      ocxo.malformed = ocxo.malformed + 1; // Read-only
+  }
+
+#if PRELOAD_RESPONSE
+  preloadResponse(device); // The word may have changed - and a read may just have used the response
+#endif
+}
+
+// The I2C handlers take no context: one pair per device, up to MAX_DEVICES
+void receiveHandler0(int) { onReceive(0); }
+void receiveHandler1(int) { onReceive(1); }
+void receiveHandler2(int) { onReceive(2); }
+void receiveHandler3(int) { onReceive(3); }
+void requestHandler0() { onRequest(0); }
+void requestHandler1() { onRequest(1); }
+void requestHandler2() { onRequest(2); }
+void requestHandler3() { onRequest(3); }
+
+void (*const receiveHandlers[MAX_DEVICES])(int) = { receiveHandler0, receiveHandler1, receiveHandler2, receiveHandler3 };
+void (*const requestHandlers[MAX_DEVICES])() = { requestHandler0, requestHandler1, requestHandler2, requestHandler3 };
+
+static_assert(numDevices <= MAX_DEVICES, "Add handlers for the extra devices");
+
+#if !HAVE_EEPROM
+uint8_t nvmRAM[MAX_DEVICES * nvmSize]; // Zero at reset: no valid magic, so the factory word is loaded
+#endif
+
+// Read one byte of the non-volatile memory
+uint8_t readNVMByte(int address)
+{
+#if HAVE_EEPROM
+  return EEPROM.read(address);
+#else
+  return nvmRAM[address - nvmAddress];
+#endif
+}
+
+// Read the saved word from the non-volatile memory
+void loadNVM(int device)
+{
+  emulatedOCXO_t &ocxo = devices[device];
+  int address = nvmAddress + (device * nvmSize);
+
+  uint8_t bytes[nvmSize];
+  for (int i = 0; i < nvmSize; i++)
+    bytes[i] = readNVMByte(address + i);
+
+  uint32_t word = 0;
+  uint32_t inverted = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    word |= ((uint32_t)bytes[2 + i]) << (8 * i);
+    inverted |= ((uint32_t)bytes[6 + i]) << (8 * i);
+  }
+
+  ocxo.savedValid = (bytes[0] == nvmMagic[0]) && (bytes[1] == nvmMagic[1]) && (word == (~inverted)) && (word <= maxWord);
+  ocxo.savedWord = ocxo.savedValid ? word : factoryWord;
+}
+
+// Write the non-volatile memory. Only the bytes which have changed are written
+void writeNVM(int device, const uint8_t *bytes)
+{
+  int address = nvmAddress + (device * nvmSize);
+  for (int i = 0; i < nvmSize; i++)
+  {
+#if HAVE_EEPROM
+    if (EEPROM.read(address + i) != bytes[i])
+      EEPROM.write(address + i, bytes[i]);
+#else
+    nvmRAM[address - nvmAddress + i] = bytes[i];
+#endif
+  }
+#if EEPROM_IN_FLASH
+  EEPROM.commit();
+#endif
+}
+
+// Save a word to the non-volatile memory
+void saveNVM(int device, uint32_t word)
+{
+  emulatedOCXO_t &ocxo = devices[device];
+  uint8_t bytes[nvmSize];
+  bytes[0] = nvmMagic[0];
+  bytes[1] = nvmMagic[1];
+  for (int i = 0; i < 4; i++)
+  {
+    bytes[2 + i] = (uint8_t)(word >> (8 * i));
+    bytes[6 + i] = (uint8_t)((~word) >> (8 * i));
+  }
+  writeNVM(device, bytes);
+  ocxo.savedWord = word;
+  ocxo.savedValid = true;
+  ocxo.saves++;
+}
+
+// Erase the non-volatile memory
+void eraseNVM(int device)
+{
+  emulatedOCXO_t &ocxo = devices[device];
+  uint8_t bytes[nvmSize];
+  for (int i = 0; i < nvmSize; i++)
+    bytes[i] = 0xFF;
+  writeNVM(device, bytes);
+  ocxo.savedWord = factoryWord;
+  ocxo.savedValid = false;
+}
+
+// Power up: the DAC starts at the saved word
+void powerUp(int device)
+{
+  emulatedOCXO_t &ocxo = devices[device];
+  loadNVM(device);
+  noInterrupts();
+  ocxo.dacWord = ocxo.savedWord;
+  ocxo.registerPointer = REG_READ_FREQUENCY_CONTROL;
+  ocxo.savePending = false;
+  interrupts();
+}
+
+// Read a volatile word consistently - it is written by the I2C handler
+uint32_t readDACWord(int device)
+{
+  noInterrupts();
+  uint32_t word = devices[device].dacWord;
+  interrupts();
+  return word;
+}
+
+// The fractional frequency offset of the output for a word
+double fractionalOffset(int device, uint32_t word)
+{
+  return deviceConfigs[device].intrinsicOffset + (((double)word - (double)factoryWord) * resolution);
+}
+
+// Print the address of a device
+void printAddress(int device)
+{
+  Serial.print("0x");
+  Serial.print(deviceConfigs[device].address, HEX);
+  Serial.print("  ");
+}
+
+// Begin a device's I2C port as a target at its address
+void beginPort(int device)
+{
+  const deviceConfig_t &config = deviceConfigs[device];
+  config.port->onReceive(receiveHandlers[device]);
+  config.port->onRequest(requestHandlers[device]);
+#if defined(ARDUINO_ARCH_ESP32)
+  config.port->begin(config.address, config.sda, config.scl, (uint32_t)0);
+#elif defined(ARDUINO_ARCH_RP2040)
+  if ((config.sda >= 0) && (config.scl >= 0))
+  {
+    config.port->setSDA(config.sda);
+    config.port->setSCL(config.scl);
+  }
+  config.port->begin(config.address);
+#else
+  config.port->begin(config.address);
+#endif
+#if PRELOAD_RESPONSE
+  preloadResponse(device);
+#endif
+}
+
+// Print a fault
+void printFault(const faultEvent_t &event)
+{
+  printAddress(event.device);
+  Serial.print(faultNames[event.fault]);
+  if (event.fault != FAULT_RESET)
+  {
+    Serial.print(" ");
+    Serial.print(event.value);
+  }
+  if ((event.fault == FAULT_DELAY) || (event.fault == FAULT_RANGE) || (event.fault == FAULT_CORRUPT))
+  {
+    Serial.print(" x");
+    Serial.print(event.count);
+  }
+}
+
+// Inject a fault now
+void injectFault(const faultEvent_t &event)
+{
+  int device = event.device;
+  emulatedOCXO_t &ocxo = devices[device];
+
+  switch (event.fault)
+  {
+  case FAULT_NAK:
+    if (!ocxo.nakActive)
+      deviceConfigs[device].port->end(); // The address is no longer acknowledged
+    ocxo.nakActive = true;
+    ocxo.nakEndMillis = millis() + event.value;
+    break;
+  case FAULT_DELAY:
+    noInterrupts();
+    ocxo.delayMicros = event.value;
+    ocxo.delayCount = event.count;
+    interrupts();
+    break;
+  case FAULT_RANGE:
+    noInterrupts();
+    ocxo.rangeWord = event.value;
+    ocxo.rangeCount = event.count;
+    interrupts();
+    break;
+  case FAULT_RESET:
+    powerUp(device); // Back to the saved word
+    faultEnded(device);
+    break;
+  case FAULT_CORRUPT:
+    noInterrupts();
+    ocxo.corruptMask = event.value;
+    ocxo.corruptCount = event.count;
+    interrupts();
+    break;
+  default:
+    return;
+  }
+
+#if PRELOAD_RESPONSE
+  if (!ocxo.nakActive)
+    preloadResponse(device); // The next read reports the fault
+#endif
+
+  ocxo.faults++;
+  Serial.print(millis());
+  Serial.print(" ms  ");
+  printFault(event);
+  Serial.println();
+}
+
+// End the NAK bursts which are over
+void serviceNAK(void)
+{
+  for (int device = 0; device < numDevices; device++)
+  {
+    emulatedOCXO_t &ocxo = devices[device];
+    if (ocxo.nakActive && ((long)(millis() - ocxo.nakEndMillis) >= 0))
+    {
+      ocxo.nakActive = false;
+      beginPort(device);
+      faultEnded(device);
+    }
+  }
+}
+
+// Inject the scheduled faults which are due
+void serviceSchedule(void)
+{
+  if (!scheduleRunning)
+    return;
+
+  bool pending = false;
+  for (int i = 0; i < numEvents; i++)
+  {
+    if (schedule[i].injected)
+      continue;
+    if ((millis() - scheduleStartMillis) >= schedule[i].atMillis)
+    {
+      schedule[i].injected = true;
+      injectFault(schedule[i]);
+    }
+    else
+      pending = true;
+  }
+
+  if (!pending)
+  {
+    scheduleRunning = false;
+    Serial.println("Schedule complete");
+  }
+}
+
+// Parse a number - decimal or hex (0x...)
+bool parseNumber(const char *token, uint32_t &value)
+{
+  if (token == nullptr)
+    return false;
+  char *end;
+  value = strtoul(token, &end, 0);
+  return (end != token) && (*end == '\0');
+}
+
+// Parse a fault command: <fault> <address> [value] [count]
+bool parseFault(char *command, faultEvent_t &event)
+{
+  char *name = strtok(command, " ");
+  if (name == nullptr)
+    return false;
+
+  int fault;
+  for (fault = 0; fault < NUM_FAULTS; fault++)
+  {
+    if (strcmp(name, faultNames[fault]) == 0)
+      break;
+  }
+  if (fault == NUM_FAULTS)
+    return false;
+
+  uint32_t address;
+  if (!parseNumber(strtok(nullptr, " "), address))
+    return false;
+  int device;
+  for (device = 0; device < numDevices; device++)
+  {
+    if (deviceConfigs[device].address == address)
+      break;
+  }
+  if (device == numDevices)
+    return false;
+
+  event.device = device;
+  event.fault = fault;
+  event.value = (fault == FAULT_RANGE) ? 2000000 : (fault == FAULT_CORRUPT) ? 0x1 : 0;
+  event.count = 1;
+  event.injected = false;
+
+  char *token = strtok(nullptr, " ");
+  if (token != nullptr)
+  {
+    if ((fault == FAULT_RESET) || (!parseNumber(token, event.value)))
+      return false;
+    token = strtok(nullptr, " ");
+    if (token != nullptr)
+    {
+      if ((fault == FAULT_NAK) || (!parseNumber(token, event.count)) || (event.count == 0))
+        return false;
+    }
+  }
+  else if ((fault == FAULT_NAK) || (fault == FAULT_DELAY))
+    return false; // These need a value
+
+  return true;
+}
+
+// Run one line from Serial
+void runCommand(char *line)
+{
+  if (strcmp(line, "p") == 0)
+  {
+    for (int device = 0; device < numDevices; device++)
+    {
+      powerUp(device);
+#if PRELOAD_RESPONSE
+      preloadResponse(device);
+#endif
+      printAddress(device);
+      Serial.print("Power cycled. Word: ");
+      Serial.println(readDACWord(device));
+    }
+  }
+  else if (strcmp(line, "e") == 0)
+  {
+    for (int device = 0; device < numDevices; device++)
+    {
+      eraseNVM(device);
+      printAddress(device);
+      Serial.println("Saved word erased");
+    }
+  }
+  else if (strcmp(line, "run") == 0)
+  {
+    for (int i = 0; i < numEvents; i++)
+      schedule[i].injected = false;
+    scheduleRunning = (numEvents > 0);
+    scheduleStartMillis = millis();
+    Serial.print("Schedule started at ");
+    Serial.print(scheduleStartMillis);
+    Serial.println(" ms");
+  }
+  else if (strcmp(line, "clear") == 0)
+  {
+    numEvents = 0;
+    scheduleRunning = false;
+    Serial.println("Schedule cleared");
+  }
+  else if (strcmp(line, "list") == 0)
+  {
+    for (int i = 0; i < numEvents; i++)
+    {
+      Serial.print("@");
+      Serial.print(schedule[i].atMillis);
+      Serial.print("  ");
+      printFault(schedule[i]);
+      Serial.println(schedule[i].injected ? "  (injected)" : "");
+    }
+  }
+  else if (line[0] == '@')
+  {
+    faultEvent_t event;
+    char *command = strchr(line, ' ');
+    if (command != nullptr)
+      *command++ = '\0';
+    if ((!parseNumber(&line[1], event.atMillis)) || (command == nullptr) || (!parseFault(command, event)))
+      Serial.println("Bad fault command");
+    else if (numEvents >= MAX_EVENTS)
+      Serial.println("Schedule full");
+    else
+      schedule[numEvents++] = event;
+  }
+  else if (line[0] != '\0')
+  {
+    faultEvent_t event;
+    if (parseFault(line, event))
+      injectFault(event);
+    else
+      Serial.println("Unknown command");
   }
 }
 
@@ -66,26 +768,125 @@ void setup()
   }
   Serial.println("SparkFun STP3593LF Emulator");
 
-  Wire.onReceive(receiveHandler);
-  Wire.onRequest(requestHandler);
-  Wire.begin((uint8_t)I2C_DEV_ADDR);
+#if EEPROM_IN_FLASH
+  EEPROM.begin(numDevices * nvmSize);
+#endif
+
+  for (int device = 0; device < numDevices; device++)
+  {
+    devices[device].dacWrites = 0;
+    devices[device].reads = 0;
+    devices[device].malformed = 0;
+    devices[device].saves = 0;
+    devices[device].phaseSeconds = 0.0;
+    powerUp(device);
+
+    printAddress(device);
+    Serial.print("Saved word: ");
+    if (devices[device].savedValid)
+      Serial.println(devices[device].savedWord);
+    else
+      Serial.println("none (factory 500000)");
+  }
+  Serial.println("Send p to power cycle, e to erase the saved words - or a fault command");
+
+  for (int device = 0; device < numDevices; device++)
+    beginPort(device);
 }
 
 void loop()
 {
-  static unsigned long lastPrint = 0;
+  static unsigned long lastPrint = millis();
+  static unsigned long lastMicros = micros();
+
+  // Integrate the phase of each output at the word in use
+  unsigned long now = micros();
+  double elapsed = (double)(now - lastMicros) / 1.0e6;
+  lastMicros = now;
+  for (int device = 0; device < numDevices; device++)
+    devices[device].phaseSeconds += fractionalOffset(device, readDACWord(device)) * elapsed;
+
+  for (int device = 0; device < numDevices; device++)
+  {
+    emulatedOCXO_t &ocxo = devices[device];
+    if (ocxo.savePending)
+    {
+      ocxo.savePending = false;
+      saveNVM(device, readDACWord(device));
+      printAddress(device);
+      Serial.print("Saved word: ");
+      Serial.print(ocxo.savedWord);
+      Serial.print("  Saves: ");
+      Serial.println(ocxo.saves);
+    }
+  }
+
+  // Read a command line from Serial
+  static char line[48];
+  static int lineLength = 0;
+  while (Serial.available())
+  {
+    char c = Serial.read();
+    if ((c == '\r') || (c == '\n'))
+    {
+      line[lineLength] = '\0';
+      runCommand(line);
+      lineLength = 0;
+    }
+    else if (lineLength < (int)(sizeof(line) - 1))
+      line[lineLength++] = c;
+  }
 
-  if (millis() > (lastPrint + 1000))
+  serviceNAK();
+  serviceSchedule();
+
+  for (int device = 0; device < numDevices; device++)
   {
-    lastPrint = millis();
+    emulatedOCXO_t &ocxo = devices[device];
+    if (ocxo.recoveryReport)
+    {
+      ocxo.recoveryReport = false;
+      printAddress(device);
+      Serial.print("First write ");
+      Serial.print(ocxo.recoveryMillis);
+      Serial.println(" ms after the fault");
+    }
+  }
+
+  if (millis() - lastPrint >= 1000)
+  {
+    lastPrint += 1000;
 
-    // Extract the Frequency Control Word
-    uint32_t freqControl = ((uint32_t)registerBytes[0]) << 24;
-    freqControl |= ((uint32_t)registerBytes[1]) << 16;
-    freqControl |= ((uint32_t)registerBytes[2]) <<  8;
-    freqControl |= ((uint32_t)registerBytes[3]) <<  0;
-    
-    Serial.print("Frequency control is ");
-    Serial.println(freqControl);
+    for (int device = 0; device < numDevices; device++)
+    {
+      emulatedOCXO_t &ocxo = devices[device];
+      uint32_t word = readDACWord(device);
+      printAddress(device);
+      Serial.print("Word: ");
+      Serial.print(word);
+      Serial.print("  Saved: ");
+      Serial.print(ocxo.savedWord);
+      Serial.print("  Output (Hz): ");
+      Serial.print(nominalHz * (1.0 + fractionalOffset(device, word)), 6);
+      Serial.print("  Phase (ns): ");
+      Serial.print(ocxo.phaseSeconds * 1.0e9, 3);
+      Serial.print("  Writes: ");
+      Serial.print(ocxo.dacWrites);
+      Serial.print("  Reads: ");
+      Serial.print(ocxo.reads);
+      if (ocxo.malformed > 0)
+      {
+        Serial.print("  Malformed: ");
+        Serial.print(ocxo.malformed);
+      }
+      if (ocxo.faults > 0)
+      {
+        Serial.print("  Faults: ");
+        Serial.print(ocxo.faults);
+      }
+      if (ocxo.nakActive)
+        Serial.print("  (NAK)");
+      Serial.println();
+    }
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,163 @@
+/*
+  Check: the aggregator's statistics match a direct calculation.
+
+  Feeds SfeSTP3593LFAggregator two hours and a half minute of one-second
+  samples, then recomputes each statistic directly - two passes over the same
+  samples, in double precision. The check fails if a single interval (a
+  running Welford update), or intervals combined by getSummary (Chan's
+  parallel merge), differ from the direct result - or if the counts are wrong.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  Needs no hardware: the samples are added directly with addSample. Prints
+  PASS, or FAIL: and the check which failed. Min, max and variance are stored
+  as floats, so they are compared to float precision.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_Aggregator.h>
+
+#if !SFE_STP3593LF_ENABLE_STATISTICS
+#error This check needs the statistics (SFE_STP3593LF_ENABLE_STATISTICS) and the floating-point loop
+#endif
+
+#if (SFE_STP3593LF_MINUTE_AGGREGATES < 60) || (SFE_STP3593LF_HOUR_AGGREGATES < 2)
+#error This check needs at least 60 minute and 2 hour aggregates
+#endif
+
+const uint32_t numSamples = (2 * 3600) + 30; // Two hours, and half a minute in progress
+
+SfeSTP3593LFAggregator myAggregator;
+
+int failures = 0;
+
+void check(bool passed, const char *what)
+{
+  Serial.print(passed ? "pass: " : "FAIL: ");
+  Serial.println(what);
+  if (!passed)
+    failures++;
+}
+
+// The samples: a drifting word with a wobble, and a noisy input with a trend
+uint32_t wordSample(uint32_t i)
+{
+  return 500000 + (i / 100) + (uint32_t)(20.0 + (20.0 * sin((double)i / 37.0)));
+}
+
+double inputSample(uint32_t i)
+{
+  return (3.0 * sin((double)i / 11.0)) + (0.001 * (double)i) + (((double)((i * 7919) % 1001) - 500.0) * 1.0e-3);
+}
+
+double sample(sfeSTP3593LFSeries_t series, uint32_t i)
+{
+  return (series == kSfeSTP3593LFSeriesWord) ? (double)wordSample(i) : inputSample(i);
+}
+
+// Two passes over samples first - last (exclusive): the reference
+sfeSTP3593LFAggregate_t direct(sfeSTP3593LFSeries_t series, uint32_t first, uint32_t last)
+{
+  sfeSTP3593LFAggregate_t result;
+  double sum = 0.0;
+  double min = sample(series, first);
+  double max = min;
+  for (uint32_t i = first; i < last; i++)
+  {
+    double value = sample(series, i);
+    sum += value;
+    if (value < min)
+      min = value;
+    if (value > max)
+      max = value;
+  }
+  result.count = last - first;
+  result.mean = sum / (double)result.count;
+  double squares = 0.0;
+  for (uint32_t i = first; i < last; i++)
+  {
+    double difference = sample(series, i) - result.mean;
+    squares += difference * difference;
+  }
+  result.variance = (float)(squares / (double)(result.count - 1));
+  result.min = (float)min;
+  result.max = (float)max;
+  return result;
+}
+
+bool close(double value, double reference, double relative)
+{
+  double tolerance = relative * ((reference >= 0.0) ? reference : 0.0 - reference);
+  if (tolerance < 1.0e-9)
+    tolerance = 1.0e-9;
+  return (value >= (reference - tolerance)) && (value <= (reference + tolerance));
+}
+
+bool matches(const sfeSTP3593LFAggregate_t &aggregate, const sfeSTP3593LFAggregate_t &reference)
+{
+  return (aggregate.count == reference.count) && close(aggregate.mean, reference.mean, 1.0e-12) &&
+         close(aggregate.variance, reference.variance, 1.0e-5) && (aggregate.min == reference.min) && (aggregate.max == reference.max);
+}
+
+void checkSeries(sfeSTP3593LFSeries_t series)
+{
+  sfeSTP3593LFAggregate_t aggregate;
+
+  // One pass: the most recent completed minute and hour, and the day in progress
+  myAggregator.getAggregate(series, kSfeSTP3593LFPerMinute, 1, aggregate);
+  check(matches(aggregate, direct(series, 7140, 7200)), "the last completed minute matches");
+  myAggregator.getAggregate(series, kSfeSTP3593LFPerHour, 1, aggregate);
+  check(matches(aggregate, direct(series, 3600, 7200)), "the last completed hour matches");
+  myAggregator.getAggregate(series, kSfeSTP3593LFPerDay, 0, aggregate);
+  check(matches(aggregate, direct(series, 0, numSamples)), "the day in progress matches");
+
+  // Merged: 60 minutes - the ring has wrapped - and two hours
+  check(myAggregator.getSummary(series, kSfeSTP3593LFPerMinute, 60, aggregate) && matches(aggregate, direct(series, 3600, 7200)),
+        "the summary of the last 60 minutes matches the hour");
+  check(myAggregator.getSummary(series, kSfeSTP3593LFPerHour, 2, aggregate) && matches(aggregate, direct(series, 0, 7200)),
+        "the summary of the last 2 hours matches");
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Aggregator Check");
+
+  for (uint32_t i = 0; i < numSamples; i++)
+    myAggregator.addSample(wordSample(i), inputSample(i));
+
+  check(myAggregator.getSampleCount() == numSamples, "every sample is counted");
+  check(myAggregator.getElapsedSeconds() == numSamples, "the elapsed time is the sum of the time steps");
+  check(myAggregator.getAggregateCount(kSfeSTP3593LFPerMinute) == 60, "the minute ring holds 60 minutes");
+  check(myAggregator.getAggregateCount(kSfeSTP3593LFPerHour) == 2, "the hour ring holds 2 hours");
+  check(myAggregator.getAggregateCount(kSfeSTP3593LFPerDay) == 0, "no day has completed");
+
+  Serial.println("Control word:");
+  checkSeries(kSfeSTP3593LFSeriesWord);
+  Serial.println("Loop input:");
+  checkSeries(kSfeSTP3593LFSeriesInput);
+
+  if (failures == 0)
+    Serial.println("PASS");
+  else
+  {
+    Serial.print("FAIL: ");
+    Serial.print(failures);
+    Serial.println(" check(s) failed");
+  }
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -0,0 +1,163 @@
+/*
+  Check: a recorded trace replays bit for bit.
+
+  Records the inputs of a simulated discipline run - the state machine with a
+  holdover and a reset, timed samples and the integer-only loop, all with
+  error feedback - into a RAM buffer, then replays the trace. The check fails
+  if starting the recording changes the loop's output, if the replay does not
+  cover every record, if any control word or write result differs from the
+  recording, or if a corrupted trace is not detected.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  Runs on the in-memory (mock) bus: no hardware is needed. Prints PASS, or
+  FAIL: and the check which failed. Needs ~20kB of RAM (e.g. ESP32).
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_Recorder.h>
+
+#if !SFE_STP3593LF_ENABLE_TELEMETRY
+#error This check needs the telemetry (SFE_STP3593LF_ENABLE_TELEMETRY) and the floating-point loop
+#endif
+
+// A Stream which writes to and reads from a RAM buffer
+class MemoryStream : public Stream
+{
+public:
+  MemoryStream(uint8_t *buffer, size_t size) : _buffer(buffer), _size(size), _head(0), _tail(0) {}
+  size_t write(uint8_t b)
+  {
+    if (_head >= _size)
+      return 0;
+    _buffer[_head++] = b;
+    return 1;
+  }
+  int available() { return _head - _tail; }
+  int read() { return (_tail < _head) ? _buffer[_tail++] : -1; }
+  int peek() { return (_tail < _head) ? _buffer[_tail] : -1; }
+  void rewind() { _tail = 0; }
+  size_t length() { return _head; }
+
+private:
+  uint8_t *_buffer;
+  size_t _size;
+  size_t _head;
+  size_t _tail;
+};
+
+const size_t traceSize = 20000;
+uint8_t traceBuffer[traceSize];
+MemoryStream trace(traceBuffer, traceSize);
+
+SfeSTP3593LFMock myOCXO; // The driver - on the in-memory bus
+SfeSTP3593LFMock twin; // The same inputs, never recorded
+SfeSTP3593LFRecorder myRecorder(trace);
+bool twinMatches = true;
+
+int failures = 0;
+
+void check(bool passed, const char *what)
+{
+  Serial.print(passed ? "pass: " : "FAIL: ");
+  Serial.println(what);
+  if (!passed)
+    failures++;
+}
+
+// One epoch of the run
+void run(SfeSTP3593LFMock &ocxo, uint32_t epoch, double bias, uint32_t timestamp)
+{
+  if (epoch == 450)
+    ocxo.resetDiscipline();
+
+  if (epoch < 300)
+    ocxo.updateDiscipline(bias, (epoch < 200) || (epoch >= 210)); // Ten epochs of holdover
+  else if (epoch < 600)
+    ocxo.updateDisciplineTimed(timestamp, bias);
+  else
+    ocxo.setFrequencyByPhasePicoseconds((int32_t)(bias * 1.0e9)); // Phase in picoseconds
+}
+
+// Record a run: an oscillator which is 20ppb fast at 500000, with 2ns of bias noise. The recording
+// starts part way through, with error feedback carrying a residual - as attaching a recorder to a running loop would
+void record()
+{
+  myOCXO.begin();
+  myOCXO.setFrequencyControlWord(475000); // Close to on frequency: the loop is not slew-limited, so there is a residual
+  myOCXO.setMaxFrequencyChangePPB(3.0);
+  myOCXO.enableErrorFeedback(true);
+  twin.begin();
+  twin.setFrequencyControlWord(475000);
+  twin.setMaxFrequencyChangePPB(3.0);
+  twin.enableErrorFeedback(true);
+
+  double phase = 150.0e-9; // Seconds
+  randomSeed(1);
+  for (uint32_t epoch = 0; epoch < 900; epoch++)
+  {
+    if (epoch == 50)
+      myOCXO.setRecorder(&myRecorder);
+
+    phase += 20.0e-9 + (((double)myOCXO.getFrequencyControlWord() - 500000.0) * kSfeSTP3593LFFreqControlResolution);
+    double bias = (phase + (((double)random(-1000, 1001)) * 2.0e-12)) * 1000.0; // Bias in millis
+    uint32_t timestamp = (epoch * 1000000UL) + (uint32_t)random(0, 1000);
+
+    run(myOCXO, epoch, bias, timestamp);
+    run(twin, epoch, bias, timestamp);
+    if (myOCXO.getFrequencyControlWord() != twin.getFrequencyControlWord())
+      twinMatches = false;
+  }
+
+  myOCXO.setRecorder(nullptr);
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Replay Check");
+
+  record();
+  check(trace.length() < traceSize, "the trace fits in the buffer");
+  check(twinMatches, "recording does not change the control words");
+
+  SfeSTP3593LFReplay myReplay;
+  check(myReplay.begin(trace), "the trace header is valid");
+  uint32_t records = myReplay.run();
+  check(records == myRecorder.getRecordCount(), "every record is replayed");
+  check(myReplay.getMismatchCount() == 0, "every control word and write result matches the recording");
+  check(myReplay.getFrequencyControlWord() == myOCXO.getFrequencyControlWord(), "the final control word matches");
+
+  // Flip one bit in every byte of a record in the middle of the trace. The replay must notice
+  for (size_t i = trace.length() / 2; i < (trace.length() / 2) + 18; i++)
+    traceBuffer[i] ^= 0x40;
+  trace.rewind();
+  SfeSTP3593LFReplay corruptReplay;
+  corruptReplay.begin(trace);
+  uint32_t corruptRecords = corruptReplay.run();
+  check((corruptReplay.getMismatchCount() > 0) || (corruptRecords < records), "a corrupted trace is detected");
+
+  if (failures == 0)
+    Serial.println("PASS");
+  else
+  {
+    Serial.print("FAIL: ");
+    Serial.print(failures);
+    Serial.println(" check(s) failed");
+  }
+}
+
+void loop()
+{
+  // Nothing to do here
+}
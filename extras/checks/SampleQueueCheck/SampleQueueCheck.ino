@@ -0,0 +1,150 @@
+/*
+  Check: the PPS sample queue keeps its order and accounts for every sample.
+
+  Fills the wait-free queue past its capacity - as a PPS interrupt would while
+  the discipline task is starved - and checks that every sample is either
+  applied, in order, or counted as an overflow. Then checks that the indices
+  wrap cleanly, and that a failed write is counted once per sample.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  Runs on the in-memory (mock) bus: no hardware is needed. Prints PASS, or
+  FAIL: and the check which failed.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+
+#if !SFE_STP3593LF_ENABLE_PI_LOOP
+#error This check needs the PI loop (SFE_STP3593LF_ENABLE_PI_LOOP)
+#endif
+
+const uint8_t capacity = SFE_STP3593LF_SAMPLE_QUEUE_CAPACITY;
+const uint8_t extra = 5; // The samples queued beyond the capacity
+
+SfeSTP3593LFMock myOCXO; // The driver - on the in-memory bus
+
+int failures = 0;
+
+void check(bool passed, const char *what)
+{
+  Serial.print(passed ? "pass: " : "FAIL: ");
+  Serial.println(what);
+  if (!passed)
+    failures++;
+}
+
+// The queue on its own: overflow, order and index wraparound
+void checkQueue()
+{
+  SfeSTP3593LFSPSCQueue<uint32_t, capacity> queue;
+
+  uint8_t accepted = 0;
+  for (uint32_t i = 0; i < (uint32_t)(capacity + extra); i++)
+  {
+    if (queue.push(i))
+      accepted++;
+  }
+  check(accepted == capacity, "a full queue accepts exactly its capacity");
+  check(queue.getOverflowCount() == extra, "each dropped item is counted as an overflow");
+  check(queue.available() == capacity, "available reports a full queue");
+
+  bool inOrder = true;
+  uint32_t item;
+  for (uint32_t i = 0; i < capacity; i++)
+  {
+    if ((!queue.pop(item)) || (item != i))
+      inOrder = false;
+  }
+  check(inOrder, "the oldest items are kept, in order");
+  check(!queue.pop(item), "the queue is empty after popping its capacity");
+
+  // 1000 items through the 8-bit free-running indices: they wrap several times
+  bool wrapped = true;
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    if (!queue.push(i))
+      wrapped = false;
+    if (((i % 3) == 2) || (queue.available() == capacity)) // Drain in bursts
+    {
+      while (queue.pop(item))
+      {
+        if (item != next++)
+          wrapped = false;
+      }
+    }
+  }
+  while (queue.pop(item))
+  {
+    if (item != next++)
+      wrapped = false;
+  }
+  check(wrapped && (next == 1000), "the indices wrap with no loss or reordering");
+  check(queue.getOverflowCount() == extra, "no overflow is counted while there is room");
+}
+
+// The driver's queue: samples applied or counted - never lost
+void checkDriver()
+{
+  myOCXO.begin();
+  myOCXO.setFrequencyControlWord(500000);
+
+  uint8_t queued = 0;
+  for (uint8_t i = 0; i < (capacity + extra); i++)
+  {
+    if (myOCXO.queuePhasePicoseconds(100000)) // 100ns: every sample moves the word
+      queued++;
+  }
+  check(queued == capacity, "queuePhasePicoseconds drops the samples beyond the capacity");
+  check(myOCXO.getSampleQueueOverflows() == extra, "getSampleQueueOverflows counts every dropped sample");
+
+  uint8_t serviced = myOCXO.serviceDiscipline();
+  check(serviced == queued, "serviceDiscipline applies every queued sample");
+  check(myOCXO.serviceDiscipline() == 0, "a second serviceDiscipline finds the queue empty");
+  check(myOCXO.getFrequencyControlWord() != 500000, "the samples moved the control word");
+  check(myOCXO.getSampleWriteFailures() == 0, "no write failure is counted when the writes succeed");
+
+  // One failed transaction: exactly one sample's write fails
+  myOCXO.queuePhasePicoseconds(100000);
+  myOCXO.queuePhasePicoseconds(100000);
+  myOCXO.queuePhasePicoseconds(100000);
+  myOCXO.getMockBus().failNext(1);
+  serviced = myOCXO.serviceDiscipline();
+  check(serviced == 3, "a failed write does not stop the queue being serviced");
+  check(myOCXO.getSampleWriteFailures() == 1, "getSampleWriteFailures counts the sample whose write failed");
+  check(myOCXO.getSampleQueueOverflows() == extra, "servicing does not change the overflow count");
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Sample Queue Check");
+
+  checkQueue();
+  checkDriver();
+
+  if (failures == 0)
+    Serial.println("PASS");
+  else
+  {
+    Serial.print("FAIL: ");
+    Serial.print(failures);
+    Serial.println(" check(s) failed");
+  }
+}
+
+void loop()
+{
+  // Nothing to do here
+}
@@ -0,0 +1,159 @@
+/*
+  Check: the warm-start snapshot survives a round trip.
+
+  Trains a driver - the discipline loop, and the estimators when they are
+  compiled in - then restores its snapshot into a second driver on another
+  in-memory bus. The check fails if the restored driver's snapshot differs,
+  if the two drivers then steer differently, or if a corrupted or truncated
+  snapshot - or one with a section shorter than its layout - is accepted.
+
+  SparkFun code, firmware, and software is released under the MIT License.
+  Please see LICENSE.md for further details.
+
+  Runs on the in-memory (mock) bus: no hardware is needed. Prints PASS, or
+  FAIL: and the check which failed. Works in every feature configuration.
+
+*/
+
+// You will need the SparkFun Toolkit. Click here to get it: http://librarymanager/All#SparkFun_Toolkit
+
+#include <SparkFun_STP3593LF.h> // Click here to get the library: http://librarymanager/All#SparkFun_STP3593LF
+#include <SparkFun_STP3593LF_MockBus.h>
+
+SfeSTP3593LFMock trained; // The driver which learns the loop state
+SfeSTP3593LFMock restored; // The driver the snapshot is restored into
+
+uint8_t snapshot[kSfeSTP3593LFSnapshotMaxSize];
+uint8_t resnapshot[kSfeSTP3593LFSnapshotMaxSize];
+
+int failures = 0;
+
+void check(bool passed, const char *what)
+{
+  Serial.print(passed ? "pass: " : "FAIL: ");
+  Serial.println(what);
+  if (!passed)
+    failures++;
+}
+
+// One epoch of a simulated oscillator which is 20ppb fast at 500000: steer with the phase error
+bool steer(SfeSTP3593LFMock &ocxo, double &phase, uint32_t epoch)
+{
+  phase += 20.0e-9 + (((double)ocxo.getFrequencyControlWord() - 500000.0) * kSfeSTP3593LFFreqControlResolution);
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+  double noise = ((double)((int32_t)((epoch * 7919) % 2001) - 1000)) * 2.0e-12; // Repeatable noise
+#endif
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+  return ocxo.updateDiscipline((phase + noise) * 1000.0); // Bias in millis
+#elif SFE_STP3593LF_ENABLE_PI_LOOP
+  return ocxo.setFrequencyByPhasePicoseconds((int32_t)((phase + noise) * 1.0e12));
+#else
+  return ocxo.setFrequencyControlWord(500000 + (epoch % 100)); // The register driver only
+#endif
+}
+
+void setup()
+{
+  delay(1000); // Allow time for the microcontroller to start up
+
+  Serial.begin(115200); // Begin the Serial console
+  while (!Serial)
+  {
+    delay(100); // Wait for the user to open the Serial Monitor
+  }
+  Serial.println("SparkFun STP3593LF Snapshot Check");
+
+  // Train
+  trained.begin();
+  trained.setFrequencyControlWord(500000);
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+  trained.setMaxFrequencyChangePPB(3.0);
+  trained.setLockEpochs(30);
+#endif
+#if SFE_STP3593LF_ENABLE_STATISTICS
+  trained.useEstimatedFreqControlResolution(true);
+#endif
+  double phase = 150.0e-9; // Seconds
+  uint32_t epoch = 0;
+  for (; epoch < 1200; epoch++)
+  {
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    trained.setTemperature(25.0 + (2.0 * sin((double)epoch / 100.0)));
+#endif
+    steer(trained, phase, epoch);
+  }
+
+  size_t length = trained.getSnapshot(snapshot, sizeof(snapshot));
+  check(length > 0, "getSnapshot writes a snapshot");
+  check(length <= (kSfeSTP3593LFSnapshotMaxSize - 64), "the snapshot leaves room for its sections to grow");
+  check(trained.getSnapshot(resnapshot, 8) == 0, "getSnapshot refuses a buffer which is too small");
+
+  // Round trip
+  restored.begin();
+  restored.setFrequencyControlWord(123456);
+  check(restored.restoreSnapshot(snapshot, length), "restoreSnapshot accepts the snapshot");
+  check(restored.getMockBus().getWord() == trained.getFrequencyControlWord(), "restoreSnapshot writes the control word");
+
+  // The run ends in tracking. (A locked loop resumes in tracking - lock is re-confirmed, not assumed -
+  // so the snapshot of a locked loop would come back with a different state.)
+  size_t restoredLength = restored.getSnapshot(resnapshot, sizeof(resnapshot));
+  check((restoredLength == length) && (memcmp(resnapshot, snapshot, length) == 0), "a restored driver snapshots back to the same bytes");
+
+  // Both drivers now see the same inputs. Floats are stored as 32 bits: allow one LSB
+  double restoredPhase = phase;
+  int32_t maxDifference = 0;
+  for (uint32_t i = 0; i < 300; i++, epoch++)
+  {
+    steer(trained, phase, epoch);
+    steer(restored, restoredPhase, epoch);
+    int32_t difference = (int32_t)trained.getFrequencyControlWord() - (int32_t)restored.getFrequencyControlWord();
+    if (difference < 0)
+      difference = 0 - difference;
+    if (difference > maxDifference)
+      maxDifference = difference;
+  }
+  check(maxDifference <= 1, "the restored driver steers like the trained driver");
+
+  // Corruption and truncation are rejected - and leave the loop state alone
+  length = trained.getSnapshot(snapshot, sizeof(snapshot));
+  restoredLength = restored.getSnapshot(resnapshot, sizeof(resnapshot));
+  snapshot[length / 2] ^= 0x01;
+  check(!restored.restoreSnapshot(snapshot, length), "restoreSnapshot rejects a corrupted snapshot");
+  snapshot[length / 2] ^= 0x01;
+  check(!restored.restoreSnapshot(snapshot, length - 1), "restoreSnapshot rejects a truncated snapshot");
+
+  // A section shorter than its layout - here the word, the first section - is rejected, even with a valid CRC
+  uint8_t shortened[kSfeSTP3593LFSnapshotMaxSize];
+  memcpy(shortened, snapshot, 11);
+  memcpy(&shortened[11], &snapshot[12], length - 12);
+  shortened[8] = kSfeSTP3593LFSnapshotWordLength - 1;
+  shortened[5] = (uint8_t)((length - 1) & 0xFF);
+  shortened[6] = (uint8_t)((length - 1) >> 8);
+  uint16_t crc = sfeSTP3593LFSnapshotCRC(shortened, length - 3);
+  shortened[length - 3] = (uint8_t)(crc & 0xFF);
+  shortened[length - 2] = (uint8_t)(crc >> 8);
+  check(!restored.restoreSnapshot(shortened, length - 1), "restoreSnapshot rejects a section which is too short");
+  uint8_t after[kSfeSTP3593LFSnapshotMaxSize];
+  size_t afterLength = restored.getSnapshot(after, sizeof(after));
+  check((afterLength == restoredLength) && (memcmp(after, resnapshot, afterLength) == 0), "a rejected snapshot leaves the loop state unchanged");
+
+  // Warm start: begin restores the snapshot
+  SfeSTP3593LFMock warm;
+  warm.setWarmStart(snapshot, length);
+  check(warm.begin() && warm.getWarmStarted(), "begin restores a warm-start snapshot");
+  check(warm.getFrequencyControlWord() == trained.getFrequencyControlWord(), "the warm start writes the control word");
+
+  if (failures == 0)
+    Serial.println("PASS");
+  else
+  {
+    Serial.print("FAIL: ");
+    Serial.print(failures);
+    Serial.println(" check(s) failed");
+  }
+}
+
+void loop()
+{
+  // Nothing to do here
+}
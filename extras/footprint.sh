@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# Report the flash / RAM footprint of the STP3593LF library for each feature configuration.
+#
+# Builds examples/Example05_Footprint once per configuration with arduino-cli, then reports
+# the text (flash), data (flash and RAM) and bss (RAM) of each build as CSV.
+# The feature switches are described in src/SparkFun_STP3593LF_Config.h.
+#
+# Needs arduino-cli, with the board core and the SparkFun Toolkit installed.
+#
+# Usage: extras/footprint.sh [fqbn]
+#   extras/footprint.sh esp32:esp32:esp32
+#   SIZE=~/.arduino15/packages/arduino/tools/avr-gcc/7.3.0-atmel3.6.1-arduino7/bin/avr-size extras/footprint.sh arduino:avr:mega
+#
+# SIZE is the binutils size tool for the board's toolchain. It must be on the PATH, or be set explicitly.
+
+FQBN=${1:-esp32:esp32:esp32}
+
+if [ -z "$SIZE" ]; then
+    case "$FQBN" in
+    arduino:avr:*) SIZE=avr-size ;;
+    esp32:esp32:*) SIZE=xtensa-esp32-elf-size ;;
+    *) SIZE=arm-none-eabi-size ;;
+    esac
+fi
+
+LIBRARY=$(cd "$(dirname "$0")/.." && pwd)
+SKETCH="$LIBRARY/examples/Example05_Footprint"
+OUTPUT=${OUTPUT:-/tmp/stp3593lf_footprint}
+
+# name|flags
+CONFIGURATIONS="
+full|
+no-telemetry|-DSFE_STP3593LF_ENABLE_TELEMETRY=0
+no-statistics|-DSFE_STP3593LF_ENABLE_STATISTICS=0
+no-verification|-DSFE_STP3593LF_ENABLE_VERIFICATION=0
+no-dither|-DSFE_STP3593LF_ENABLE_DITHER=0
+fixed-point|-DSFE_STP3593LF_FIXED_POINT=1
+fixed-point-minimal|-DSFE_STP3593LF_FIXED_POINT=1 -DSFE_STP3593LF_ENABLE_VERIFICATION=0 -DSFE_STP3593LF_ENABLE_DITHER=0
+register-only|-DSFE_STP3593LF_ENABLE_PI_LOOP=0 -DSFE_STP3593LF_ENABLE_VERIFICATION=0 -DSFE_STP3593LF_ENABLE_DITHER=0
+"
+
+echo "configuration,text,data,bss,flash,ram"
+
+echo "$CONFIGURATIONS" | while IFS='|' read -r NAME FLAGS; do
+    [ -z "$NAME" ] && continue
+
+    BUILD="$OUTPUT/$NAME"
+    mkdir -p "$BUILD"
+
+    # compiler.cpp.extra_flags reaches the library .cpp files as well as the sketch
+    if ! arduino-cli compile --fqbn "$FQBN" --library "$LIBRARY" --output-dir "$BUILD" \
+        --build-property "compiler.cpp.extra_flags=$FLAGS" "$SKETCH" > "$BUILD/build.log" 2>&1; then
+        echo "$NAME,build failed - see $BUILD/build.log"
+        continue
+    fi
+
+    # Berkeley format: text data bss dec hex filename
+    "$SIZE" "$BUILD/Example05_Footprint.ino.elf" | awk -v name="$NAME" \
+        'NR == 2 { printf "%s,%d,%d,%d,%d,%d\n", name, $1, $2, $3, $1 + $2, $2 + $3 }'
+done
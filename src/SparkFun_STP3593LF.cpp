@@ -19,20 +19,50 @@
 */
 
 #include "SparkFun_STP3593LF.h"
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+#include "SparkFun_STP3593LF_Recorder.h"
+#endif
+#if SFE_STP3593LF_ENABLE_STATISTICS
+#include "SparkFun_STP3593LF_Aggregator.h"
+#endif
 
 /// @brief Begin communication with the STP3593LF. Read the registers.
 /// @return true if readRegisters is successful.
 bool SfeSTP3593LFDriver::begin()
 {
-    if (_theBus->ping() != kSTkErrOk)
-        return false;
+    _warmStarted = false;
+    _frequencyControlValid = false;
 
-    // Read the frequency control register twice - in case the user is using the emulator
-    // (This ensures the emulator registerAddress points at 0x41 correctly)
-    if (readFrequencyControlWord())
-        return (readFrequencyControlWord());
+    switch (_beginMode)
+    {
+    case kSfeSTP3593LFBeginLazy:
+        break; // No bus traffic. The word is read on first use
+    case kSfeSTP3593LFBeginProbe:
+        if (_theBus->ping() != kSTkErrOk)
+            return false;
+        break;
+    case kSfeSTP3593LFBeginVerified:
+        if (!readFrequencyControlWord()) // The read proves the device is present. No ping needed
+            return false;
+        break;
+    default:
+        if (_theBus->ping() != kSTkErrOk)
+            return false;
 
-    return false;
+        // Read the frequency control register twice - for emulator builds which answered
+        // a read from the previous transaction's register pointer
+        if (!readFrequencyControlWord())
+            return false;
+        if (!readFrequencyControlWord())
+            return false;
+        break;
+    }
+
+    if (_warmStart != nullptr)
+        _warmStarted = restoreSnapshot(_warmStart, _warmStartLength); // Fall back to a cold start if invalid
+    _warmStart = nullptr; // The snapshot only has to outlive begin
+
+    return true;
 }
 
 /// @brief Read the STP3593LF OCXO frequency control register and update the driver's internal copy
@@ -59,6 +89,11 @@ bool SfeSTP3593LFDriver::readFrequencyControlWord(void)
         return false;
 
     _frequencyControl = frequencyControl;
+    _frequencyControlValid = true;
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+    ensureReferenceWord(); // The first word read is the saved value: seed the reference word from it
+#endif
 
     return true;
 }
@@ -67,9 +102,21 @@ bool SfeSTP3593LFDriver::readFrequencyControlWord(void)
 /// @return The 20-bit frequency control word as uint32_t (unsigned)
 uint32_t SfeSTP3593LFDriver::getFrequencyControlWord(void)
 {
+    ensureFrequencyControlWord(); // Leaves the word at 0 if the read fails
     return _frequencyControl;
 }
 
+/// @brief Get the driver's internal copy of the frequency control word - without touching the bus
+/// @param word set to the 20-bit frequency control word. Unchanged if the copy is not valid
+/// @return true if the copy is valid: the word has been read or written
+bool SfeSTP3593LFDriver::getCachedFrequencyControlWord(uint32_t &word)
+{
+    if (!_frequencyControlValid)
+        return false;
+    word = _frequencyControl;
+    return true;
+}
+
 /// @brief Set the 20-bit frequency control word - and update the driver's internal copy
 /// @param freq the frequency control word as uint32_t (unsigned)
 /// @return true if the write is successful
@@ -89,10 +136,153 @@ bool SfeSTP3593LFDriver::setFrequencyControlWord(uint32_t freq)
     if (_theBus->writeRegisterRegion(kSfeSTP3593LFRegWriteDAC, (const uint8_t *)&theBytes[0], 4) != kSTkErrOk)
         return false; // Return false if the write failed
 
+#if SFE_STP3593LF_ENABLE_VERIFICATION
+    if (_writeVerification)
+    {
+        // Read the word back. The driver's copy holds whatever the device reports
+        if (!readFrequencyControlWord())
+            return false;
+        return (_frequencyControl == freq);
+    }
+#endif
+
     _frequencyControl = freq; // Only update the driver's copy if the write was successful
+    _frequencyControlValid = true;
     return true;
 }
 
+/// @brief Add a signed step to the frequency control word - and update the driver's internal copy
+/// @param delta the step in LSBs. The result is limited to the pull range (0 - 1000000)
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::adjustFrequencyControlWord(int32_t delta)
+{
+    if (!ensureFrequencyControlWord())
+        return false;
+
+    int64_t freq = (int64_t)_frequencyControl + (int64_t)delta;
+
+    if (freq < 0)
+        freq = 0;
+    if (freq > (int64_t)kSfeSTP3593LFFreqControlMaxValue)
+        freq = kSfeSTP3593LFFreqControlMaxValue;
+
+    return setFrequencyControlWord((uint32_t)freq);
+}
+
+#if SFE_STP3593LF_ENABLE_VERIFICATION
+/// @brief Read the frequency control word back after every setFrequencyControlWord
+/// @param enable true to verify each write (default false)
+void SfeSTP3593LFDriver::setWriteVerification(bool enable)
+{
+    _writeVerification = enable;
+}
+#endif
+
+#if SFE_STP3593LF_ENABLE_DITHER
+/// @brief Enable or disable sub-LSB dithering of the frequency control word
+/// @param enable true to alternate between adjacent words to reach a fractional word
+/// @param slotsPerEpoch the number of dither slots per one-second epoch (2 - 64)
+void SfeSTP3593LFDriver::enableDither(bool enable, uint8_t slotsPerEpoch)
+{
+    if (slotsPerEpoch < 2)
+        slotsPerEpoch = 2;
+    if (slotsPerEpoch > kSfeSTP3593LFMaxDitherSlots)
+        slotsPerEpoch = kSfeSTP3593LFMaxDitherSlots;
+    _ditherSlots = slotsPerEpoch;
+    _ditherSlotMicros = kSfeSTP3593LFNominalTimeStepMicros / slotsPerEpoch;
+    _ditherEnabled = enable;
+    _ditherActive = false; // Wait for the next fractional word
+}
+
+/// @brief Set a fractional frequency control word and start a dither epoch
+/// @param word the integer part of the word
+/// @param fraction the fractional part in 1/65536 LSB
+/// @return true if the first slot's write (if any) is successful
+bool SfeSTP3593LFDriver::setDitheredFrequencyControlWord(uint32_t word, uint16_t fraction)
+{
+    if (word >= kSfeSTP3593LFFreqControlMaxValue)
+    {
+        word = kSfeSTP3593LFFreqControlMaxValue; // There is no word above the top of the range
+        fraction = 0;
+    }
+
+    if (!_ditherEnabled)
+        return setFrequencyControlWord(word + ((fraction >= 0x8000) ? 1 : 0)); // Round to the nearest word
+
+    _ditherWord = word;
+    _ditherFraction = fraction;
+    if (_ditherActive)
+        _ditherLastEpochWrites = _ditherEpochWrites;
+    _ditherEpochWrites = 0;
+    _ditherEpochStart = micros();
+    _ditherSlot = 0;
+    _ditherActive = true;
+
+    return ditherStep(); // Slot 0 starts now
+}
+
+/// @brief Get the fractional frequency control word being dithered
+/// @param word returns the integer part of the word
+/// @param fraction returns the fractional part in 1/65536 LSB
+void SfeSTP3593LFDriver::getDitheredFrequencyControlWord(uint32_t &word, uint16_t &fraction)
+{
+    word = _ditherWord;
+    fraction = _ditherFraction;
+}
+
+/// @brief Write the control word for the current dither slot - if it has changed
+/// @return true if successful. false if a write failed
+bool SfeSTP3593LFDriver::serviceDither(void)
+{
+    if ((!_ditherEnabled) || (!_ditherActive))
+        return true;
+#if SFE_STP3593LF_ENABLE_PI_LOOP && SFE_STP3593LF_ENABLE_STATISTICS
+    if (_sweepTable != nullptr)
+        return true; // The calibration sweep owns the control word
+#endif
+
+    uint32_t slot = (micros() - _ditherEpochStart) / _ditherSlotMicros;
+    if (slot < _ditherSlot)
+        return true; // Still in the slot which has already run
+
+    _ditherSlot = slot; // Skip any missed slots. The slots continue past the end of the epoch until the next word
+    return ditherStep();
+}
+
+/// @brief Get the number of writes made by the dither
+/// @return The number of writes
+uint32_t SfeSTP3593LFDriver::getDitherWrites(void)
+{
+    return _ditherWrites;
+}
+
+/// @brief Get the number of dither writes in the most recent complete epoch
+/// @return The number of writes
+uint8_t SfeSTP3593LFDriver::getDitherWritesPerEpoch(void)
+{
+    return _ditherLastEpochWrites;
+}
+#endif
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+#if SFE_STP3593LF_FIXED_POINT
+/// @brief Get the maximum frequency change in PPB
+/// @return The maximum frequency change in PPB - from the driver's internal store
+uint32_t SfeSTP3593LFDriver::getMaxFrequencyChangePPB(void)
+{
+    return _maxFrequencyChangePPB;
+}
+
+/// @brief Set the maximum frequency change in PPB - set the driver's internal _maxFrequencyChangePPB
+/// @param ppb the maximum frequency change in PPB. Whole PPB in the fixed-point build
+void SfeSTP3593LFDriver::setMaxFrequencyChangePPB(uint32_t ppb)
+{
+    if (ppb > 1000000)
+        ppb = 1000000; // 1000ppm - far beyond the pull range. Keeps the product below in range
+    _maxFrequencyChangePPB = ppb;
+    _maxChangeLSBs = (int32_t)((((int64_t)ppb * 1000000) + (_e15PerLSB / 2)) / _e15PerLSB); // Convert once, here
+}
+#else
 /// @brief Get the maximum frequency change in PPB
 /// @return The maximum frequency change in PPB - from the driver's internal store
 double SfeSTP3593LFDriver::getMaxFrequencyChangePPB(void)
@@ -105,6 +295,32 @@ double SfeSTP3593LFDriver::getMaxFrequencyChangePPB(void)
 void SfeSTP3593LFDriver::setMaxFrequencyChangePPB(double ppb)
 {
     _maxFrequencyChangePPB = ppb;
+    _maxChangeLSBs = (int32_t)((ppb * 1.0e-9 / _freqControlResolution) + 0.5); // Convert once, here
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    if (_recorder != nullptr)
+        _recorder->recordMaxFrequencyChange(ppb);
+#endif
+}
+
+/// @brief Set the frequency offset relative to the reference word, in ppb
+/// @param ppb the fractional frequency offset in parts per billion
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::setFrequencyOffsetPPB(double ppb)
+{
+    // Limit to the int32_t range of parts per 10^15 (+/-2147ppb): well beyond the pull range
+    if (ppb > 2147.0)
+        ppb = 2147.0;
+    if (ppb < -2147.0)
+        ppb = -2147.0;
+    return setFrequencyOffsetE15((int32_t)floor((ppb * 1.0e6) + 0.5));
+}
+
+/// @brief Get the frequency offset of the current word relative to the reference word
+/// @return The fractional frequency offset in parts per billion
+double SfeSTP3593LFDriver::getFrequencyOffsetPPB(void)
+{
+    return ((double)getFrequencyOffsetE15()) / 1.0e6;
 }
 
 /// @brief Set the frequency according to the GNSS receiver clock bias in milliseconds
@@ -116,14 +332,19 @@ void SfeSTP3593LFDriver::setMaxFrequencyChangePPB(double ppb)
 ///       and the setMaxFrequencyChangePPB.
 bool SfeSTP3593LFDriver::setFrequencyByBiasMillis(double bias, double Pk, double Ik)
 {
-    static double I;
-    static bool initialized = false;
-    if (!initialized)
+    if (!_integralInitialized)
     {
-        I = (double)_frequencyControl; // Initialize I with the current control word for a more reasonable startup
-        initialized = true;
+        if (!ensureFrequencyControlWord())
+            return false;
+        _integral = (double)wordToLinearQ16(_frequencyControl) / 65536.0; // Initialize I with the current control word for a more reasonable startup
+        _integralInitialized = true;
+        _integralQ16Initialized = false; // Re-seed the integer path if it is used later
     }
 
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    updateResolutionModel(bias);
+#endif
+
     // Our setpoint is zero. Bias is the process value. Convert it to error
     double error = 0.0 - bias;
 
@@ -131,10 +352,10 @@ bool SfeSTP3593LFDriver::setFrequencyByBiasMillis(double bias, double Pk, double
     error /= 1000.0;
 
     // Convert the error to control word LSBs
-    double requiredChangeInLSBs = error / kSfeSTP3593LFFreqControlResolution;
+    double requiredChangeInLSBs = error / _freqControlResolution;
 
     // Calculate the maximum change in control word LSBs
-    double maxChangeInLSBs = _maxFrequencyChangePPB * 1.0e-9 / kSfeSTP3593LFFreqControlResolution;
+    double maxChangeInLSBs = _maxFrequencyChangePPB * 1.0e-9 / _freqControlResolution;
 
     // Limit requiredChangeInLSBs to +/-maxChangeInLSBs
     if (requiredChangeInLSBs >= 0.0)
@@ -149,23 +370,2203 @@ bool SfeSTP3593LFDriver::setFrequencyByBiasMillis(double bias, double Pk, double
     }
 
     double P = requiredChangeInLSBs * Pk;
-    double dI = requiredChangeInLSBs * Ik;
-    I += dI; // Add the delta to the integral
+    double timeStep = (double)_timeStepMicros / (double)kSfeSTP3593LFNominalTimeStepMicros; // 1.0 except in the timed... calls
+    double dI = requiredChangeInLSBs * Ik * timeStep; // The integral accumulates over the time step - and so slews at the same rate
+    _integral += dI; // Add the delta to the integral
 
-    return setFrequencyControlWord((uint32_t)round(P + I)); // Set the control word to proportional plus integral
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    updateTemperatureModel(_integral);
+#endif
+
+    bool result = writeDisciplinedWord(P + _integral); // Set the control word to proportional plus integral
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    updatePullRangeModel();
+    if (_aggregator != nullptr)
+        _aggregator->addSample(_frequencyControl, bias * 1.0e6, _timeStepMicros); // Bias in nanos
+#endif
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    if (_recorder != nullptr)
+        _recorder->recordBias(bias, Pk, Ik, getLoopOutputWord(result), result, _timeStepMicros);
+#endif
+
+    return result;
 }
 
-/// @brief Save the frequency control value - to be reloaded at start-up
+/// @brief Set the frequency according to the GNSS receiver clock bias, corrected for the PPS sawtooth
+/// @param bias the GNSS RX clock bias in milliseconds
+/// @param sawtoothNanos the receiver-reported quantization (sawtooth) error for this epoch in nanoseconds
+/// @param Pk the Proportional term
+/// @param Ik the Integral term
 /// @return true if the write is successful
-bool SfeSTP3593LFDriver::saveFrequencyControlValue(void)
+bool SfeSTP3593LFDriver::setFrequencyByCorrectedBiasMillis(double bias, double sawtoothNanos, double Pk, double Ik)
 {
-    bool result = true;
-    result &= _theBus->writeByte(kSfeSTP3593LFRegSaveFrequency);
-    if (result)
-        result &= readFrequencyControlWord();
+    return setFrequencyByBiasMillis(bias - (sawtoothNanos * 1.0e-6), Pk, Ik); // Convert nanos to millis
+}
+
+/// @brief Set the frequency according to a timestamped GNSS receiver clock bias - for irregular or faster update rates
+/// @param timestampMicros the time of the measurement in microseconds
+/// @param bias the GNSS RX clock bias in milliseconds
+/// @param Pk the Proportional term
+/// @param Ik the Integral term
+/// @return true if the write is successful. false if the timestamp is not after the previous one (no write)
+bool SfeSTP3593LFDriver::setFrequencyByTimedBiasMillis(uint32_t timestampMicros, double bias, double Pk, double Ik)
+{
+    if (!beginTimeStep(timestampMicros))
+        return false;
+    bool result = setFrequencyByBiasMillis(bias, Pk, Ik);
+    _timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros;
     return result;
 }
 
+/// @brief Provide the oven / board temperature for this epoch - the optional temperature input channel
+/// @param degC the temperature in degrees C
+void SfeSTP3593LFDriver::setTemperature(double degC)
+{
+    if (!_temperatureValid)
+        _temperatureReference = degC; // The first temperature becomes the reference
+    _temperature = degC;
+    _temperatureValid = true;
+    updateTemperatureFeedForward();
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    if (_recorder != nullptr)
+        _recorder->recordTemperature(degC);
+#endif
+}
+
+/// @brief Enable or disable the temperature-compensation feed-forward to the control word
+/// @param enable true to add (coefficient * (temperature - reference)) to the control word
+void SfeSTP3593LFDriver::enableTemperatureCompensation(bool enable)
+{
+    double oldFeedForward = _temperatureFeedForward;
+    _temperatureCompensation = enable;
+    updateTemperatureFeedForward();
+
+    // Bumpless transfer: move the step in feed-forward out of the integrators, so that
+    // enabling or disabling compensation does not step the control word
+    double step = _temperatureFeedForward - oldFeedForward;
+    _integral -= step;
+    _integralQ16 -= (int64_t)(step * 65536.0);
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    if (_recorder != nullptr)
+        _recorder->recordSetting(kSfeSTP3593LFRecordTemperatureCompensation, enable);
+#endif
+}
+
+/// @brief Get the learned temperature coefficient
+/// @return The temperature coefficient in control word LSBs per degree C
+double SfeSTP3593LFDriver::getTemperatureCoefficient(void)
+{
+    return _temperatureTheta[1];
+}
+
+/// @brief Seed the temperature coefficient - e.g. from a previous run or a characterization
+/// @param lsbsPerDegC the temperature coefficient in control word LSBs per degree C
+void SfeSTP3593LFDriver::setTemperatureCoefficient(double lsbsPerDegC)
+{
+    _temperatureTheta[1] = lsbsPerDegC;
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    _temperatureCovariance[1] = 0.0;
+    _temperatureCovariance[2] = 0.0;
+    _temperatureCovariance[3] = 1.0; // Trust the seed: let the data move it only slowly
+#endif
+    updateTemperatureFeedForward();
+}
+
+/// @brief Get the temperature feed-forward currently applied to the control word
+/// @return The feed-forward in control word LSBs. Zero if compensation is disabled
+double SfeSTP3593LFDriver::getTemperatureFeedForward(void)
+{
+    return _temperatureFeedForward;
+}
+
+/// @brief Get the frequency control resolution the loop is using to convert bias to LSBs
+/// @return The resolution (fractional frequency per LSB)
+double SfeSTP3593LFDriver::getFreqControlResolution(void)
+{
+    return _freqControlResolution;
+}
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+/// @brief Set the forgetting factor of the temperature coefficient estimator
+/// @param lambda the forgetting factor, 0.0 - 1.0 (default 0.9999)
+void SfeSTP3593LFDriver::setTemperatureForgettingFactor(double lambda)
+{
+    if ((lambda > 0.0) && (lambda <= 1.0))
+        _temperatureLambda = lambda;
+}
+
+/// @brief Get the estimated frequency control resolution (fractional frequency per LSB)
+/// @return The resolution learned online from the bias response to control word changes
+double SfeSTP3593LFDriver::getEstimatedFreqControlResolution(void)
+{
+    return _resolutionTheta[1] * kSfeSTP3593LFFreqControlResolution;
+}
+
+/// @brief Get the 1-sigma uncertainty of the estimated frequency control resolution
+/// @return The uncertainty (fractional frequency per LSB)
+double SfeSTP3593LFDriver::getEstimatedFreqControlResolutionUncertainty(void)
+{
+    if (_resolutionSamples < 3)
+        return kSfeSTP3593LFFreqControlResolution; // No information yet
+    double variance = _resolutionCovariance[3] * _resolutionResidualVariance;
+    return sqrt(variance >= 0.0 ? variance : 0.0 - variance) * kSfeSTP3593LFFreqControlResolution;
+}
+
+/// @brief Feed the estimated resolution back into the bias-to-LSB conversion
+/// @param enable true to use the estimate once its uncertainty is below 10%; false to use 8E-13
+void SfeSTP3593LFDriver::useEstimatedFreqControlResolution(bool enable)
+{
+    _resolutionFeedback = enable;
+    if (!enable)
+        changeFreqControlResolution(kSfeSTP3593LFFreqControlResolution);
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    if (_recorder != nullptr)
+        _recorder->recordSetting(kSfeSTP3593LFRecordResolutionFeedback, enable);
+#endif
+}
+
+/// @brief Set the forgetting factor of the resolution estimator
+/// @param lambda the forgetting factor, 0.0 - 1.0 (default 0.999)
+void SfeSTP3593LFDriver::setFreqControlResolutionForgettingFactor(double lambda)
+{
+    if ((lambda > 0.0) && (lambda <= 1.0))
+        _resolutionLambda = lambda;
+}
+
+/// @brief Keep running statistics of the control word and the loop input - per minute, hour and day
+/// @param aggregator the aggregator. nullptr stops aggregating
+void SfeSTP3593LFDriver::setAggregator(SfeSTP3593LFAggregator *aggregator)
+{
+    _aggregator = aggregator;
+}
+
+/// @brief Forecast when the control word will reach the end of the pull range (0 or 1000000)
+/// @param days returns the expected time to the rail, in days of loop operation
+/// @param earliestDays returns the earliest time to either rail
+/// @param latestDays returns the latest time to the rail
+/// @return true once kSfeSTP3593LFPullRangeMinHours of trend have been seen
+bool SfeSTP3593LFDriver::getPullRangeForecast(double &days, double &earliestDays, double &latestDays)
+{
+    days = kSfeSTP3593LFPullRangeNeverDays;
+    earliestDays = kSfeSTP3593LFPullRangeNeverDays;
+    latestDays = kSfeSTP3593LFPullRangeNeverDays;
+    if (_pullRangeHours < kSfeSTP3593LFPullRangeMinHours)
+        return false;
+
+    // The word now, from the fit - not the last word, which carries the loop noise
+    double now = (double)_pullRangeHours / 24.0;
+    double word = (double)_pullRangeOriginWord + _pullRangeTheta[0] + (_pullRangeTheta[1] * now);
+    double trend = _pullRangeTheta[1];
+    double variance = _pullRangeCovariance[3] * _pullRangeResidualVariance;
+    double margin = 2.0 * sqrt(variance >= 0.0 ? variance : 0.0 - variance);
+
+    double toTop = (double)kSfeSTP3593LFFreqControlMaxValue - word;
+    double toBottom = word;
+    if (toTop < 0.0)
+        toTop = 0.0;
+    if (toBottom < 0.0)
+        toBottom = 0.0;
+
+    // Expected and latest: towards the rail the trend points at. Earliest: towards either rail
+    double distance = trend >= 0.0 ? toTop : toBottom;
+    double speed = trend >= 0.0 ? trend : 0.0 - trend;
+    if ((speed > 0.0) && (distance < (speed * kSfeSTP3593LFPullRangeNeverDays)))
+        days = distance / speed;
+    if ((speed > margin) && (distance < ((speed - margin) * kSfeSTP3593LFPullRangeNeverDays)))
+        latestDays = distance / (speed - margin);
+
+    double up = trend + margin; // The fastest plausible trend towards each rail
+    double down = margin - trend;
+    if ((up > 0.0) && (toTop < (up * earliestDays)))
+        earliestDays = toTop / up;
+    if ((down > 0.0) && (toBottom < (down * earliestDays)))
+        earliestDays = toBottom / down;
+
+    return true;
+}
+
+/// @brief Get the trend of the control word
+/// @return The trend in LSBs per day
+double SfeSTP3593LFDriver::getPullRangeTrendPerDay(void)
+{
+    return _pullRangeTheta[1];
+}
+
+/// @brief Set the warning threshold of the pull-range forecast
+/// @param days the warning is raised when the earliest time to a rail is less than this
+void SfeSTP3593LFDriver::setPullRangeWarningDays(double days)
+{
+    _pullRangeWarningDays = days;
+}
+
+/// @brief Check the pull-range warning
+/// @return true if the earliest time to a rail has fallen below the threshold
+bool SfeSTP3593LFDriver::getPullRangeWarning(void)
+{
+    return _pullRangeWarning;
+}
+
+/// @brief Clear the pull-range warning
+void SfeSTP3593LFDriver::clearPullRangeWarning(void)
+{
+    _pullRangeWarning = false;
+}
+
+/// @brief Set the forgetting factor of the pull-range trend estimator
+/// @param lambda the forgetting factor per hour, 0.0 - 1.0
+void SfeSTP3593LFDriver::setPullRangeForgettingFactor(double lambda)
+{
+    if ((lambda > 0.0) && (lambda <= 1.0))
+        _pullRangeLambda = lambda;
+}
+
+/// @brief Forget the pull-range trend
+void SfeSTP3593LFDriver::resetPullRangeForecast(void)
+{
+    _pullRangeHours = 0;
+    _pullRangeSamples = 0;
+    _pullRangeMicros = 0;
+    _pullRangeSumWord = 0.0;
+    _pullRangeTheta[0] = 0.0;
+    _pullRangeTheta[1] = 0.0;
+    _pullRangeCovariance[0] = kSfeSTP3593LFRLSInitialCovariance;
+    _pullRangeCovariance[1] = 0.0;
+    _pullRangeCovariance[2] = 0.0;
+    _pullRangeCovariance[3] = kSfeSTP3593LFRLSInitialCovariance;
+    _pullRangeResidualVariance = 0.0;
+    _pullRangeWarning = false;
+}
+#endif // SFE_STP3593LF_ENABLE_STATISTICS
+#endif // SFE_STP3593LF_FIXED_POINT
+
+/// @brief Use a piecewise-linear calibration table for the conversion from fractional frequency to control word
+/// @param table the table. The words must increase and the offsets must increase. nullptr disables the table
+/// @param numPoints the number of points in the table (2 - kSfeSTP3593LFMaxCalPoints)
+/// @return true if the table is valid and is now in use
+bool SfeSTP3593LFDriver::setCalibrationTable(const sfeSTP3593LFCalPoint_t *table, uint8_t numPoints)
+{
+    uint32_t referenceWord = linearQ16ToWord(_referenceLinearQ16); // The reference word is kept - as a word
+
+    if ((table == nullptr) || (numPoints == 0))
+    {
+        _calTable = nullptr;
+        _calPoints = 0;
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+        _integralInitialized = false; // The linearized word has changed. Re-seed the integrators
+#endif
+        _integralQ16Initialized = false;
+        _referenceLinearQ16 = wordToLinearQ16(referenceWord);
+        return true;
+    }
+
+    if ((numPoints < 2) || (numPoints > kSfeSTP3593LFMaxCalPoints))
+        return false;
+
+    if (!isCalibrationTableIncreasing(table, numPoints)) // Always: the interpolation divides by the steps
+        return false;
+
+    _calTable = table;
+    _calPoints = numPoints;
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+    _integralInitialized = false; // The linearized word has changed. Re-seed the integrators
+#endif
+    _integralQ16Initialized = false;
+    _referenceLinearQ16 = wordToLinearQ16(referenceWord);
+    return true;
+}
+
+/// @brief Get the calibration table in use
+/// @param numPoints returns the number of points in the table
+/// @return A pointer to the table. nullptr if no table is in use
+const sfeSTP3593LFCalPoint_t *SfeSTP3593LFDriver::getCalibrationTable(uint8_t &numPoints)
+{
+    numPoints = _calPoints;
+    return _calTable;
+}
+
+/// @brief Convert a control word to fractional frequency using the calibration table
+/// @param word the frequency control word
+/// @return The fractional frequency relative to the first point, in parts per 10^15
+int32_t SfeSTP3593LFDriver::getCalibratedOffsetE15(uint32_t word)
+{
+    if (_calTable == nullptr)
+        return (int32_t)(((int64_t)word - (int64_t)(kSfeSTP3593LFFreqControlMaxValue / 2)) * _e15PerLSB); // Linear about mid-range
+
+    // Binary search for the segment containing word. Words outside the table use the end segments
+    uint8_t lo = 0;
+    uint8_t hi = _calPoints - 1;
+    while ((hi - lo) > 1)
+    {
+        uint8_t mid = (lo + hi) / 2;
+        if (word < _calTable[mid].word)
+            hi = mid;
+        else
+            lo = mid;
+    }
+
+    // Interpolate
+    int64_t dw = (int64_t)_calTable[hi].word - (int64_t)_calTable[lo].word;
+    int64_t df = (int64_t)_calTable[hi].offsetE15 - (int64_t)_calTable[lo].offsetE15;
+    int64_t offset = (int64_t)_calTable[lo].offsetE15 + ((((int64_t)word - (int64_t)_calTable[lo].word) * df) / dw);
+    if (offset > (int64_t)INT32_MAX)
+        offset = INT32_MAX;
+    if (offset < (int64_t)INT32_MIN)
+        offset = INT32_MIN;
+    return (int32_t)offset;
+}
+
+/// @brief Convert a fractional frequency to a control word using the calibration table
+/// @param offsetE15 the fractional frequency relative to the first point, in parts per 10^15
+/// @return The frequency control word, limited to the pull range
+uint32_t SfeSTP3593LFDriver::getCalibratedWord(int32_t offsetE15)
+{
+    int64_t word;
+
+    if (_calTable == nullptr)
+    {
+        word = ((int64_t)(kSfeSTP3593LFFreqControlMaxValue / 2)) + (((int64_t)offsetE15 + (_e15PerLSB / 2)) / _e15PerLSB);
+    }
+    else
+    {
+        // Binary search for the segment containing offsetE15. Offsets outside the table use the end segments
+        uint8_t lo = 0;
+        uint8_t hi = _calPoints - 1;
+        while ((hi - lo) > 1)
+        {
+            uint8_t mid = (lo + hi) / 2;
+            if (offsetE15 < _calTable[mid].offsetE15)
+                hi = mid;
+            else
+                lo = mid;
+        }
+
+        // Interpolate, rounding to the nearest word
+        int64_t dw = (int64_t)_calTable[hi].word - (int64_t)_calTable[lo].word;
+        int64_t df = (int64_t)_calTable[hi].offsetE15 - (int64_t)_calTable[lo].offsetE15;
+        int64_t num = ((int64_t)offsetE15 - (int64_t)_calTable[lo].offsetE15) * dw;
+        num += (num >= 0) ? (df / 2) : (0 - (df / 2));
+        word = (int64_t)_calTable[lo].word + (num / df);
+    }
+
+    if (word < 0)
+        word = 0;
+    if (word > (int64_t)kSfeSTP3593LFFreqControlMaxValue)
+        word = kSfeSTP3593LFFreqControlMaxValue;
+    return (uint32_t)word;
+}
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+/// @brief Start a calibration sweep: step the control word across the range and measure the frequency at each step
+/// @param table the table to fill. It is used via setCalibrationTable when the sweep completes
+/// @param numPoints the number of points to measure (2 - kSfeSTP3593LFMaxCalPoints)
+/// @param firstWord the first control word of the sweep
+/// @param lastWord the last control word of the sweep
+/// @param dwellEpochs the number of epochs to measure the bias rate at each point
+/// @param settleEpochs the number of epochs to wait after each step before measuring
+/// @return true if the sweep has started
+bool SfeSTP3593LFDriver::beginCalibrationSweep(sfeSTP3593LFCalPoint_t *table, uint8_t numPoints, uint32_t firstWord,
+                                               uint32_t lastWord, uint16_t dwellEpochs, uint16_t settleEpochs)
+{
+    if ((table == nullptr) || (numPoints < 2) || (numPoints > kSfeSTP3593LFMaxCalPoints))
+        return false;
+    if (lastWord > kSfeSTP3593LFFreqControlMaxValue)
+        lastWord = kSfeSTP3593LFFreqControlMaxValue;
+    if ((firstWord >= lastWord) || ((lastWord - firstWord) < (uint32_t)(numPoints - 1)))
+        return false;
+    if (dwellEpochs < 2)
+        return false;
+    if (!ensureFrequencyControlWord()) // Before any sweep state: a failed read leaves no sweep running
+        return false;
+
+    _sweepSavedWord = _frequencyControl;
+    _sweepTable = table;
+    _sweepPoints = numPoints;
+    _sweepIndex = 0;
+    _sweepFirstWord = firstWord;
+    _sweepLastWord = lastWord;
+    _sweepDwellEpochs = dwellEpochs;
+    _sweepSettleEpochs = settleEpochs;
+    _sweepEpoch = 0;
+    _sweepSumT = 0.0;
+    _sweepSumB = 0.0;
+    _sweepSumTT = 0.0;
+    _sweepSumTB = 0.0;
+
+    _sweepTable[0].word = firstWord;
+    _sweepResult = kSfeSTP3593LFSweepRunning;
+    if (setFrequencyControlWord(firstWord))
+        return true;
+
+    endCalibrationSweep(kSfeSTP3593LFSweepWriteFailed);
+    return false;
+}
+
+/// @brief Run one epoch of the calibration sweep
+/// @param bias the GNSS RX clock bias in milliseconds
+/// @return true while the sweep is running. false once it is complete (or if a write failed)
+bool SfeSTP3593LFDriver::updateCalibrationSweep(double bias)
+{
+    if (_sweepTable == nullptr)
+        return false;
+
+    uint16_t epoch = _sweepEpoch++;
+    if (epoch < _sweepSettleEpochs)
+        return true; // Wait for the oscillator (and the receiver's clock model) to settle
+
+    // Accumulate the linear regression of bias against epoch
+    double t = (double)(epoch - _sweepSettleEpochs);
+    if (t == 0.0)
+        _sweepFirstBias = bias;
+    double b = bias - _sweepFirstBias;
+    _sweepSumT += t;
+    _sweepSumB += b;
+    _sweepSumTT += t * t;
+    _sweepSumTB += t * b;
+
+    if (epoch < (_sweepSettleEpochs + _sweepDwellEpochs - 1))
+        return true;
+
+    return nextCalibrationSweepPoint();
+}
+
+/// @brief Get the outcome of the last calibration sweep
+/// @return kSfeSTP3593LFSweepApplied if the table is in use
+sfeSTP3593LFSweepResult_t SfeSTP3593LFDriver::getCalibrationSweepResult(void)
+{
+    return _sweepResult;
+}
+
+/// @brief Check if a calibration sweep is running
+/// @return true if a calibration sweep is running
+bool SfeSTP3593LFDriver::isCalibrationSweepRunning(void)
+{
+    return (_sweepTable != nullptr);
+}
+
+/// @brief Get the progress of the calibration sweep
+/// @return The progress in percent
+uint8_t SfeSTP3593LFDriver::getCalibrationSweepProgress(void)
+{
+    if (_sweepTable == nullptr)
+        return 100;
+    uint32_t epochsPerPoint = (uint32_t)_sweepSettleEpochs + (uint32_t)_sweepDwellEpochs;
+    uint32_t done = ((uint32_t)_sweepIndex * epochsPerPoint) + (uint32_t)_sweepEpoch;
+    return (uint8_t)((done * 100) / ((uint32_t)_sweepPoints * epochsPerPoint));
+}
+#endif
+
+/// @brief Enable or disable error feedback (noise shaping) in the rounding of the loop output
+/// @param enable true to carry each epoch's rounding residual into the next epoch's output
+void SfeSTP3593LFDriver::enableErrorFeedback(bool enable)
+{
+    _errorFeedback = enable;
+    _quantizationResidualQ16 = 0;
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    if (_recorder != nullptr)
+        _recorder->recordSetting(kSfeSTP3593LFRecordErrorFeedback, enable);
+#endif
+}
+
+/// @brief Get the remainder discarded by the most recent rounding of the loop output
+/// @return The residual in control word LSBs, Q16 (65536 == 1 LSB)
+int32_t SfeSTP3593LFDriver::getQuantizationResidualQ16(void)
+{
+    return _quantizationResidualQ16;
+}
+
+/// @brief Set the frequency offset relative to the reference word, in parts per 10^15
+/// @param offsetE15 the fractional frequency offset in parts per 10^15
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::setFrequencyOffsetE15(int32_t offsetE15)
+{
+    if (!ensureReferenceWord())
+        return false;
+
+    // Convert once, here: one linearized LSB is _e15PerLSB parts per 10^15, with or without a table
+    return writeLinearQ16(_referenceLinearQ16 + ((((int64_t)offsetE15) * 65536) / _e15PerLSB));
+}
+
+/// @brief Get the frequency offset of the current word relative to the reference word
+/// @return The fractional frequency offset in parts per 10^15. 0 if the word cannot be read
+int32_t SfeSTP3593LFDriver::getFrequencyOffsetE15(void)
+{
+    if (!ensureReferenceWord())
+        return 0;
+
+    int64_t offsetE15 = ((wordToLinearQ16(_frequencyControl) - _referenceLinearQ16) * _e15PerLSB) / 65536;
+    if (offsetE15 > (int64_t)INT32_MAX)
+        offsetE15 = INT32_MAX;
+    if (offsetE15 < (int64_t)INT32_MIN)
+        offsetE15 = INT32_MIN;
+    return (int32_t)offsetE15;
+}
+
+/// @brief Get the reference word: the word which gives zero frequency offset
+/// @return The reference word, rounded. 0 if it is not known and the word cannot be read
+uint32_t SfeSTP3593LFDriver::getReferenceWord(void)
+{
+    if (!ensureReferenceWord())
+        return 0;
+    return linearQ16ToWord(_referenceLinearQ16);
+}
+
+/// @brief Set the reference word - e.g. from a characterization, or from a previous run
+/// @param word the frequency control word which gives zero frequency offset
+void SfeSTP3593LFDriver::setReferenceWord(uint32_t word)
+{
+    if (word > kSfeSTP3593LFFreqControlMaxValue)
+        word = kSfeSTP3593LFFreqControlMaxValue;
+    _referenceLinearQ16 = wordToLinearQ16(word);
+    _referenceValid = true;
+}
+
+/// @brief Refine the reference word from the loop's integrator - one epoch of its time constant
+void SfeSTP3593LFDriver::refineReferenceWord(void)
+{
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+    if (_integralInitialized)
+    {
+        moveReferenceWord((int64_t)floor((_integral * 65536.0) + 0.5));
+        return;
+    }
+#endif
+    if (_integralQ16Initialized)
+        moveReferenceWord(_integralQ16);
+}
+
+/// @brief Start steering out a known phase (time) offset: offset the frequency for a while, then return
+/// @param nanos the phase correction in nanoseconds. Positive runs the oscillator fast
+/// @param durationEpochs the epochs (seconds) to spread the correction over
+/// @return true if the steering has started
+bool SfeSTP3593LFDriver::beginPhaseSteering(int32_t nanos, uint32_t durationEpochs)
+{
+    if ((nanos == 0) || (nanos > kSfeSTP3593LFMaxSteeringNanos) || (nanos < (0 - kSfeSTP3593LFMaxSteeringNanos)))
+        return false;
+    if (durationEpochs == 0)
+        return false;
+    if (!ensureFrequencyControlWord())
+        return false;
+
+    // One LSB for one epoch moves the phase by _e15PerLSB femtoseconds. Convert once, here
+    _steerTotalQ16 = (((int64_t)nanos) * 1000000 * 65536) / _e15PerLSB;
+
+    // Extend the duration if the offset would exceed the maximum frequency change
+    int64_t totalLSBs = ((_steerTotalQ16 >= 0 ? _steerTotalQ16 : 0 - _steerTotalQ16) + 32768) >> 16;
+    int64_t maxLSBs = _maxChangeLSBs > 0 ? _maxChangeLSBs : 1;
+    int64_t minEpochs = (totalLSBs + maxLSBs - 1) / maxLSBs;
+    if (minEpochs > (int64_t)UINT32_MAX)
+        return false;
+    if ((int64_t)durationEpochs < minEpochs)
+        durationEpochs = (uint32_t)minEpochs;
+
+    _steerBaseLinearQ16 = wordToLinearQ16(_frequencyControl);
+    _steerAppliedQ16 = 0;
+    _steerEpochs = durationEpochs;
+    _steerEpoch = 0;
+    _steerWrites = 0;
+    _steering = true;
+    _steerResult = kSfeSTP3593LFSteeringRunning;
+
+    uint32_t word = linearQ16ToWord(_steerBaseLinearQ16 + (((int64_t)nextPhaseSteeringOffset()) << 16));
+    if (word == _frequencyControl)
+        return true;
+    _steerWrites++;
+    if (setFrequencyControlWord(word))
+        return true;
+
+    _steering = false;
+    _steerResult = kSfeSTP3593LFSteeringWriteFailed;
+    return false;
+}
+
+/// @brief Run one epoch of the phase steering. Call it once per epoch (second)
+/// @return true while the steering is running. false once it is complete
+bool SfeSTP3593LFDriver::updatePhaseSteering(void)
+{
+    if (!_steering)
+        return false;
+
+    // The epoch which has just ended ran at the word in effect - which may not be the word planned
+    _steerAppliedQ16 += wordToLinearQ16(_frequencyControl) - _steerBaseLinearQ16;
+    _steerEpoch++;
+
+    if (_steerEpoch >= _steerEpochs)
+        return !restorePhaseSteeringWord(); // Complete - or retry the restore next epoch
+
+    uint32_t word = linearQ16ToWord(_steerBaseLinearQ16 + (((int64_t)nextPhaseSteeringOffset()) << 16));
+    if (word != _frequencyControl)
+    {
+        _steerWrites++;
+        setFrequencyControlWord(word); // If this fails, the next epoch makes up for it
+    }
+
+    return true;
+}
+
+/// @brief Stop the phase steering early and restore the original word
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::cancelPhaseSteering(void)
+{
+    if (!_steering)
+        return true;
+
+    _steerEpochs = _steerEpoch; // End now: if the restore fails, updatePhaseSteering retries it
+    return restorePhaseSteeringWord();
+}
+
+/// @brief Get the outcome of the last phase steering
+/// @return The outcome
+sfeSTP3593LFSteeringResult_t SfeSTP3593LFDriver::getPhaseSteeringResult(void)
+{
+    return _steerResult;
+}
+
+/// @brief Check if phase steering is running
+/// @return true if phase steering is running
+bool SfeSTP3593LFDriver::isPhaseSteeringRunning(void)
+{
+    return _steering;
+}
+
+/// @brief Get the planned duration of the phase steering
+/// @return The duration in epochs
+uint32_t SfeSTP3593LFDriver::getPhaseSteeringEpochs(void)
+{
+    return _steerEpochs;
+}
+
+/// @brief Get the progress of the phase steering
+/// @return The progress in percent
+uint8_t SfeSTP3593LFDriver::getPhaseSteeringProgress(void)
+{
+    if ((!_steering) || (_steerEpoch >= _steerEpochs))
+        return 100;
+    return (uint8_t)(((uint64_t)_steerEpoch * 100) / _steerEpochs);
+}
+
+/// @brief Get the phase still to be steered out
+/// @return The residual in picoseconds
+int64_t SfeSTP3593LFDriver::getPhaseSteeringResidualPicoseconds(void)
+{
+    int64_t remainingQ16 = _steerTotalQ16 - _steerAppliedQ16;
+    return (((remainingQ16 / 1000) * _e15PerLSB) + 32768) >> 16; // Divide first: 100ms * 65536 * 800 overflows int64_t
+}
+
+/// @brief Get the number of writes made by the phase steering
+/// @return The number of writes
+uint32_t SfeSTP3593LFDriver::getPhaseSteeringWrites(void)
+{
+    return _steerWrites;
+}
+
+/// @brief Configure the time-interval-counter (TIC) input used by setFrequencyByTICCount
+/// @param tickPicoseconds the duration of one capture count in picoseconds
+/// @param counterBits the width of the capture counter in bits (1-32)
+/// @param countsPerEpoch the nominal count increment per epoch
+/// @param referenceCount the capture count which corresponds to zero phase error
+void SfeSTP3593LFDriver::setTICConfiguration(uint32_t tickPicoseconds, uint8_t counterBits, uint32_t countsPerEpoch, uint32_t referenceCount)
+{
+    if (counterBits == 0)
+        counterBits = 1;
+    if (counterBits > 32)
+        counterBits = 32;
+
+    _ticTickPicoseconds = tickPicoseconds;
+    _ticCountMask = (counterBits == 32) ? 0xFFFFFFFF : ((((uint32_t)1) << counterBits) - 1);
+    _ticCountsPerEpoch = countsPerEpoch & _ticCountMask;
+    _ticReferenceCount = referenceCount & _ticCountMask;
+    _ticPhasePicoseconds = 0;
+    _ticInitialized = false;
+}
+
+/// @brief Set the frequency according to a raw TIC capture count. Integer-only arithmetic
+/// @param captureCount the raw capture count for this epoch
+/// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+/// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::setFrequencyByTICCount(uint32_t captureCount, int32_t PkQ16, int32_t IkQ16)
+{
+    return setFrequencyByPhasePicoseconds(unwrapTICCount(captureCount), PkQ16, IkQ16);
+}
+
+/// @brief Set the frequency according to a raw TIC capture count, corrected for the PPS sawtooth
+/// @param captureCount the raw capture count for this epoch
+/// @param sawtoothPicoseconds the receiver-reported quantization (sawtooth) error for this PPS edge in picoseconds
+/// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+/// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::setFrequencyByCorrectedTICCount(uint32_t captureCount, int32_t sawtoothPicoseconds, int32_t PkQ16, int32_t IkQ16)
+{
+    return setFrequencyByCorrectedPhasePicoseconds(unwrapTICCount(captureCount), sawtoothPicoseconds, PkQ16, IkQ16);
+}
+
+/// @brief  PRIVATE: unwrap a raw TIC capture count into the continuous phase
+/// @param  captureCount the raw capture count for this epoch
+/// @return The unwrapped phase in picoseconds, limited to the int32_t range
+int32_t SfeSTP3593LFDriver::unwrapTICCount(uint32_t captureCount)
+{
+    captureCount &= _ticCountMask;
+
+    // The difference is taken modulo 2^counterBits, then sign-extended. This keeps the phase
+    // continuous when the counter wraps, provided it moves less than half the counter range per epoch
+    uint32_t diff;
+    if (!_ticInitialized)
+        diff = (captureCount - _ticReferenceCount) & _ticCountMask;
+    else
+        diff = (captureCount - _ticLastCount - _ticCountsPerEpoch) & _ticCountMask;
+
+    int64_t delta = (int64_t)diff;
+    if (diff > (_ticCountMask >> 1))
+        delta -= ((int64_t)_ticCountMask) + 1;
+
+    if (!_ticInitialized)
+        _ticPhasePicoseconds = 0;
+    _ticPhasePicoseconds += delta * (int64_t)_ticTickPicoseconds;
+    _ticLastCount = captureCount;
+    _ticInitialized = true;
+
+    // Limit the phase to what setFrequencyByPhasePicoseconds can accept
+    int64_t phase = _ticPhasePicoseconds;
+    if (phase > (int64_t)INT32_MAX)
+        phase = INT32_MAX;
+    if (phase < (int64_t)INT32_MIN)
+        phase = INT32_MIN;
+
+    return (int32_t)phase;
+}
+
+/// @brief Set the frequency according to the PPS-to-oscillator phase in picoseconds. Integer-only arithmetic
+/// @param phase the phase in picoseconds. Positive means the oscillator is ahead (same sense as the clock bias)
+/// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+/// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::setFrequencyByPhasePicoseconds(int32_t phase, int32_t PkQ16, int32_t IkQ16)
+{
+    if (!_integralQ16Initialized)
+    {
+        if (!ensureFrequencyControlWord())
+            return false;
+        _integralQ16 = wordToLinearQ16(_frequencyControl); // Initialize I with the current control word
+        _integralQ16Initialized = true;
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+        _integralInitialized = false; // Re-seed the floating-point path if it is used later
+#endif
+    }
+
+    // Our setpoint is zero. Phase is the process value. Convert it to error in control word LSBs (Q16)
+    // One picosecond per one second epoch is 1E-12, which is 1.25 LSBs at 8E-13 per LSB
+    int64_t requiredChangeQ16 = (0 - (int64_t)phase) * (int64_t)_lsbsPerPicosecondQ16;
+
+    // Limit requiredChangeQ16 to +/-maxChange
+    int64_t maxChangeQ16 = ((int64_t)_maxChangeLSBs) << 16;
+    if (requiredChangeQ16 > maxChangeQ16)
+        requiredChangeQ16 = maxChangeQ16;
+    if (requiredChangeQ16 < (0 - maxChangeQ16))
+        requiredChangeQ16 = 0 - maxChangeQ16;
+
+    // Both products fit comfortably in 64 bits: |requiredChangeQ16| <= 1000000 * 65536
+    int64_t P = (requiredChangeQ16 * (int64_t)PkQ16) / 65536;
+    int64_t dI = (requiredChangeQ16 * (int64_t)IkQ16) / 65536;
+    if (_timeStepMicros != kSfeSTP3593LFNominalTimeStepMicros) // The integral accumulates over the time step - and so slews at the same rate
+        dI = (dI * (int64_t)_timeStepMicros) / (int64_t)kSfeSTP3593LFNominalTimeStepMicros;
+    _integralQ16 += dI; // Add the delta to the integral
+
+    bool result;
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+    if (_temperatureValid) // Only drop into floating point if the temperature channel is in use
+    {
+#if SFE_STP3593LF_ENABLE_STATISTICS
+        updateTemperatureModel((double)_integralQ16 / 65536.0);
+#endif
+        result = writeDisciplinedWord((double)(P + _integralQ16) / 65536.0);
+    }
+    else
+#endif
+    {
+        // Round to the nearest LSB (or dither) and limit to the pull range
+        result = writeLinearQ16(P + _integralQ16); // Set the control word to proportional plus integral
+    }
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    updatePullRangeModel();
+    if (_aggregator != nullptr)
+        _aggregator->addSample(_frequencyControl, (double)phase * 1.0e-3, _timeStepMicros); // Phase in nanos
+#endif
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    if (_recorder != nullptr)
+        _recorder->recordPhase(phase, PkQ16, IkQ16, getLoopOutputWord(result), result, _timeStepMicros);
+#endif
+
+    return result;
+}
+
+/// @brief Set the frequency according to the PPS-to-oscillator phase, corrected for the PPS sawtooth
+/// @param phase the phase in picoseconds. Positive means the oscillator is ahead
+/// @param sawtoothPicoseconds the receiver-reported quantization (sawtooth) error for this PPS edge in picoseconds
+/// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+/// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::setFrequencyByCorrectedPhasePicoseconds(int32_t phase, int32_t sawtoothPicoseconds, int32_t PkQ16, int32_t IkQ16)
+{
+    // Subtract in 64 bits and limit, so a large sawtooth cannot wrap the phase
+    int64_t corrected = (int64_t)phase - (int64_t)sawtoothPicoseconds;
+    if (corrected > (int64_t)INT32_MAX)
+        corrected = INT32_MAX;
+    if (corrected < (int64_t)INT32_MIN)
+        corrected = INT32_MIN;
+
+    return setFrequencyByPhasePicoseconds((int32_t)corrected, PkQ16, IkQ16);
+}
+
+/// @brief Get the unwrapped TIC phase from the most recent setFrequencyByTICCount
+/// @return The phase in picoseconds
+int64_t SfeSTP3593LFDriver::getTICPhasePicoseconds(void)
+{
+    return _ticPhasePicoseconds;
+}
+
+/// @brief Set the frequency according to a timestamped PPS-to-oscillator phase. Integer-only arithmetic
+/// @param timestampMicros the time of the measurement in microseconds
+/// @param phase the phase in picoseconds. Positive means the oscillator is ahead
+/// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+/// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+/// @return true if the write is successful. false if the timestamp is not after the previous one (no write)
+bool SfeSTP3593LFDriver::setFrequencyByTimedPhasePicoseconds(uint32_t timestampMicros, int32_t phase, int32_t PkQ16, int32_t IkQ16)
+{
+    if (!beginTimeStep(timestampMicros))
+        return false;
+    bool result = setFrequencyByPhasePicoseconds(phase, PkQ16, IkQ16);
+    _timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros;
+    return result;
+}
+
+/// @brief Set the longest time step the timed... calls integrate over
+/// @param milliseconds the maximum time step (default 4000, limited to 1 - 60000)
+void SfeSTP3593LFDriver::setMaxTimeStepMillis(uint32_t milliseconds)
+{
+    if (milliseconds < 1)
+        milliseconds = 1;
+    if (milliseconds > 60000) // Keeps the scaled Q16 integral step within 64 bits
+        milliseconds = 60000;
+    _maxTimeStepMicros = milliseconds * 1000;
+}
+
+/// @brief Get the time step used by the most recent timed... call
+/// @return The time step in microseconds, after any gap limiting
+uint32_t SfeSTP3593LFDriver::getTimeStepMicros(void)
+{
+    return _lastTimeStepMicros;
+}
+
+/// @brief Get the number of timed samples dropped because their timestamp was not after the previous one
+/// @return The number of samples
+uint32_t SfeSTP3593LFDriver::getTimeStepRejections(void)
+{
+    return _timeStepRejections;
+}
+
+/// @brief Get the number of timed samples whose time step was limited by setMaxTimeStepMillis
+/// @return The number of samples
+uint32_t SfeSTP3593LFDriver::getTimeStepGaps(void)
+{
+    return _timeStepGaps;
+}
+
+/// @brief Apply queued samples with the time step between their queue timestamps
+/// @param enable true to make serviceDiscipline behave like the timed... calls
+void SfeSTP3593LFDriver::useSampleTimestamps(bool enable)
+{
+    _useSampleTimestamps = enable;
+}
+
+/// @brief Queue a raw TIC capture count for serviceDiscipline. Wait-free and ISR-safe
+/// @param captureCount the raw capture count for this epoch
+/// @param sawtoothPicoseconds the receiver-reported quantization (sawtooth) error for this PPS edge in picoseconds
+/// @return true if the sample was queued. false if the queue is full (the sample is dropped)
+bool SfeSTP3593LFDriver::queueTICCount(uint32_t captureCount, int32_t sawtoothPicoseconds)
+{
+    return queueSample(kSfeSTP3593LFSampleTICCount, (int32_t)captureCount, sawtoothPicoseconds);
+}
+
+/// @brief Queue the PPS-to-oscillator phase for serviceDiscipline. Wait-free and ISR-safe
+/// @param phase the phase in picoseconds. Positive means the oscillator is ahead
+/// @param sawtoothPicoseconds the receiver-reported quantization (sawtooth) error for this PPS edge in picoseconds
+/// @return true if the sample was queued. false if the queue is full (the sample is dropped)
+bool SfeSTP3593LFDriver::queuePhasePicoseconds(int32_t phase, int32_t sawtoothPicoseconds)
+{
+    return queueSample(kSfeSTP3593LFSamplePhase, phase, sawtoothPicoseconds);
+}
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+/// @brief Queue the GNSS receiver clock bias for serviceDiscipline (via updateDiscipline). Wait-free
+/// @param bias the GNSS RX clock bias in milliseconds. Limited to +/-2.1ms
+/// @param sawtoothNanos the receiver-reported quantization (sawtooth) error for this epoch in nanoseconds
+/// @param biasValid false if the GNSS receiver could not provide a bias this epoch (enters holdover)
+/// @return true if the sample was queued
+bool SfeSTP3593LFDriver::queueBiasMillis(double bias, double sawtoothNanos, bool biasValid)
+{
+    if (!biasValid)
+        return queueSample(kSfeSTP3593LFSampleNoBias, 0, 0);
+
+    // Carry the bias as integer picoseconds: the queue is the same for every sample type
+    double biasPicoseconds = round(bias * 1.0e9);
+    if (biasPicoseconds > (double)INT32_MAX)
+        biasPicoseconds = (double)INT32_MAX;
+    if (biasPicoseconds < (double)INT32_MIN)
+        biasPicoseconds = (double)INT32_MIN;
+    double sawtoothPicoseconds = round(sawtoothNanos * 1.0e3);
+    if (sawtoothPicoseconds > (double)INT32_MAX)
+        sawtoothPicoseconds = (double)INT32_MAX;
+    if (sawtoothPicoseconds < (double)INT32_MIN)
+        sawtoothPicoseconds = (double)INT32_MIN;
+
+    return queueSample(kSfeSTP3593LFSampleBias, (int32_t)biasPicoseconds, (int32_t)sawtoothPicoseconds);
+}
+#endif
+
+/// @brief Apply every queued sample, oldest first - writing the control word over I2C. Task context only
+/// @return The number of samples applied
+uint8_t SfeSTP3593LFDriver::serviceDiscipline(void)
+{
+    uint8_t serviced = 0;
+    sfeSTP3593LFSample_t sample;
+
+    while (_sampleQueue.pop(sample))
+    {
+        bool result = true;
+
+        if (_useSampleTimestamps && (!beginTimeStep(sample.timestamp)))
+            continue; // Counted by getTimeStepRejections
+
+        switch (sample.type)
+        {
+        case kSfeSTP3593LFSampleTICCount:
+            result = setFrequencyByCorrectedTICCount((uint32_t)sample.value, sample.sawtoothPicoseconds, _queuePkQ16, _queueIkQ16);
+            break;
+        case kSfeSTP3593LFSamplePhase:
+            result = setFrequencyByCorrectedPhasePicoseconds(sample.value, sample.sawtoothPicoseconds, _queuePkQ16, _queueIkQ16);
+            break;
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+        case kSfeSTP3593LFSampleBias:
+            result = updateDisciplineCorrected((double)sample.value * 1.0e-9, (double)sample.sawtoothPicoseconds * 1.0e-3); // Picoseconds to millis and nanos
+            break;
+        case kSfeSTP3593LFSampleNoBias:
+            result = updateDiscipline(0.0, false);
+            break;
+#endif
+        default:
+            break;
+        }
+        _timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros;
+
+        if (!result)
+            _sampleWriteFailures++;
+
+        uint32_t latency = micros() - sample.timestamp;
+        if (latency > _sampleMaxLatency)
+            _sampleMaxLatency = latency;
+
+        serviced++;
+    }
+
+    return serviced;
+}
+
+/// @brief Set the gains serviceDiscipline uses for TIC and phase samples
+/// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+/// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+void SfeSTP3593LFDriver::setQueueGainsQ16(int32_t PkQ16, int32_t IkQ16)
+{
+    _queuePkQ16 = PkQ16;
+    _queueIkQ16 = IkQ16;
+}
+
+/// @brief Get the longest time from queue... to the end of its write in serviceDiscipline
+/// @return The maximum latency in microseconds
+uint32_t SfeSTP3593LFDriver::getMaxSampleLatencyMicros(void)
+{
+    return _sampleMaxLatency;
+}
+
+/// @brief Get the number of samples dropped because the queue was full
+/// @return The number of samples
+uint16_t SfeSTP3593LFDriver::getSampleQueueOverflows(void)
+{
+    return _sampleQueue.getOverflowCount();
+}
+
+/// @brief Get the number of queued samples whose write failed
+/// @return The number of samples
+uint32_t SfeSTP3593LFDriver::getSampleWriteFailures(void)
+{
+    return _sampleWriteFailures;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+/// @brief Start a FreeRTOS task which calls serviceDiscipline each time a sample is queued
+/// @param priority the task priority
+/// @param core the core to pin the task to. -1 for either core
+/// @return true if the task is running
+bool SfeSTP3593LFDriver::startDisciplineTask(uint8_t priority, int8_t core)
+{
+    if (_disciplineTask != nullptr)
+        return true; // Already running
+
+    BaseType_t result;
+    if (core < 0)
+        result = xTaskCreate(disciplineTask, "STP3593LF", 4096, this, priority, &_disciplineTask);
+    else
+        result = xTaskCreatePinnedToCore(disciplineTask, "STP3593LF", 4096, this, priority, &_disciplineTask, core);
+
+    return (result == pdPASS);
+}
+#endif
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+/// @brief Run one epoch of the discipline state machine and set the frequency using the gains for the new state
+/// @param bias the GNSS RX clock bias in milliseconds
+/// @param biasValid false if the GNSS receiver could not provide a bias this epoch (enters holdover)
+/// @return true if successful. No write is performed in warm-up and holdover
+bool SfeSTP3593LFDriver::updateDiscipline(double bias, bool biasValid)
+{
+    _disciplineActive = true;
+
+    // Advance the epoch counts by whole seconds. Always exactly one, except in updateDisciplineTimed
+    _epochMicros += _timeStepMicros;
+    uint32_t epochs = _epochMicros / kSfeSTP3593LFNominalTimeStepMicros;
+    _epochMicros -= epochs * kSfeSTP3593LFNominalTimeStepMicros;
+    _stateEpochs += epochs;
+
+    if (_disciplineState == kSfeSTP3593LFStateWarmup)
+    {
+        if (_stateEpochs <= _warmupEpochs)
+        {
+#if SFE_STP3593LF_ENABLE_STATISTICS
+            updatePullRangeModel(); // Time only: a held word is not a sample
+#endif
+            return true; // Hold the control word while the oven warms up
+        }
+        enterDisciplineState(kSfeSTP3593LFStateAcquisition);
+    }
+
+    if (!biasValid)
+    {
+        if (_disciplineState != kSfeSTP3593LFStateHoldover)
+            enterDisciplineState(kSfeSTP3593LFStateHoldover);
+#if SFE_STP3593LF_ENABLE_STATISTICS
+        updatePullRangeModel(); // Time only: the oscillator ages through holdover
+#endif
+        return true; // Hold the control word - the integrator keeps the last good value
+    }
+
+    if (_disciplineState == kSfeSTP3593LFStateHoldover)
+        enterDisciplineState(kSfeSTP3593LFStateTracking); // Resume. Drops to acquisition below if the bias is large
+
+    // Update the exponentially-weighted statistics of the bias. A weight of 1/16 gives
+    // a time constant of ~16 epochs: long enough to average the measurement noise,
+    // short enough to notice a loss of lock within the lock count
+    double alpha = (1.0 / 16.0) * ((double)_timeStepMicros / (double)kSfeSTP3593LFNominalTimeStepMicros);
+    if (alpha > 1.0)
+        alpha = 1.0;
+    double delta = bias - _biasMean;
+    _biasMean += alpha * delta;
+    _biasVariance = (1.0 - alpha) * (_biasVariance + alpha * delta * delta);
+    double rms = sqrt((_biasMean * _biasMean) + _biasVariance);
+    double absBias = bias >= 0.0 ? bias : 0.0 - bias;
+
+    switch (_disciplineState)
+    {
+    case kSfeSTP3593LFStateAcquisition:
+        if (absBias < _acquisitionThresholdMillis)
+        {
+            _lockCount += epochs;
+            if (_lockCount >= _lockEpochs)
+                enterDisciplineState(kSfeSTP3593LFStateTracking);
+        }
+        else
+            _lockCount = 0;
+        break;
+    case kSfeSTP3593LFStateTracking:
+        if (absBias > _acquisitionThresholdMillis)
+            enterDisciplineState(kSfeSTP3593LFStateAcquisition);
+        else if (rms < _lockThresholdMillis)
+        {
+            _lockCount += epochs;
+            if (_lockCount >= _lockEpochs)
+                enterDisciplineState(kSfeSTP3593LFStateLocked);
+        }
+        else
+            _lockCount = 0;
+        break;
+    case kSfeSTP3593LFStateLocked:
+        if (absBias > _acquisitionThresholdMillis)
+            enterDisciplineState(kSfeSTP3593LFStateAcquisition);
+        else if (rms > (2.0 * _lockThresholdMillis)) // Hysteresis: unlock at twice the lock threshold
+            enterDisciplineState(kSfeSTP3593LFStateTracking);
+        break;
+    default:
+        break;
+    }
+
+    bool result = setFrequencyByBiasMillis(bias, _disciplinePk[_disciplineState], _disciplineIk[_disciplineState]);
+
+    // Once locked, the integrator is the word which holds the oscillator on frequency: follow it
+    if (_disciplineState == kSfeSTP3593LFStateLocked)
+        refineReferenceWord();
+
+    return result;
+}
+
+/// @brief Run one epoch of the discipline state machine using a sawtooth-corrected bias
+/// @param bias the GNSS RX clock bias in milliseconds
+/// @param sawtoothNanos the receiver-reported quantization (sawtooth) error for this epoch in nanoseconds
+/// @param biasValid false if the GNSS receiver could not provide a bias this epoch (enters holdover)
+/// @return true if successful
+bool SfeSTP3593LFDriver::updateDisciplineCorrected(double bias, double sawtoothNanos, bool biasValid)
+{
+    return updateDiscipline(bias - (sawtoothNanos * 1.0e-6), biasValid); // Convert nanos to millis
+}
+
+/// @brief Run one step of the discipline state machine with a timestamped bias
+/// @param timestampMicros the time of the measurement in microseconds
+/// @param bias the GNSS RX clock bias in milliseconds
+/// @param biasValid false if the GNSS receiver could not provide a bias (enters holdover)
+/// @return true if successful. false if the timestamp is not after the previous one
+bool SfeSTP3593LFDriver::updateDisciplineTimed(uint32_t timestampMicros, double bias, bool biasValid)
+{
+    if (!beginTimeStep(timestampMicros))
+        return false;
+    bool result = updateDiscipline(bias, biasValid);
+    _timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros;
+    return result;
+}
+
+/// @brief Get the current state of the discipline state machine
+/// @return The discipline state
+sfeSTP3593LFDisciplineState_t SfeSTP3593LFDriver::getDisciplineState(void)
+{
+    return _disciplineState;
+}
+
+/// @brief Reset the discipline state machine to warm-up and re-seed the integrator from the control word
+void SfeSTP3593LFDriver::resetDiscipline(void)
+{
+    _integralInitialized = false;
+    _quantizationResidualQ16 = 0;
+    _biasMean = 0.0;
+    _biasVariance = 0.0;
+    enterDisciplineState(kSfeSTP3593LFStateWarmup);
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    if (_recorder != nullptr)
+        _recorder->recordSetting(kSfeSTP3593LFRecordReset, true);
+#endif
+}
+
+/// @brief Set the Pk and Ik used by updateDiscipline in the chosen state
+/// @param state the discipline state
+/// @param Pk the Proportional term
+/// @param Ik the Integral term
+void SfeSTP3593LFDriver::setDisciplineGains(sfeSTP3593LFDisciplineState_t state, double Pk, double Ik)
+{
+    if (state >= kSfeSTP3593LFNumDisciplineStates)
+        return;
+    _disciplinePk[state] = Pk;
+    _disciplineIk[state] = Ik;
+}
+
+/// @brief Get the Pk used by updateDiscipline in the chosen state
+/// @param state the discipline state
+/// @return The Proportional term
+double SfeSTP3593LFDriver::getDisciplinePk(sfeSTP3593LFDisciplineState_t state)
+{
+    if (state >= kSfeSTP3593LFNumDisciplineStates)
+        return 0.0;
+    return _disciplinePk[state];
+}
+
+/// @brief Get the Ik used by updateDiscipline in the chosen state
+/// @param state the discipline state
+/// @return The Integral term
+double SfeSTP3593LFDriver::getDisciplineIk(sfeSTP3593LFDisciplineState_t state)
+{
+    if (state >= kSfeSTP3593LFNumDisciplineStates)
+        return 0.0;
+    return _disciplineIk[state];
+}
+
+/// @brief Set the number of epochs to hold the control word while the oven warms up
+/// @param epochs the warm-up duration in epochs (default 0)
+void SfeSTP3593LFDriver::setWarmupEpochs(uint32_t epochs)
+{
+    _warmupEpochs = epochs;
+}
+
+/// @brief Set the number of consecutive in-threshold epochs required to change state (default 60)
+/// @param epochs the number of epochs
+void SfeSTP3593LFDriver::setLockEpochs(uint32_t epochs)
+{
+    _lockEpochs = epochs;
+}
+
+/// @brief Set the RMS bias below which the loop is considered locked
+/// @param threshold the lock threshold in milliseconds (default 20ns, 20.0e-6)
+void SfeSTP3593LFDriver::setLockThresholdMillis(double threshold)
+{
+    _lockThresholdMillis = threshold;
+}
+
+/// @brief Set the bias magnitude above which the loop returns to acquisition
+/// @param threshold the acquisition threshold in milliseconds (default 1us, 1.0e-3)
+void SfeSTP3593LFDriver::setAcquisitionThresholdMillis(double threshold)
+{
+    _acquisitionThresholdMillis = threshold;
+}
+
+/// @brief Get the exponentially-weighted mean of the bias seen by updateDiscipline
+/// @return The mean bias in milliseconds
+double SfeSTP3593LFDriver::getBiasMeanMillis(void)
+{
+    return _biasMean;
+}
+
+/// @brief Get the exponentially-weighted standard deviation of the bias seen by updateDiscipline
+/// @return The bias standard deviation in milliseconds
+double SfeSTP3593LFDriver::getBiasStdDevMillis(void)
+{
+    return sqrt(_biasVariance);
+}
+#endif
+#endif // SFE_STP3593LF_ENABLE_PI_LOOP
+
+/// @brief  PRIVATE: read the frequency control word if the driver's copy is not valid yet - after a Probe or Lazy begin
+/// @return true if the driver's copy is valid
+bool SfeSTP3593LFDriver::ensureFrequencyControlWord(void)
+{
+    if (_frequencyControlValid)
+        return true;
+    return readFrequencyControlWord();
+}
+
+#if SFE_STP3593LF_ENABLE_DITHER
+/// @brief  PRIVATE: run one dither slot: advance the modulator and write the word if it has changed
+/// @return true if successful
+bool SfeSTP3593LFDriver::ditherStep(void)
+{
+    uint32_t word = _ditherWord;
+    _ditherAccumulator += _ditherFraction;
+    if (_ditherAccumulator >= 65536)
+    {
+        _ditherAccumulator -= 65536;
+        word++; // This slot uses the word above
+    }
+    _ditherSlot++;
+
+    if (_frequencyControlValid && (word == _frequencyControl))
+        return true; // No change - no write
+
+    _ditherWrites++;
+    if (_ditherEpochWrites < 0xFF)
+        _ditherEpochWrites++;
+    return setFrequencyControlWord(word);
+}
+#endif
+
+/// @brief Save the frequency control value - to be reloaded at start-up
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::saveFrequencyControlValue(void)
+{
+    bool result = true;
+    result &= (_theBus->writeByte(kSfeSTP3593LFRegSaveFrequency) == kSTkErrOk);
+    if (result)
+        result &= readFrequencyControlWord();
+    return result;
+}
+
+/// @brief Serialize the learned loop state - integrators, gains, state machine and estimators - for a warm start
+/// @param buffer where to write the snapshot
+/// @param bufferSize the size of buffer. kSfeSTP3593LFSnapshotMaxSize is always enough
+/// @return The length of the snapshot. 0 if buffer is too small
+size_t SfeSTP3593LFDriver::getSnapshot(uint8_t *buffer, size_t bufferSize)
+{
+    if (!ensureFrequencyControlWord())
+        return 0;
+
+    SfeSTP3593LFSnapshotWriter writer(buffer, bufferSize);
+
+    writer.putU8('S');
+    writer.putU8('T');
+    writer.putU8('P');
+    writer.putU8('W');
+    writer.putU8(kSfeSTP3593LFSnapshotVersion);
+    writer.putU16(0); // The length - patched below
+
+    writer.beginSection(kSfeSTP3593LFSnapshotWord);
+    writer.putU32(_frequencyControl);
+    writer.endSection();
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+    writer.beginSection(kSfeSTP3593LFSnapshotFixed);
+    writer.putU32((uint32_t)_maxChangeLSBs);
+    writer.putI64(_integralQ16);
+    writer.putU8(_integralQ16Initialized ? 0x01 : 0x00);
+    writer.putU32((uint32_t)_queuePkQ16);
+    writer.putU32((uint32_t)_queueIkQ16);
+    writer.putI64(_referenceLinearQ16);
+    writer.putU8(_referenceValid ? 0x01 : 0x00);
+    writer.endSection();
+#endif
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+    writer.beginSection(kSfeSTP3593LFSnapshotDiscipline);
+    writer.putFloat((float)_maxFrequencyChangePPB);
+    writer.putI64((int64_t)floor((_integral * 65536.0) + 0.5)); // Q16: exact to 1/65536 LSB, even where double is 32-bit
+    writer.putU8((_integralInitialized ? 0x01 : 0x00) | (_temperatureCompensation ? 0x02 : 0x00) | (_temperatureValid ? 0x04 : 0x00));
+    writer.putU8((uint8_t)_disciplineState);
+    writer.putU32(_warmupEpochs);
+    writer.putU32(_lockEpochs);
+    writer.putFloat((float)_lockThresholdMillis);
+    writer.putFloat((float)_acquisitionThresholdMillis);
+    writer.putFloat((float)_biasMean);
+    writer.putFloat((float)_biasVariance);
+    for (uint8_t i = 0; i < kSfeSTP3593LFNumDisciplineStates; i++)
+        writer.putFloat((float)_disciplinePk[i]);
+    for (uint8_t i = 0; i < kSfeSTP3593LFNumDisciplineStates; i++)
+        writer.putFloat((float)_disciplineIk[i]);
+    writer.putFloat((float)_temperatureReference);
+    writer.putFloat((float)_temperatureTheta[0]);
+    writer.putFloat((float)_temperatureTheta[1]);
+    writer.endSection();
+#endif
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    writer.beginSection(kSfeSTP3593LFSnapshotStatistics);
+    writer.putFloat((float)_freqControlResolution);
+    writer.putFloat((float)_temperatureLambda);
+    writer.putFloat((float)_temperatureModelOrigin);
+    for (uint8_t i = 0; i < 4; i++)
+        writer.putFloat((float)_temperatureCovariance[i]);
+    writer.putU8((_temperatureModelInitialized ? 0x01 : 0x00) | (_resolutionFeedback ? 0x02 : 0x00));
+    writer.putFloat((float)_resolutionLambda);
+    writer.putU32(_resolutionOriginWord);
+    writer.putU32(_resolutionSamples);
+    writer.putFloat((float)_resolutionTheta[0]);
+    writer.putFloat((float)_resolutionTheta[1]);
+    for (uint8_t i = 0; i < 4; i++)
+        writer.putFloat((float)_resolutionCovariance[i]);
+    writer.putFloat((float)_resolutionResidualVariance);
+    writer.putFloat((float)_pullRangeLambda);
+    writer.putU32(_pullRangeOriginWord);
+    writer.putU32(_pullRangeHours);
+    writer.putFloat((float)_pullRangeTheta[0]);
+    writer.putFloat((float)_pullRangeTheta[1]);
+    for (uint8_t i = 0; i < 4; i++)
+        writer.putFloat((float)_pullRangeCovariance[i]);
+    writer.putFloat((float)_pullRangeResidualVariance);
+    writer.putFloat((float)_pullRangeWarningDays);
+    writer.putU8(_pullRangeWarning ? 0x01 : 0x00);
+    writer.endSection();
+#endif
+
+    writer.patchU16(5, (uint16_t)(writer.length() + 2));
+    writer.putU16(sfeSTP3593LFSnapshotCRC(buffer, writer.length()));
+
+    if (!writer.ok())
+        return 0;
+    return writer.length();
+}
+
+/// @brief Restore a snapshot from getSnapshot - and write its control word
+/// @param snapshot the snapshot
+/// @param length the length of the snapshot
+/// @return true if the snapshot is valid, was restored and the word was written
+bool SfeSTP3593LFDriver::restoreSnapshot(const uint8_t *snapshot, size_t length)
+{
+    // Check the whole snapshot before changing anything
+    if ((snapshot == nullptr) || (length < 9))
+        return false;
+    if ((snapshot[0] != 'S') || (snapshot[1] != 'T') || (snapshot[2] != 'P') || (snapshot[3] != 'W'))
+        return false;
+    if (snapshot[4] != kSfeSTP3593LFSnapshotVersion)
+        return false;
+    size_t snapshotLength = ((size_t)snapshot[5]) | (((size_t)snapshot[6]) << 8);
+    if ((snapshotLength < 9) || (snapshotLength > length))
+        return false;
+    uint16_t crc = ((uint16_t)snapshot[snapshotLength - 2]) | (((uint16_t)snapshot[snapshotLength - 1]) << 8);
+    if (crc != sfeSTP3593LFSnapshotCRC(snapshot, snapshotLength - 2))
+        return false;
+
+    SfeSTP3593LFSnapshotReader reader(snapshot, snapshotLength - 2);
+    reader.seek(7);
+
+    // Check the section framing - and that the word is present - in a first pass
+    bool haveWord = false;
+    while (reader.ok() && (reader.position() < (snapshotLength - 2)))
+    {
+        uint8_t tag = reader.getU8();
+        uint8_t payload = reader.getU8();
+        size_t end = reader.position() + payload;
+        if (payload < sfeSTP3593LFSnapshotSectionLength(tag))
+            return false; // Too short for the fields this build reads
+        if (tag == kSfeSTP3593LFSnapshotWord)
+            haveWord = true;
+        reader.seek(end);
+    }
+    if ((!reader.ok()) || (!haveWord))
+        return false;
+
+    // Then apply the sections this build knows
+    uint32_t word = _frequencyControl;
+    reader.seek(7);
+    while (reader.position() < (snapshotLength - 2))
+    {
+        uint8_t tag = reader.getU8();
+        uint8_t payload = reader.getU8();
+        size_t end = reader.position() + payload;
+
+        switch (tag)
+        {
+        case kSfeSTP3593LFSnapshotWord:
+            word = reader.getU32();
+            break;
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+        case kSfeSTP3593LFSnapshotFixed:
+        {
+            _maxChangeLSBs = (int32_t)reader.getU32();
+#if SFE_STP3593LF_FIXED_POINT
+            _maxFrequencyChangePPB = (uint32_t)((((int64_t)_maxChangeLSBs * _e15PerLSB) + 500000) / 1000000);
+#endif
+            _integralQ16 = reader.getI64();
+            _integralQ16Initialized = ((reader.getU8() & 0x01) != 0);
+            _queuePkQ16 = (int32_t)reader.getU32();
+            _queueIkQ16 = (int32_t)reader.getU32();
+            int64_t referenceLinearQ16 = reader.getI64();
+            if ((reader.getU8() & 0x01) != 0)
+            {
+                _referenceLinearQ16 = referenceLinearQ16;
+                _referenceValid = true;
+            }
+            _ticInitialized = false; // The TIC phase reference does not survive a restart
+            _timestampValid = false; // Nor does the timed... calls' timestamp
+            break;
+        }
+#endif
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+        case kSfeSTP3593LFSnapshotDiscipline:
+        {
+            _maxFrequencyChangePPB = reader.getFloat();
+            _integral = (double)reader.getI64() / 65536.0;
+            uint8_t flags = reader.getU8();
+            _integralInitialized = ((flags & 0x01) != 0);
+            _temperatureCompensation = ((flags & 0x02) != 0);
+            uint8_t state = reader.getU8();
+            _warmupEpochs = reader.getU32();
+            _lockEpochs = reader.getU32();
+            _lockThresholdMillis = reader.getFloat();
+            _acquisitionThresholdMillis = reader.getFloat();
+            _biasMean = reader.getFloat();
+            _biasVariance = reader.getFloat();
+            for (uint8_t i = 0; i < kSfeSTP3593LFNumDisciplineStates; i++)
+                _disciplinePk[i] = reader.getFloat();
+            for (uint8_t i = 0; i < kSfeSTP3593LFNumDisciplineStates; i++)
+                _disciplineIk[i] = reader.getFloat();
+            _temperatureReference = reader.getFloat();
+            _temperatureTheta[0] = reader.getFloat();
+            _temperatureTheta[1] = reader.getFloat();
+
+            // If the temperature channel was in use, assume the reference temperature until the first
+            // setTemperature: no feed-forward. setTemperature keeps the restored reference
+            _temperatureValid = ((flags & 0x04) != 0);
+            if (_temperatureValid)
+                _temperature = _temperatureReference;
+            updateTemperatureFeedForward();
+
+            // Lock is re-confirmed, not assumed
+            if ((state == kSfeSTP3593LFStateLocked) || (state == kSfeSTP3593LFStateHoldover))
+                state = kSfeSTP3593LFStateTracking;
+            if (state >= kSfeSTP3593LFNumDisciplineStates)
+                state = kSfeSTP3593LFStateWarmup;
+            enterDisciplineState((sfeSTP3593LFDisciplineState_t)state);
+            _maxChangeLSBs = (int32_t)((_maxFrequencyChangePPB * 1.0e-9 / _freqControlResolution) + 0.5);
+            break;
+        }
+#endif
+#if SFE_STP3593LF_ENABLE_STATISTICS
+        case kSfeSTP3593LFSnapshotStatistics:
+        {
+            double resolution = reader.getFloat();
+            _temperatureLambda = reader.getFloat();
+            _temperatureModelOrigin = reader.getFloat();
+            for (uint8_t i = 0; i < 4; i++)
+                _temperatureCovariance[i] = reader.getFloat();
+            uint8_t flags = reader.getU8();
+            _temperatureModelInitialized = ((flags & 0x01) != 0);
+            _resolutionFeedback = ((flags & 0x02) != 0);
+            _resolutionLambda = reader.getFloat();
+            _resolutionOriginWord = reader.getU32();
+            _resolutionSamples = reader.getU32();
+            _resolutionTheta[0] = reader.getFloat();
+            _resolutionTheta[1] = reader.getFloat();
+            for (uint8_t i = 0; i < 4; i++)
+                _resolutionCovariance[i] = reader.getFloat();
+            _resolutionResidualVariance = reader.getFloat();
+            _pullRangeLambda = reader.getFloat();
+            _pullRangeOriginWord = reader.getU32();
+            _pullRangeHours = reader.getU32();
+            _pullRangeTheta[0] = reader.getFloat();
+            _pullRangeTheta[1] = reader.getFloat();
+            for (uint8_t i = 0; i < 4; i++)
+                _pullRangeCovariance[i] = reader.getFloat();
+            _pullRangeResidualVariance = reader.getFloat();
+            _pullRangeWarningDays = reader.getFloat();
+            _pullRangeWarning = ((reader.getU8() & 0x01) != 0);
+            _pullRangeSamples = 0; // The hour in progress starts again
+            _pullRangeMicros = 0;
+            _pullRangeSumWord = 0.0;
+            _resolutionRejections = 0;
+            _resolutionPrimeEpochs = 2; // The previous bias and word are from before the restart
+            setFreqControlResolution(resolution); // Also converts _maxChangeLSBs
+            break;
+        }
+#endif
+        default:
+            break; // Unknown, or compiled out: skip
+        }
+
+        reader.seek(end); // Skip any fields added by a later writer
+    }
+
+    if (word > kSfeSTP3593LFFreqControlMaxValue)
+        word = kSfeSTP3593LFFreqControlMaxValue;
+    if (_frequencyControlValid && (word == _frequencyControl))
+        return true;
+    return setFrequencyControlWord(word);
+}
+
+/// @brief Choose what begin does on the bus. Call before begin
+/// @param mode the begin mode. Default: kSfeSTP3593LFBeginVerified
+void SfeSTP3593LFDriver::setBeginMode(sfeSTP3593LFBeginMode_t mode)
+{
+    _beginMode = mode;
+}
+
+/// @brief Get the begin mode
+/// @return The begin mode
+sfeSTP3593LFBeginMode_t SfeSTP3593LFDriver::getBeginMode(void)
+{
+    return _beginMode;
+}
+
+/// @brief Have begin restore a snapshot - a warm start
+/// @param snapshot the snapshot. It must remain valid until begin returns. nullptr for a cold start
+/// @param length the length of the snapshot
+void SfeSTP3593LFDriver::setWarmStart(const uint8_t *snapshot, size_t length)
+{
+    _warmStart = snapshot;
+    _warmStartLength = length;
+}
+
+/// @brief Check if begin restored the warm-start snapshot
+/// @return true if the most recent begin was a warm start
+bool SfeSTP3593LFDriver::getWarmStarted(void)
+{
+    return _warmStarted;
+}
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+/// @brief Record every input to the loop - biases, phases, gains, temperatures and settings - with timestamps
+/// @param recorder the recorder. nullptr stops recording
+void SfeSTP3593LFDriver::setRecorder(SfeSTP3593LFRecorder *recorder)
+{
+    _recorder = recorder;
+    if (_recorder == nullptr)
+        return;
+
+    sfeSTP3593LFLoopState_t state;
+    getLoopState(state); // Includes the error feedback and its residual: recording does not disturb the loop
+    _recorder->writeHeader(state);
+}
+
+/// @brief  PROTECTED: capture the loop state - for recording
+/// @param  state the state
+void SfeSTP3593LFDriver::getLoopState(sfeSTP3593LFLoopState_t &state)
+{
+    state.frequencyControl = _frequencyControl;
+    state.maxFrequencyChangePPB = _maxFrequencyChangePPB;
+    state.integral = _integral;
+    state.integralQ16 = _integralQ16;
+    state.integralInitialized = _integralInitialized;
+    state.integralQ16Initialized = _integralQ16Initialized;
+    state.errorFeedback = _errorFeedback;
+    state.quantizationResidualQ16 = _quantizationResidualQ16;
+}
+
+/// @brief  PROTECTED: restore the loop state - for replay
+/// @param  state the state
+void SfeSTP3593LFDriver::setLoopState(const sfeSTP3593LFLoopState_t &state)
+{
+    _frequencyControl = state.frequencyControl;
+    _frequencyControlValid = true;
+    _maxFrequencyChangePPB = state.maxFrequencyChangePPB;
+    _maxChangeLSBs = (int32_t)((state.maxFrequencyChangePPB * 1.0e-9 / _freqControlResolution) + 0.5);
+    _integral = state.integral;
+    _integralQ16 = state.integralQ16;
+    _integralInitialized = state.integralInitialized;
+    _integralQ16Initialized = state.integralQ16Initialized;
+    _errorFeedback = state.errorFeedback;
+    _quantizationResidualQ16 = state.quantizationResidualQ16;
+}
+
+/// @brief  PROTECTED: set the time step of the next loop update - for replay
+/// @param  micros the time step in microseconds
+void SfeSTP3593LFDriver::setTimeStepMicros(uint32_t micros)
+{
+    _timeStepMicros = micros;
+}
+#endif
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+/// @brief  PRIVATE: change the discipline state and reset the per-state counters
+/// @param  state the new discipline state
+void SfeSTP3593LFDriver::enterDisciplineState(sfeSTP3593LFDisciplineState_t state)
+{
+    _disciplineState = state;
+    _stateEpochs = 0;
+    _lockCount = 0;
+}
+
+/// @brief  PRIVATE: add the feed-forward terms, limit to the pull range, round and write the control word
+/// @param  word the loop output (proportional plus integral) in control word LSBs
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::writeDisciplinedWord(double word)
+{
+    word += _temperatureFeedForward;
+
+    // Limit to the pull range before converting - a large double cannot be cast to int64_t
+    if (word < -1.0e7)
+        word = -1.0e7;
+    if (word > 1.0e7)
+        word = 1.0e7;
+
+    return writeLinearQ16((int64_t)round(word * 65536.0));
+}
+
+/// @brief  PRIVATE: recalculate _temperatureFeedForward from the temperature and the coefficient
+void SfeSTP3593LFDriver::updateTemperatureFeedForward(void)
+{
+    if (_temperatureCompensation && _temperatureValid)
+        _temperatureFeedForward = _temperatureTheta[1] * (_temperature - _temperatureReference);
+    else
+        _temperatureFeedForward = 0.0;
+}
+#endif
+
+/// @brief  PRIVATE: convert a control word to the linearized word the loop integrates - via the calibration table
+/// @param  word the frequency control word
+/// @return The linearized word in LSBs, Q16. Equal to the word if no table is in use
+int64_t SfeSTP3593LFDriver::wordToLinearQ16(uint32_t word)
+{
+    if (_calTable == nullptr)
+        return ((int64_t)word) << 16;
+
+    // Linearized word = first word + (calibrated offset / nominal offset per LSB)
+    // For a perfectly linear part this is the word itself
+    int64_t offsetE15 = (int64_t)getCalibratedOffsetE15(word);
+    return (((int64_t)_calTable[0].word) << 16) + ((offsetE15 * 65536) / _e15PerLSB);
+}
+
+/// @brief  PRIVATE: convert a linearized word to the control word - via the calibration table
+/// @param  linearQ16 the linearized word in LSBs, Q16
+/// @return The control word, limited to the pull range
+uint32_t SfeSTP3593LFDriver::linearQ16ToWord(int64_t linearQ16)
+{
+    if (_calTable == nullptr)
+    {
+        int64_t word = (linearQ16 + 32768) >> 16; // Round to the nearest LSB
+        if (word < 0)
+            word = 0;
+        if (word > (int64_t)kSfeSTP3593LFFreqControlMaxValue)
+            word = kSfeSTP3593LFFreqControlMaxValue;
+        return (uint32_t)word;
+    }
+
+    int64_t offsetE15 = ((linearQ16 - (((int64_t)_calTable[0].word) << 16)) * _e15PerLSB) >> 16;
+    if (offsetE15 > (int64_t)INT32_MAX)
+        offsetE15 = INT32_MAX;
+    if (offsetE15 < (int64_t)INT32_MIN)
+        offsetE15 = INT32_MIN;
+    return getCalibratedWord((int32_t)offsetE15);
+}
+
+/// @brief  PRIVATE: seed the reference word from the control word, if it is not yet known
+/// @return true if the reference word is known
+bool SfeSTP3593LFDriver::ensureReferenceWord(void)
+{
+    if (_referenceValid)
+        return true;
+    if (!ensureFrequencyControlWord())
+        return false;
+    _referenceLinearQ16 = wordToLinearQ16(_frequencyControl);
+    _referenceValid = true;
+    return true;
+}
+
+/// @brief  PRIVATE: move the reference word one epoch of its time constant towards the integrator
+/// @param  integralQ16 the loop's integrator in linearized LSBs, Q16
+void SfeSTP3593LFDriver::moveReferenceWord(int64_t integralQ16)
+{
+    if (!ensureReferenceWord())
+        return;
+    _referenceLinearQ16 += (integralQ16 - _referenceLinearQ16) / kSfeSTP3593LFReferenceTimeConstant;
+}
+
+/// @brief  PRIVATE: end the phase steering: restore the original word
+/// @return true if the word is restored. If not, the steering keeps running so that updatePhaseSteering retries
+bool SfeSTP3593LFDriver::restorePhaseSteeringWord(void)
+{
+    uint32_t word = linearQ16ToWord(_steerBaseLinearQ16);
+    if (word != _frequencyControl)
+    {
+        _steerWrites++;
+        if (!setFrequencyControlWord(word))
+        {
+            _steerResult = kSfeSTP3593LFSteeringRestoring;
+            return false;
+        }
+    }
+
+    _steering = false;
+    _steerResult = kSfeSTP3593LFSteeringComplete;
+    return true;
+}
+
+/// @brief  PRIVATE: plan the linearized offset for the next steering epoch from the phase still to go
+/// @return The offset in whole LSBs - limited to the maximum frequency change
+int32_t SfeSTP3593LFDriver::nextPhaseSteeringOffset(void)
+{
+    int64_t epochsLeft = (int64_t)(_steerEpochs - _steerEpoch);
+    int64_t remainingQ16 = _steerTotalQ16 - _steerAppliedQ16;
+    int64_t remainingLSBs = remainingQ16 >= 0 ? ((remainingQ16 + 32768) >> 16) : 0 - (((0 - remainingQ16) + 32768) >> 16);
+
+    // Spread the whole LSBs evenly: the first (remainder) epochs take one LSB more. Replanned each
+    // epoch, this gives the same trajectory - with at most one change of word before the end
+    int64_t offset = remainingLSBs / epochsLeft;
+    if ((remainingLSBs % epochsLeft) != 0)
+        offset += remainingLSBs > 0 ? 1 : -1;
+
+    if (offset > (int64_t)_maxChangeLSBs)
+        offset = _maxChangeLSBs;
+    if (offset < (0 - (int64_t)_maxChangeLSBs))
+        offset = 0 - (int64_t)_maxChangeLSBs;
+    return (int32_t)offset;
+}
+
+/// @brief  PRIVATE: write the loop output: round it, or hand it to the dither with its fraction
+/// @param  linearQ16 the linearized word in LSBs, Q16
+/// @return true if the write is successful
+bool SfeSTP3593LFDriver::writeLinearQ16(int64_t linearQ16)
+{
+#if SFE_STP3593LF_ENABLE_DITHER
+    if (_ditherEnabled)
+    {
+        uint32_t word = linearQ16ToWord(linearQ16);
+        // The part rounding discarded. Close to one LSB per LSB, with or without a calibration table
+        int64_t residualQ16 = linearQ16 - wordToLinearQ16(word);
+        if ((residualQ16 < 0) && (word > 0))
+        {
+            word--;
+            residualQ16 += 65536;
+        }
+        if (residualQ16 < 0)
+            residualQ16 = 0;
+        if (residualQ16 > 0xFFFF)
+            residualQ16 = 0xFFFF;
+        return setDitheredFrequencyControlWord(word, (uint16_t)residualQ16);
+    }
+#endif
+
+    if (_errorFeedback)
+        linearQ16 += _quantizationResidualQ16; // Add back what the previous rounding discarded
+
+    bool result = setFrequencyControlWord(linearQ16ToWord(linearQ16));
+
+    // Keep what this rounding discarded - carried into the next output if error feedback is enabled.
+    // Limit it to one LSB: at the ends of the pull range, or after a failed write, the word cannot
+    // follow and the residual must not wind up
+    int64_t residualQ16 = linearQ16 - wordToLinearQ16(_frequencyControl);
+    if (residualQ16 > 65536)
+        residualQ16 = 65536;
+    if (residualQ16 < -65536)
+        residualQ16 = -65536;
+    _quantizationResidualQ16 = (int32_t)residualQ16;
+
+    return result;
+}
+
+/// @brief  PRIVATE: get the word the loop asked for - for the recorder
+/// @param  written the result of the loop's write. A failed write leaves the control word as it was
+/// @return The control word, or the rounded dither target while dithering
+uint32_t SfeSTP3593LFDriver::getLoopOutputWord(bool written)
+{
+#if SFE_STP3593LF_ENABLE_DITHER
+    if (written && _ditherEnabled && _ditherActive)
+        return _ditherWord + ((_ditherFraction >= 0x8000) ? 1 : 0); // What replay - without the dither - writes
+#else
+    (void)written; // Only the dither needs it
+#endif
+    return _frequencyControl;
+}
+
+/// @brief  PRIVATE: measure dt from the previous timed sample and make it the time step of the next loop update
+/// @param  timestampMicros the time of the measurement in microseconds
+/// @return true if the time step is valid. false if the timestamp is not after the previous one
+bool SfeSTP3593LFDriver::beginTimeStep(uint32_t timestampMicros)
+{
+    uint32_t step = kSfeSTP3593LFNominalTimeStepMicros; // The first sample has no predecessor: assume one epoch
+
+    if (_timestampValid)
+    {
+        int32_t elapsed = (int32_t)(timestampMicros - _lastTimestampMicros); // Modulo 2^32: safe across micros() wraparound
+        if (elapsed <= 0)
+        {
+            _timeStepRejections++; // Duplicate or out of order
+            return false;
+        }
+        step = (uint32_t)elapsed;
+        if (step > _maxTimeStepMicros)
+        {
+            step = _maxTimeStepMicros; // A gap: integrate over the maximum step only
+            _timeStepGaps++;
+        }
+    }
+
+    _lastTimestampMicros = timestampMicros;
+    _timestampValid = true;
+    _timeStepMicros = step;
+    _lastTimeStepMicros = step;
+    return true;
+}
+
+/// @brief  PRIVATE: timestamp a sample, queue it and notify the discipline task
+/// @param  type the sample type
+/// @param  value the count, phase or bias
+/// @param  sawtoothPicoseconds the sawtooth error in picoseconds
+/// @return true if the sample was queued
+bool SfeSTP3593LFDriver::queueSample(sfeSTP3593LFSampleType_t type, int32_t value, int32_t sawtoothPicoseconds)
+{
+    sfeSTP3593LFSample_t sample;
+    sample.timestamp = micros();
+    sample.value = value;
+    sample.sawtoothPicoseconds = sawtoothPicoseconds;
+    sample.type = (uint8_t)type;
+
+    if (!_sampleQueue.push(sample))
+        return false;
+
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_disciplineTask != nullptr)
+    {
+        if (xPortInIsrContext())
+        {
+            BaseType_t higherPriorityTaskWoken = pdFALSE;
+            vTaskNotifyGiveFromISR(_disciplineTask, &higherPriorityTaskWoken);
+            if (higherPriorityTaskWoken)
+                portYIELD_FROM_ISR();
+        }
+        else
+            xTaskNotifyGive(_disciplineTask);
+    }
+#endif
+
+    return true;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+/// @brief  PRIVATE: the discipline task: wait for a notification, then service the queue
+/// @param  driver the driver
+void SfeSTP3593LFDriver::disciplineTask(void *driver)
+{
+    SfeSTP3593LFDriver *theDriver = (SfeSTP3593LFDriver *)driver;
+
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Sleep until a sample is queued
+        theDriver->serviceDiscipline();
+    }
+}
+#endif
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+/// @brief  PRIVATE: update the temperature coefficient estimator with the loop's steady-state word
+/// @param  integral the loop's integrator in control word LSBs
+void SfeSTP3593LFDriver::updateTemperatureModel(double integral)
+{
+    if (!_temperatureValid)
+        return;
+
+    // The word the oscillator needs at this temperature is the integrator plus the feed-forward
+    // already applied. Regress it on (temperature - reference): target = offset + coefficient * dT
+    double target = integral + _temperatureFeedForward;
+    if (!_temperatureModelInitialized)
+    {
+        _temperatureModelOrigin = target; // Subtract the first target to keep the offset small
+        _temperatureModelInitialized = true;
+    }
+    target -= _temperatureModelOrigin;
+
+    double dT = _temperature - _temperatureReference;
+    updateRLS(_temperatureTheta, _temperatureCovariance, _temperatureLambda, dT, dT, target);
+
+    updateTemperatureFeedForward();
+}
+
+/// @brief  PRIVATE: update the resolution estimator with this epoch's bias
+/// @param  bias the GNSS RX clock bias in milliseconds
+void SfeSTP3593LFDriver::updateResolutionModel(double bias)
+{
+    if (_resolutionSamples == 0)
+        _resolutionOriginWord = _frequencyControl; // Subtract the first word to keep the offset small
+
+    if ((_resolutionSamples++ < 2) || (_resolutionPrimeEpochs > 0))
+    {
+        if (_resolutionPrimeEpochs > 0)
+            _resolutionPrimeEpochs--; // Restored: the previous bias and word are from before the restart
+        _resolutionLastBias = bias;
+        _resolutionLastWord = _frequencyControl;
+        return;
+    }
+
+    // The bias rate over the last epoch is the fractional frequency offset produced by the word
+    // in effect during that epoch. Express it in typical LSBs, so the slope is the resolution as
+    // a ratio of 8E-13 - close to 1.0 - which keeps the estimator well conditioned
+    double rate = ((bias - _resolutionLastBias) / 1000.0) / kSfeSTP3593LFFreqControlResolution;
+    double x1 = (double)_frequencyControl - (double)_resolutionOriginWord;
+    _resolutionLastBias = bias;
+
+    // In closed loop, the word in effect during this epoch was calculated from the previous bias,
+    // so it is correlated with that bias's measurement noise - which biases ordinary least squares.
+    // The word from the epoch before is correlated with this word, but not with that noise.
+    // Use it as the instrument
+    double z1 = (double)_resolutionLastWord - (double)_resolutionOriginWord;
+    _resolutionLastWord = _frequencyControl;
+
+    // Reject receiver clock jumps: once the residual is known, skip anything beyond 5 sigma.
+    // A run of rejections means the model is stale, not that the data is bad: accept it
+    double predicted = _resolutionTheta[0] + (_resolutionTheta[1] * x1);
+    double residual = rate - predicted;
+    if ((_resolutionSamples > 10) && ((residual * residual) > (25.0 * _resolutionResidualVariance)))
+    {
+        if (++_resolutionRejections <= 3)
+            return;
+    }
+    _resolutionRejections = 0;
+
+    updateRLS(_resolutionTheta, _resolutionCovariance, _resolutionLambda, x1, z1, rate);
+
+    const double alpha = 1.0 / 64.0;
+    _resolutionResidualVariance += alpha * ((residual * residual) - _resolutionResidualVariance);
+
+    if (!_resolutionFeedback)
+        return;
+
+    double estimate = getEstimatedFreqControlResolution();
+    if ((estimate < (kSfeSTP3593LFFreqControlResolution / kSfeSTP3593LFResolutionMaxDeviation)) ||
+        (estimate > (kSfeSTP3593LFFreqControlResolution * kSfeSTP3593LFResolutionMaxDeviation)))
+        return; // Not plausible
+    if (getEstimatedFreqControlResolutionUncertainty() > (estimate * kSfeSTP3593LFResolutionMaxUncertainty))
+        return; // Not confident enough yet
+
+    changeFreqControlResolution(estimate);
+}
+
+/// @brief  PRIVATE: add this step's control word to the pull-range trend
+void SfeSTP3593LFDriver::updatePullRangeModel(void)
+{
+    // Only the state machine moves through the states. Direct setFrequencyBy... calls stay in warm-up: every one is a sample.
+    // Pulling in, or held through warm-up or holdover, the word says nothing about the trend - but the oscillator still ages
+    bool sample = (!_disciplineActive) || (_disciplineState == kSfeSTP3593LFStateTracking) || (_disciplineState == kSfeSTP3593LFStateLocked);
+    bool started = (_pullRangeHours > 0) || (_pullRangeMicros > 0);
+    if ((!started) && (!sample))
+        return; // The time axis starts at the first sample
+    if (!started)
+        _pullRangeOriginWord = _frequencyControl; // Subtract the first word to keep the offset small
+
+    if (sample)
+    {
+        _pullRangeSumWord += (double)_frequencyControl - (double)_pullRangeOriginWord;
+        _pullRangeSamples++;
+    }
+    _pullRangeMicros += _timeStepMicros; // Every epoch: time does not stop in holdover
+    if (_pullRangeMicros < 3600000000UL)
+        return;
+
+    // Regress the hour's mean word on the time at the middle of the hour, in days. An hour with no samples only moves the time
+    if (_pullRangeSamples > 0)
+    {
+        double mean = _pullRangeSumWord / (double)_pullRangeSamples;
+        double x1 = ((double)_pullRangeHours + 0.5) / 24.0;
+        double err = updateRLS(_pullRangeTheta, _pullRangeCovariance, _pullRangeLambda, x1, x1, mean);
+        if (_pullRangeHours >= 2) // The first predictions are from an unconverged fit
+        {
+            const double alpha = 1.0 / 24.0;
+            _pullRangeResidualVariance += alpha * ((err * err) - _pullRangeResidualVariance);
+        }
+    }
+
+    _pullRangeHours++;
+    _pullRangeSamples = 0;
+    _pullRangeSumWord = 0.0;
+    _pullRangeMicros -= 3600000000UL;
+    if (_pullRangeMicros >= 3600000000UL)
+        _pullRangeMicros = 0;
+
+    double days, earliestDays, latestDays;
+    if (getPullRangeForecast(days, earliestDays, latestDays) && (earliestDays < _pullRangeWarningDays))
+        _pullRangeWarning = true;
+}
+
+/// @brief  PRIVATE: change the resolution used by the loop and recalculate the integer conversion factors
+/// @param  resolution the frequency control resolution (fractional frequency per LSB)
+void SfeSTP3593LFDriver::setFreqControlResolution(double resolution)
+{
+    _freqControlResolution = resolution;
+    _maxChangeLSBs = (int32_t)((_maxFrequencyChangePPB * 1.0e-9 / resolution) + 0.5);
+    _lsbsPerPicosecondQ16 = (int32_t)((65536.0 * 1.0e-12 / resolution) + 0.5);
+    _e15PerLSB = (int32_t)((resolution * 1.0e15) + 0.5);
+}
+
+/// @brief  PRIVATE: change the resolution while the loop is running - without moving the output
+/// @param  resolution the frequency control resolution (fractional frequency per LSB)
+void SfeSTP3593LFDriver::changeFreqControlResolution(double resolution)
+{
+    int32_t oldE15PerLSB = _e15PerLSB;
+    setFreqControlResolution(resolution);
+
+    // With a calibration table, the linearized word is the first word plus the offset over _e15PerLSB.
+    // Rescale the integrators and the reference word about the first word so they still convert to
+    // the same control word. Without a table, the linearized word is the word itself
+    if ((_calTable == nullptr) || (oldE15PerLSB == _e15PerLSB))
+        return;
+
+    int64_t originQ16 = ((int64_t)_calTable[0].word) << 16;
+    double ratio = (double)oldE15PerLSB / (double)_e15PerLSB;
+    if (_integralInitialized)
+        _integral = (double)_calTable[0].word + ((_integral - (double)_calTable[0].word) * ratio);
+    if (_integralQ16Initialized)
+        _integralQ16 = originQ16 + ((((_integralQ16 - originQ16) * oldE15PerLSB) + (_e15PerLSB / 2)) / _e15PerLSB);
+    if (_referenceValid)
+        _referenceLinearQ16 = originQ16 + ((((_referenceLinearQ16 - originQ16) * oldE15PerLSB) + (_e15PerLSB / 2)) / _e15PerLSB);
+}
+
+/// @brief  PRIVATE: one step of two-parameter (instrumental-variable) recursive least squares with forgetting
+/// @param  theta the parameters: offset, slope
+/// @param  p the covariance: p00, p01, p10, p11
+/// @param  lambda the forgetting factor
+/// @param  x1 the regressor. The full regressor is x = [1, x1]
+/// @param  z1 the instrument. Pass x1 for ordinary recursive least squares
+/// @param  y the observation
+/// @return The a-priori prediction error
+double SfeSTP3593LFDriver::updateRLS(double *theta, double *p, double lambda, double x1, double z1, double y)
+{
+    // Gain: K = P.z / (lambda + x'.P.z)
+    double Pz0 = p[0] + (p[1] * z1);
+    double Pz1 = p[2] + (p[3] * z1);
+    double denom = lambda + Pz0 + (x1 * Pz1);
+    double K0 = Pz0 / denom;
+    double K1 = Pz1 / denom;
+
+    double err = y - (theta[0] + (theta[1] * x1));
+    theta[0] += K0 * err;
+    theta[1] += K1 * err;
+
+    // Covariance: P = (P - K.x'.P) / lambda
+    double xP0 = p[0] + (x1 * p[2]);
+    double xP1 = p[1] + (x1 * p[3]);
+    p[0] = (p[0] - (K0 * xP0)) / lambda;
+    p[1] = (p[1] - (K0 * xP1)) / lambda;
+    p[2] = (p[2] - (K1 * xP0)) / lambda;
+    p[3] = (p[3] - (K1 * xP1)) / lambda;
+
+    // Prevent covariance wind-up while the regressor is constant (no excitation)
+    if (p[0] > kSfeSTP3593LFRLSInitialCovariance)
+        p[0] = kSfeSTP3593LFRLSInitialCovariance;
+    if (p[3] > kSfeSTP3593LFRLSInitialCovariance)
+        p[3] = kSfeSTP3593LFRLSInitialCovariance;
+
+    return err;
+}
+
+/// @brief  PRIVATE: close the current sweep point: calculate its frequency and move to the next point
+/// @return true if the sweep continues
+bool SfeSTP3593LFDriver::nextCalibrationSweepPoint(void)
+{
+    // The slope of bias against epoch is the fractional frequency: millis per second -> seconds per second
+    double n = (double)_sweepDwellEpochs;
+    double slope = ((n * _sweepSumTB) - (_sweepSumT * _sweepSumB)) / ((n * _sweepSumTT) - (_sweepSumT * _sweepSumT));
+    double frequency = slope / 1000.0;
+
+    if (_sweepIndex == 0)
+        _sweepFirstFrequency = frequency;
+    _sweepTable[_sweepIndex].offsetE15 = (int32_t)round((frequency - _sweepFirstFrequency) * 1.0e15);
+
+    _sweepEpoch = 0;
+    _sweepSumT = 0.0;
+    _sweepSumB = 0.0;
+    _sweepSumTT = 0.0;
+    _sweepSumTB = 0.0;
+
+    if (++_sweepIndex < _sweepPoints)
+    {
+        // Step evenly from the first word to the last
+        uint32_t word = _sweepFirstWord + (uint32_t)((((uint64_t)(_sweepLastWord - _sweepFirstWord)) * _sweepIndex) / (_sweepPoints - 1));
+        _sweepTable[_sweepIndex].word = word;
+        if (setFrequencyControlWord(word))
+            return true;
+        endCalibrationSweep(kSfeSTP3593LFSweepWriteFailed); // Abandon the sweep
+        return false;
+    }
+
+    // Complete. A noisy measurement can make the table non-monotonic: always check it - whether
+    // or not setCalibrationTable does - before it is used
+    if (isCalibrationTableIncreasing(_sweepTable, _sweepPoints) && setCalibrationTable(_sweepTable, _sweepPoints))
+        endCalibrationSweep(kSfeSTP3593LFSweepApplied);
+    else
+        endCalibrationSweep(kSfeSTP3593LFSweepRejected);
+    return false;
+}
+
+/// @brief  PRIVATE: end the calibration sweep: restore the original word and record the outcome
+/// @param  result the outcome - if the original word is restored
+void SfeSTP3593LFDriver::endCalibrationSweep(sfeSTP3593LFSweepResult_t result)
+{
+    _sweepTable = nullptr;
+    _sweepResult = setFrequencyControlWord(_sweepSavedWord) ? result : kSfeSTP3593LFSweepRestoreFailed;
+}
+#endif
+
+/// @brief  PRIVATE: check both columns of a calibration table are strictly increasing - as the binary search needs
+/// @param  table the table
+/// @param  numPoints the number of points in the table
+/// @return true if the table is strictly increasing
+bool SfeSTP3593LFDriver::isCalibrationTableIncreasing(const sfeSTP3593LFCalPoint_t *table, uint8_t numPoints)
+{
+    for (uint8_t i = 1; i < numPoints; i++)
+    {
+        if ((table[i].word <= table[i - 1].word) || (table[i].offsetE15 <= table[i - 1].offsetE15))
+            return false;
+    }
+    return true;
+}
+#endif // SFE_STP3593LF_ENABLE_PI_LOOP
+
 /// @brief  PROTECTED: update the local pointer to the I2C bus.
 /// @param  theBus Pointer to the bus object.
 void SfeSTP3593LFDriver::setCommunicationBus(sfeTkArdI2C *theBus)
@@ -51,6 +51,12 @@
     For this oscillator, getFrequencyHz, setFrequencyHz, getBaseFrequencyHz,
     setBaseFrequencyHz don't apply.
 
+    Instead, the driver keeps a model of the reference word: the word which
+    gives zero frequency offset. It is seeded from the first word read - the
+    saved value, reloaded at start-up - and refined from the loop's integrator
+    while the discipline is locked. setFrequencyOffsetPPB / setFrequencyOffsetE15
+    steer the oscillator relative to it in physical units.
+
 */
 
 #pragma once
@@ -60,6 +66,15 @@
 #include <Arduino.h>
 #include <SparkFun_Toolkit.h>
 
+#include "SparkFun_STP3593LF_Config.h"
+#include "SparkFun_STP3593LF_SampleQueue.h"
+#include "SparkFun_STP3593LF_Snapshot.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // I2C Addressing
 ///////////////////////////////////////////////////////////////////////////////
@@ -74,10 +89,136 @@ const uint8_t kSfeSTP3593LFRegReadFrequencyControl = 0x41; // Read Frequency Con
 const uint8_t kSfeSTP3593LFRegWriteDAC = 0xA0; // Write DAC 20-bits (0-1000000)
 const uint8_t kSfeSTP3593LFRegSaveFrequency = 0xC2; // Save Frequency Control Value
 
+///////////////////////////////////////////////////////////////////////////////
+// Begin Modes
+///////////////////////////////////////////////////////////////////////////////
+
+// What begin does on the bus - see setBeginMode
+typedef enum
+{
+    kSfeSTP3593LFBeginEmulator = 0, // Ping, then read 0x41 twice - for emulator builds older than its register model
+    kSfeSTP3593LFBeginVerified, // Read 0x41 once: proves the device is present and the word is in range (default)
+    kSfeSTP3593LFBeginProbe, // Ping only. The word is read on first use
+    kSfeSTP3593LFBeginLazy // No bus traffic. The device is first touched on first use
+} sfeSTP3593LFBeginMode_t;
+
 ///////////////////////////////////////////////////////////////////////////////
 
 const uint32_t kSfeSTP3593LFFreqControlMaxValue = 1000000;
 const double kSfeSTP3593LFFreqControlResolution = 8e-13;
+const int32_t kSfeSTP3593LFFreqControlResolutionE15 = 800; // The same in parts per 10^15 - for the integer-only path
+
+///////////////////////////////////////////////////////////////////////////////
+// Discipline Loop
+///////////////////////////////////////////////////////////////////////////////
+
+// The default Pk and Ik come from testing by Fugro
+const double kSfeSTP3593LFDefaultPk = 1.0 / 6.25;
+const double kSfeSTP3593LFDefaultIk = (1.0 / 6.25) / 150.0;
+
+// The same defaults in Q16 fixed-point (65536 == 1.0) - for the integer-only TIC path
+const int32_t kSfeSTP3593LFDefaultPkQ16 = 10486; // 0.16 * 65536
+const int32_t kSfeSTP3593LFDefaultIkQ16 = 70; // 0.0010667 * 65536
+
+// The update interval the gains are tuned for. The timed... calls scale the integral by dt / this
+const uint32_t kSfeSTP3593LFNominalTimeStepMicros = 1000000;
+// The default longest time step the timed... calls integrate over. A longer gap is limited to this
+const uint32_t kSfeSTP3593LFDefaultMaxTimeStepMicros = 4000000;
+
+// Dithering - see enableDither. Each slot makes at most one write, so the slots per epoch bound the write rate
+const uint8_t kSfeSTP3593LFDefaultDitherSlots = 8;
+const uint8_t kSfeSTP3593LFMaxDitherSlots = 64;
+
+// The reference word is refined towards the loop's integrator with this time constant (epochs) while locked
+const int32_t kSfeSTP3593LFReferenceTimeConstant = 256;
+
+// The largest phase correction beginPhaseSteering accepts: 100ms takes ~3 days at 400ppb
+const int32_t kSfeSTP3593LFMaxSteeringNanos = 100000000;
+
+// The outcome of the phase steering - see getPhaseSteeringResult
+typedef enum
+{
+    kSfeSTP3593LFSteeringNone = 0, // No steering has been started
+    kSfeSTP3593LFSteeringRunning, // The steering is running
+    kSfeSTP3593LFSteeringRestoring, // Steered (or cancelled), but the write restoring the original word failed: retried each epoch
+    kSfeSTP3593LFSteeringComplete, // Complete - or cancelled - and the original word is restored
+    kSfeSTP3593LFSteeringWriteFailed // The first write failed: the steering did not start
+} sfeSTP3593LFSteeringResult_t;
+
+// The initial (and maximum) diagonal covariance of the recursive-least-squares estimators
+const double kSfeSTP3593LFRLSInitialCovariance = 1.0e6;
+
+// The estimated resolution is only fed back into the loop once its 1-sigma uncertainty
+// is below this fraction of the estimate, and it is limited to this factor of the typical value
+const double kSfeSTP3593LFResolutionMaxUncertainty = 0.1;
+const double kSfeSTP3593LFResolutionMaxDeviation = 2.0;
+
+// The pull-range forecast - see getPullRangeForecast - needs this many hours of control word trend.
+// Until then, and when the word is not moving towards a rail, it reports this many days
+const uint32_t kSfeSTP3593LFPullRangeMinHours = 48;
+const double kSfeSTP3593LFPullRangeNeverDays = 1.0e6;
+
+// The states of the discipline state machine - see updateDiscipline
+typedef enum
+{
+    kSfeSTP3593LFStateWarmup = 0, // Oven warming up. The control word is held
+    kSfeSTP3593LFStateAcquisition, // Wide loop bandwidth for fast pull-in
+    kSfeSTP3593LFStateTracking, // Default loop bandwidth
+    kSfeSTP3593LFStateLocked, // Narrow loop bandwidth for low locked-state noise
+    kSfeSTP3593LFStateHoldover, // No valid bias. The control word is held
+    kSfeSTP3593LFNumDisciplineStates
+} sfeSTP3593LFDisciplineState_t;
+
+///////////////////////////////////////////////////////////////////////////////
+// Frequency Calibration
+///////////////////////////////////////////////////////////////////////////////
+
+// One point of the piecewise-linear frequency calibration table. The table is plain data:
+// it can be a constexpr array, or be copied to / from non-volatile memory byte for byte
+typedef struct
+{
+    uint32_t word; // The frequency control word
+    int32_t offsetE15; // The fractional frequency at this word relative to the first point, in parts per 10^15
+} sfeSTP3593LFCalPoint_t;
+
+// The maximum number of points in the calibration table
+const uint8_t kSfeSTP3593LFMaxCalPoints = 33;
+
+// The outcome of the calibration sweep - see getCalibrationSweepResult
+typedef enum
+{
+    kSfeSTP3593LFSweepNone = 0, // No sweep has been started
+    kSfeSTP3593LFSweepRunning, // The sweep is running
+    kSfeSTP3593LFSweepApplied, // Complete: the table is in use and the original word is restored
+    kSfeSTP3593LFSweepRejected, // Complete, but the table is not strictly increasing (too noisy): it is not used
+    kSfeSTP3593LFSweepWriteFailed, // A write failed: the sweep was abandoned and the original word is restored
+    kSfeSTP3593LFSweepRestoreFailed // The original word could not be restored: the oscillator may be left at a sweep word
+} sfeSTP3593LFSweepResult_t;
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+class SfeSTP3593LFAggregator; // See SparkFun_STP3593LF_Aggregator.h
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Record and Replay
+///////////////////////////////////////////////////////////////////////////////
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+class SfeSTP3593LFRecorder; // See SparkFun_STP3593LF_Recorder.h
+
+// The loop state captured at the start of a recording and restored at the start of a replay
+typedef struct
+{
+    uint32_t frequencyControl; // The frequency control word
+    double maxFrequencyChangePPB; // The maximum frequency change in PPB
+    double integral; // The integral term of the floating-point loop (LSBs)
+    int64_t integralQ16; // The integral term of the integer-only loop (LSBs, Q16)
+    bool integralInitialized; // true if integral has been seeded
+    bool integralQ16Initialized; // true if integralQ16 has been seeded
+    bool errorFeedback; // true if the rounding residual is carried into the next output
+    int32_t quantizationResidualQ16; // The residual of the most recent rounding (LSBs, Q16)
+} sfeSTP3593LFLoopState_t;
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -86,7 +227,6 @@ class SfeSTP3593LFDriver
 public:
     // @brief Constructor. Instantiate the driver object using the specified address (if desired).
     SfeSTP3593LFDriver()
-        : _maxFrequencyChangePPB{400.0}
     {
     }
 
@@ -101,14 +241,80 @@ public:
 
     /// @brief Get the 20-bit frequency control word - from the driver's internal copy
     /// @return The 20-bit frequency control word as uint32_t (unsigned)
+    /// Note: after a Probe or Lazy begin, the first call reads the word. It returns 0 if that read fails
     uint32_t getFrequencyControlWord(void);
 
+    /// @brief Get the driver's internal copy of the frequency control word - without touching the bus
+    /// @param word set to the 20-bit frequency control word. Unchanged if the copy is not valid
+    /// @return true if the copy is valid: the word has been read or written
+    bool getCachedFrequencyControlWord(uint32_t &word);
+
     /// @brief Set the 20-bit frequency control word - and update the driver's internal copy
     /// @param freq the frequency control word as uint32_t (unsigned)
     /// @return true if the write is successful
     bool setFrequencyControlWord(uint32_t freq);
 
+    /// @brief Add a signed step to the frequency control word - and update the driver's internal copy
+    /// @param delta the step in LSBs. The result is limited to the pull range (0 - 1000000)
+    /// @return true if the write is successful
+    bool adjustFrequencyControlWord(int32_t delta);
+
 
+#if SFE_STP3593LF_ENABLE_VERIFICATION
+    /// @brief Read the frequency control word back after every setFrequencyControlWord
+    /// @param enable true to verify each write (default false). Doubles the bus traffic of each write
+    /// Note: if the word read back does not match, setFrequencyControlWord returns false and
+    ///       the driver's internal copy holds the word read back
+    void setWriteVerification(bool enable);
+#endif
+
+#if SFE_STP3593LF_ENABLE_DITHER
+    /// @brief Enable or disable sub-LSB dithering of the frequency control word
+    /// @param enable true to alternate between adjacent words to reach a fractional word (default false)
+    /// @param slotsPerEpoch the number of dither slots per one-second epoch (2 - 64, default 8)
+    /// Note: each epoch is divided into slots. A first-order sigma-delta modulator picks the word or the word
+    ///       above for each slot, so the average over the epoch approaches the fractional word; the residual
+    ///       carries into the next epoch. At most one write is made per slot. While dithering is enabled, the
+    ///       discipline loops set the fractional word instead of rounding it. Call serviceDither often.
+    ///       A direct setFrequencyControlWord is overwritten by the next slot: disable the dither first.
+    void enableDither(bool enable, uint8_t slotsPerEpoch = kSfeSTP3593LFDefaultDitherSlots);
+
+    /// @brief Set a fractional frequency control word and start a dither epoch
+    /// @param word the integer part of the word
+    /// @param fraction the fractional part in 1/65536 LSB
+    /// @return true if the first slot's write (if any) is successful
+    /// Note: with dithering disabled, the word is rounded and written
+    bool setDitheredFrequencyControlWord(uint32_t word, uint16_t fraction);
+
+    /// @brief Get the fractional frequency control word being dithered
+    /// @param word returns the integer part of the word
+    /// @param fraction returns the fractional part in 1/65536 LSB
+    void getDitheredFrequencyControlWord(uint32_t &word, uint16_t &fraction);
+
+    /// @brief Write the control word for the current dither slot - if it has changed. Call it from loop()
+    /// @return true if successful. false if a write failed
+    /// Note: call it at least slotsPerEpoch times per second. Missed slots are skipped, not caught up
+    bool serviceDither(void);
+
+    /// @brief Get the number of writes made by the dither
+    /// @return The number of writes
+    uint32_t getDitherWrites(void);
+
+    /// @brief Get the number of dither writes in the most recent complete epoch
+    /// @return The number of writes. Never more than slotsPerEpoch
+    uint8_t getDitherWritesPerEpoch(void);
+#endif
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+#if SFE_STP3593LF_FIXED_POINT
+    /// @brief Get the maximum frequency change in PPB
+    /// @return The maximum frequency change in PPB - from the driver's internal store
+    uint32_t getMaxFrequencyChangePPB(void);
+
+    /// @brief Set the maximum frequency change in PPB - set the driver's internal _maxFrequencyChangePPB
+    /// @param ppb the maximum frequency change in PPB. Whole PPB in the fixed-point build
+    void setMaxFrequencyChangePPB(uint32_t ppb);
+#else
     /// @brief Get the maximum frequency change in PPB
     /// @return The maximum frequency change in PPB - from the driver's internal store
     double getMaxFrequencyChangePPB(void);
@@ -118,6 +324,17 @@ public:
     void setMaxFrequencyChangePPB(double ppb);
 
 
+    /// @brief Set the frequency offset relative to the reference word, in ppb
+    /// @param ppb the fractional frequency offset in parts per billion
+    /// @return true if the write is successful
+    /// Note: see setFrequencyOffsetE15
+    bool setFrequencyOffsetPPB(double ppb);
+
+    /// @brief Get the frequency offset of the current word relative to the reference word
+    /// @return The fractional frequency offset in parts per billion
+    double getFrequencyOffsetPPB(void);
+
+
     /// @brief Set the frequency according to the GNSS receiver clock bias in milliseconds
     /// @param bias the GNSS RX clock bias in milliseconds
     /// @param Pk the Proportional term
@@ -126,23 +343,855 @@ public:
     /// Note: the frequency change will be limited by: the pull range capabilities of the device;
     ///       and the setMaxFrequencyChangePPB.
     /// The default values for Pk and Ik come from testing by Fugro:
-    bool setFrequencyByBiasMillis(double bias, double Pk = 1.0 / 6.25, double Ik = (1.0 / 6.25) / 150.0);
+    bool setFrequencyByBiasMillis(double bias, double Pk = kSfeSTP3593LFDefaultPk, double Ik = kSfeSTP3593LFDefaultIk);
+
+    /// @brief Set the frequency according to the GNSS receiver clock bias, corrected for the PPS sawtooth
+    /// @param bias the GNSS RX clock bias in milliseconds
+    /// @param sawtoothNanos the receiver-reported quantization (sawtooth) error for this epoch in nanoseconds
+    /// @param Pk the Proportional term
+    /// @param Ik the Integral term
+    /// @return true if the write is successful
+    /// Note: the sawtooth is subtracted from the bias before the loop sees it: bias - sawtooth.
+    ///       If your receiver reports the correction (rather than the error), pass its negative.
+    bool setFrequencyByCorrectedBiasMillis(double bias, double sawtoothNanos, double Pk = kSfeSTP3593LFDefaultPk, double Ik = kSfeSTP3593LFDefaultIk);
+
+
+    /// @brief Run one epoch of the discipline state machine and set the frequency using the gains for the new state
+    /// @param bias the GNSS RX clock bias in milliseconds
+    /// @param biasValid false if the GNSS receiver could not provide a bias this epoch (enters holdover)
+    /// @return true if successful. No write is performed in warm-up and holdover
+    /// Note: the state machine steps through warm-up, acquisition, tracking and locked.
+    ///       The Pk and Ik for each state are set by setDisciplineGains. Acquisition uses a wide
+    ///       loop bandwidth; the bandwidth is stepped down as the bias statistics tighten.
+    ///       Call this once per epoch (second) in place of setFrequencyByBiasMillis.
+    bool updateDiscipline(double bias, bool biasValid = true);
+
+    /// @brief Run one epoch of the discipline state machine using a sawtooth-corrected bias
+    /// @param bias the GNSS RX clock bias in milliseconds
+    /// @param sawtoothNanos the receiver-reported quantization (sawtooth) error for this epoch in nanoseconds
+    /// @param biasValid false if the GNSS receiver could not provide a bias this epoch (enters holdover)
+    /// @return true if successful
+    /// Note: the correction is applied before the lock statistics are updated
+    bool updateDisciplineCorrected(double bias, double sawtoothNanos, bool biasValid = true);
+
+    /// @brief Set the frequency according to a timestamped GNSS receiver clock bias - for irregular or faster update rates
+    /// @param timestampMicros the time of the measurement in microseconds - e.g. micros() at the PPS edge
+    /// @param bias the GNSS RX clock bias in milliseconds
+    /// @param Pk the Proportional term
+    /// @param Ik the Integral term
+    /// @return true if the write is successful. false if the timestamp is not after the previous one (no write)
+    /// Note: dt is measured from the previous timed sample; the first uses the nominal one second. The integral
+    ///       step is scaled by dt - so the integral slews at the same rate, limited by setMaxFrequencyChangePPB,
+    ///       and gains tuned at one update per second hold at any rate. The proportional term acts on the present
+    ///       error and needs no scaling. A gap longer than setMaxTimeStepMillis is limited to it, so an outage
+    ///       cannot wind up the integral.
+    bool setFrequencyByTimedBiasMillis(uint32_t timestampMicros, double bias, double Pk = kSfeSTP3593LFDefaultPk, double Ik = kSfeSTP3593LFDefaultIk);
+
+    /// @brief Run one step of the discipline state machine with a timestamped bias - see setFrequencyByTimedBiasMillis
+    /// @param timestampMicros the time of the measurement in microseconds
+    /// @param bias the GNSS RX clock bias in milliseconds
+    /// @param biasValid false if the GNSS receiver could not provide a bias (enters holdover)
+    /// @return true if successful. false if the timestamp is not after the previous one
+    /// Note: the warm-up and lock counts and the bias statistics advance by dt, so epochs keep their meaning in seconds
+    bool updateDisciplineTimed(uint32_t timestampMicros, double bias, bool biasValid = true);
+
+    /// @brief Get the current state of the discipline state machine
+    /// @return The discipline state
+    sfeSTP3593LFDisciplineState_t getDisciplineState(void);
+
+    /// @brief Reset the discipline state machine to warm-up and re-seed the integrator from the control word
+    void resetDiscipline(void);
+
+    /// @brief Set the Pk and Ik used by updateDiscipline in the chosen state
+    /// @param state the discipline state
+    /// @param Pk the Proportional term
+    /// @param Ik the Integral term
+    void setDisciplineGains(sfeSTP3593LFDisciplineState_t state, double Pk, double Ik);
+
+    /// @brief Get the Pk used by updateDiscipline in the chosen state
+    /// @param state the discipline state
+    /// @return The Proportional term
+    double getDisciplinePk(sfeSTP3593LFDisciplineState_t state);
+
+    /// @brief Get the Ik used by updateDiscipline in the chosen state
+    /// @param state the discipline state
+    /// @return The Integral term
+    double getDisciplineIk(sfeSTP3593LFDisciplineState_t state);
+
+    /// @brief Set the number of epochs to hold the control word while the oven warms up
+    /// @param epochs the warm-up duration in epochs (default 0)
+    void setWarmupEpochs(uint32_t epochs);
+
+    /// @brief Set the number of consecutive in-threshold epochs required to change state (default 60)
+    /// @param epochs the number of epochs
+    void setLockEpochs(uint32_t epochs);
+
+    /// @brief Set the RMS bias below which the loop is considered locked
+    /// @param threshold the lock threshold in milliseconds (default 20ns, 20.0e-6)
+    void setLockThresholdMillis(double threshold);
+
+    /// @brief Set the bias magnitude above which the loop returns to acquisition
+    /// @param threshold the acquisition threshold in milliseconds (default 1us, 1.0e-3)
+    void setAcquisitionThresholdMillis(double threshold);
+
+    /// @brief Get the exponentially-weighted mean of the bias seen by updateDiscipline
+    /// @return The mean bias in milliseconds
+    double getBiasMeanMillis(void);
+
+    /// @brief Get the exponentially-weighted standard deviation of the bias seen by updateDiscipline
+    /// @return The bias standard deviation in milliseconds
+    double getBiasStdDevMillis(void);
+
+
+    /// @brief Provide the oven / board temperature for this epoch - the optional temperature input channel
+    /// @param degC the temperature in degrees C
+    /// Note: the first temperature provided becomes the reference temperature for the feed-forward.
+    ///       Call this before each setFrequencyBy... call. The LSBs-per-degree coefficient is learned
+    ///       online, by recursive least squares on the loop's integrator, whether or not the
+    ///       feed-forward is enabled. (Without SFE_STP3593LF_ENABLE_STATISTICS, use setTemperatureCoefficient.)
+    void setTemperature(double degC);
+
+    /// @brief Enable or disable the temperature-compensation feed-forward to the control word
+    /// @param enable true to add (coefficient * (temperature - reference)) to the control word
+    void enableTemperatureCompensation(bool enable);
+
+    /// @brief Get the learned temperature coefficient
+    /// @return The temperature coefficient in control word LSBs per degree C
+    double getTemperatureCoefficient(void);
+
+    /// @brief Seed the temperature coefficient - e.g. from a previous run or a characterization
+    /// @param lsbsPerDegC the temperature coefficient in control word LSBs per degree C
+    void setTemperatureCoefficient(double lsbsPerDegC);
+
+    /// @brief Get the temperature feed-forward currently applied to the control word
+    /// @return The feed-forward in control word LSBs. Zero if compensation is disabled
+    double getTemperatureFeedForward(void);
+
+    /// @brief Get the frequency control resolution the loop is using to convert bias to LSBs
+    /// @return The resolution (fractional frequency per LSB). 8E-13 unless the estimate is fed back
+    double getFreqControlResolution(void);
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    /// @brief Set the forgetting factor of the temperature coefficient estimator
+    /// @param lambda the forgetting factor, 0.0 - 1.0 (default 0.9999: a memory of ~10000 epochs)
+    void setTemperatureForgettingFactor(double lambda);
+
+
+    /// @brief Get the estimated frequency control resolution (fractional frequency per LSB)
+    /// @return The resolution learned online from the bias response to control word changes
+    /// Note: the estimator regresses the bias rate (bias change per epoch) on the control word
+    ///       in effect during that epoch, by recursive least squares, each setFrequencyByBiasMillis.
+    ///       It needs the control word to move - it learns fastest during acquisition.
+    double getEstimatedFreqControlResolution(void);
+
+    /// @brief Get the 1-sigma uncertainty of the estimated frequency control resolution
+    /// @return The uncertainty (fractional frequency per LSB). Compare with getEstimatedFreqControlResolution
+    double getEstimatedFreqControlResolutionUncertainty(void);
+
+    /// @brief Feed the estimated resolution back into the bias-to-LSB conversion
+    /// @param enable true to use the estimate once its uncertainty is below 10%; false to use 8E-13
+    void useEstimatedFreqControlResolution(bool enable);
+
+    /// @brief Set the forgetting factor of the resolution estimator
+    /// @param lambda the forgetting factor, 0.0 - 1.0 (default 0.999: a memory of ~1000 epochs)
+    void setFreqControlResolutionForgettingFactor(double lambda);
+
+    /// @brief Keep running statistics of the control word and the loop input - per minute, hour and day
+    /// @param aggregator the aggregator. nullptr stops aggregating
+    /// Note: each setFrequencyByBiasMillis and setFrequencyByPhasePicoseconds (and the calls built on them)
+    ///       adds one sample, over the loop time step. The aggregator must stay valid while attached
+    void setAggregator(SfeSTP3593LFAggregator *aggregator);
+
+    /// @brief Forecast when the control word will reach the end of the pull range (0 or 1000000) - e.g. through aging
+    /// @param days returns the expected time to the rail, in days of loop operation
+    /// @param earliestDays returns the earliest time to either rail (trend + 2 sigma)
+    /// @param latestDays returns the latest time to the rail (trend - 2 sigma)
+    /// @return true once kSfeSTP3593LFPullRangeMinHours of trend have been seen. Until then all three are
+    ///         kSfeSTP3593LFPullRangeNeverDays - as is any time when the word is not moving towards a rail
+    /// Note: the mean word of each hour of setFrequencyBy... calls (while updateDiscipline is tracking or locked) is regressed against time,
+    ///       by recursive least squares with forgetting. Time includes warm-up and holdover, which add no samples. The bounds assume the hourly means are independent:
+    ///       a daily temperature cycle makes them optimistic until it has been seen for a week or two
+    bool getPullRangeForecast(double &days, double &earliestDays, double &latestDays);
+
+    /// @brief Get the trend of the control word
+    /// @return The trend in LSBs per day. Positive moves towards 1000000
+    double getPullRangeTrendPerDay(void);
+
+    /// @brief Set the warning threshold of the pull-range forecast
+    /// @param days the warning is raised when the earliest time to a rail is less than this (default 365)
+    void setPullRangeWarningDays(double days);
+
+    /// @brief Check the pull-range warning - checked once per hour of trend
+    /// @return true if the earliest time to a rail has fallen below the threshold. It stays set until cleared
+    bool getPullRangeWarning(void);
+
+    /// @brief Clear the pull-range warning. It is raised again at the next hour if the forecast is still short
+    void clearPullRangeWarning(void);
+
+    /// @brief Set the forgetting factor of the pull-range trend estimator
+    /// @param lambda the forgetting factor per hour, 0.0 - 1.0 (default 0.9995: a memory of ~2000 hours)
+    void setPullRangeForgettingFactor(double lambda);
+
+    /// @brief Forget the pull-range trend - e.g. after the oscillator has been recalibrated or replaced
+    void resetPullRangeForecast(void);
+#endif // SFE_STP3593LF_ENABLE_STATISTICS
+#endif // SFE_STP3593LF_FIXED_POINT
+
+
+    /// @brief Use a piecewise-linear calibration table for the conversion from fractional frequency to control word
+    /// @param table the table. The words must increase and the offsets must increase - strictly, or it is
+    ///        rejected. nullptr disables the table
+    /// @param numPoints the number of points in the table (2 - kSfeSTP3593LFMaxCalPoints)
+    /// @return true if the table is valid and is now in use
+    /// Note: the table is not copied - it must remain valid while in use (e.g. a constexpr array).
+    ///       With a table, the loop output is treated as a linearized word and mapped through the
+    ///       table - by binary search and interpolation - before it is written.
+    bool setCalibrationTable(const sfeSTP3593LFCalPoint_t *table, uint8_t numPoints);
+
+    /// @brief Get the calibration table in use
+    /// @param numPoints returns the number of points in the table
+    /// @return A pointer to the table. nullptr if no table is in use
+    const sfeSTP3593LFCalPoint_t *getCalibrationTable(uint8_t &numPoints);
+
+    /// @brief Convert a control word to fractional frequency using the calibration table
+    /// @param word the frequency control word
+    /// @return The fractional frequency relative to the first point, in parts per 10^15.
+    ///         If no table is in use, this is linear about mid-range (500000)
+    int32_t getCalibratedOffsetE15(uint32_t word);
+
+    /// @brief Convert a fractional frequency to a control word using the calibration table
+    /// @param offsetE15 the fractional frequency relative to the first point, in parts per 10^15
+    /// @return The frequency control word, limited to the pull range.
+    ///         If no table is in use, this is linear about mid-range (500000)
+    uint32_t getCalibratedWord(int32_t offsetE15);
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    /// @brief Start a calibration sweep: step the control word across the range and measure the frequency at each step
+    /// @param table the table to fill. It is used via setCalibrationTable when the sweep completes
+    /// @param numPoints the number of points to measure (2 - kSfeSTP3593LFMaxCalPoints)
+    /// @param firstWord the first control word of the sweep
+    /// @param lastWord the last control word of the sweep
+    /// @param dwellEpochs the number of epochs to measure the bias rate at each point
+    /// @param settleEpochs the number of epochs to wait after each step before measuring
+    /// @return true if the sweep has started
+    /// Note: the oscillator is deliberately pulled up to +/-400ppb. Make sure the GNSS receiver can tolerate it.
+    ///       Do not call setFrequencyBy... or updateDiscipline while the sweep is running.
+    bool beginCalibrationSweep(sfeSTP3593LFCalPoint_t *table, uint8_t numPoints, uint32_t firstWord = 0,
+                               uint32_t lastWord = kSfeSTP3593LFFreqControlMaxValue, uint16_t dwellEpochs = 60, uint16_t settleEpochs = 10);
+
+    /// @brief Run one epoch of the calibration sweep
+    /// @param bias the GNSS RX clock bias in milliseconds
+    /// @return true while the sweep is running. false once it is complete (or if a write failed) - see getCalibrationSweepResult
+    /// Note: when the sweep ends - complete or abandoned - the original control word is restored
+    bool updateCalibrationSweep(double bias);
+
+    /// @brief Get the outcome of the last calibration sweep
+    /// @return kSfeSTP3593LFSweepApplied if the table is in use. Rejected, WriteFailed or RestoreFailed if not
+    sfeSTP3593LFSweepResult_t getCalibrationSweepResult(void);
+
+    /// @brief Check if a calibration sweep is running
+    /// @return true if a calibration sweep is running
+    bool isCalibrationSweepRunning(void);
+
+    /// @brief Get the progress of the calibration sweep
+    /// @return The progress in percent
+    uint8_t getCalibrationSweepProgress(void);
+#endif
+
+    /// @brief Enable or disable error feedback (noise shaping) in the rounding of the loop output
+    /// @param enable true to carry each epoch's rounding residual into the next epoch's output (default false)
+    /// Note: without it, the loop rounds proportional plus integral to the nearest word and discards the
+    ///       remainder. With it, the remainder is added to the next output before rounding, so the rounding
+    ///       errors cancel and the average word approaches the loop output. Not used while dithering
+    void enableErrorFeedback(bool enable);
+
+    /// @brief Get the remainder discarded by the most recent rounding of the loop output
+    /// @return The residual in control word LSBs, Q16 (65536 == 1 LSB). Limited to +/-1 LSB
+    /// Note: the word written plus the residual is the loop output. With error feedback, the residual
+    ///       is carried into the next output
+    int32_t getQuantizationResidualQ16(void);
+
+
+    /// @brief Set the frequency offset relative to the reference word, in parts per 10^15
+    /// @param offsetE15 the fractional frequency offset in parts per 10^15 (1 ppb == 1000000)
+    /// @return true if the write is successful
+    /// Note: the offset is converted to a word once, here - through the calibration table if one is in use.
+    ///       The word is limited to the pull range. A running discipline loop will steer away from it:
+    ///       use this for free-running operation, or to place the oscillator before the loop starts
+    bool setFrequencyOffsetE15(int32_t offsetE15);
+
+    /// @brief Get the frequency offset of the current word relative to the reference word
+    /// @return The fractional frequency offset in parts per 10^15
+    int32_t getFrequencyOffsetE15(void);
+
+    /// @brief Get the reference word: the word which gives zero frequency offset
+    /// @return The reference word, rounded. Seeded from the first word read (the saved value) if not yet known
+    uint32_t getReferenceWord(void);
+
+    /// @brief Set the reference word - e.g. from a characterization, or from a previous run
+    /// @param word the frequency control word which gives zero frequency offset
+    void setReferenceWord(uint32_t word);
+
+    /// @brief Refine the reference word from the loop's integrator - one epoch of its time constant
+    /// Note: updateDiscipline does this each epoch while locked. Call it once per epoch when the phase
+    ///       (integer) loop is locked to a trusted reference. Does nothing if the integrator is not seeded
+    void refineReferenceWord(void);
+
+
+    /// @brief Start steering out a known phase (time) offset: offset the frequency for a while, then return
+    /// @param nanos the phase correction in nanoseconds. Positive runs the oscillator fast, so its time advances
+    /// @param durationEpochs the epochs (seconds) to spread the correction over
+    /// @return true if the steering has started. false if the word cannot be read, or the correction is
+    ///         zero or larger than kSfeSTP3593LFMaxSteeringNanos
+    /// Note: the frequency offset is limited to the maximum frequency change (setMaxFrequencyChangePPB):
+    ///       if the correction cannot be made in durationEpochs, the duration is extended - see
+    ///       getPhaseSteeringEpochs. The offset is applied to the word in use when steering starts, and that
+    ///       word is restored at the end. The trajectory holds a constant offset - to within one LSB - so it
+    ///       takes at most three writes. Do not call setFrequencyBy... or updateDiscipline while steering.
+    bool beginPhaseSteering(int32_t nanos, uint32_t durationEpochs);
+
+    /// @brief Run one epoch of the phase steering. Call it once per epoch (second)
+    /// @return true while the steering is running. false once it is complete - see getPhaseSteeringResult
+    /// Note: each epoch's offset is planned from the phase still to go, so an offset clipped by the pull
+    ///       range, or a failed write, is made up in the epochs which remain. If the write restoring the
+    ///       original word fails, the steering keeps running and the restore is retried each epoch
+    bool updatePhaseSteering(void);
+
+    /// @brief Stop the phase steering early and restore the original word
+    /// @return true if the write is successful. If not, updatePhaseSteering retries it
+    bool cancelPhaseSteering(void);
+
+    /// @brief Get the outcome of the last phase steering
+    /// @return kSfeSTP3593LFSteeringComplete once the original word is restored. Restoring while its write is retried
+    sfeSTP3593LFSteeringResult_t getPhaseSteeringResult(void);
+
+    /// @brief Check if phase steering is running
+    /// @return true if phase steering is running
+    bool isPhaseSteeringRunning(void);
+
+    /// @brief Get the planned duration of the phase steering
+    /// @return The duration in epochs - durationEpochs, or longer if the frequency offset was limited
+    uint32_t getPhaseSteeringEpochs(void);
+
+    /// @brief Get the progress of the phase steering
+    /// @return The progress in percent
+    uint8_t getPhaseSteeringProgress(void);
+
+    /// @brief Get the phase still to be steered out
+    /// @return The residual in picoseconds. At the end, this is the part smaller than one LSB for one epoch (0.8ps)
+    int64_t getPhaseSteeringResidualPicoseconds(void);
+
+    /// @brief Get the number of writes made by the phase steering
+    /// @return The number of writes
+    uint32_t getPhaseSteeringWrites(void);
+
+
+    /// @brief Configure the time-interval-counter (TIC) input used by setFrequencyByTICCount
+    /// @param tickPicoseconds the duration of one capture count in picoseconds (e.g. 12500 for an 80MHz timer)
+    /// @param counterBits the width of the capture counter in bits (1-32). Wraparound is handled modulo 2^counterBits
+    /// @param countsPerEpoch the nominal count increment per epoch (e.g. 10000000 for a counter clocked by the OCXO
+    ///                       and captured by the PPS; 0 for a TIC which measures the PPS-to-oscillator phase directly)
+    /// @param referenceCount the capture count which corresponds to zero phase error
+    /// Note: this resets the unwrapped phase. The next capture is measured relative to referenceCount.
+    void setTICConfiguration(uint32_t tickPicoseconds, uint8_t counterBits = 32, uint32_t countsPerEpoch = 0, uint32_t referenceCount = 0);
+
+    /// @brief Set the frequency according to a raw TIC capture count. Integer-only arithmetic
+    /// @param captureCount the raw capture count for this epoch
+    /// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+    /// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+    /// @return true if the write is successful
+    /// Note: the count is unwrapped against the previous capture, so the phase is continuous across counter
+    ///       wraparound. A count above the reference means the oscillator is ahead of the PPS.
+    bool setFrequencyByTICCount(uint32_t captureCount, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16);
+
+    /// @brief Set the frequency according to a raw TIC capture count, corrected for the PPS sawtooth
+    /// @param captureCount the raw capture count for this epoch
+    /// @param sawtoothPicoseconds the receiver-reported quantization (sawtooth) error for this PPS edge in picoseconds
+    /// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+    /// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+    /// @return true if the write is successful
+    /// Note: the correction applies to this epoch only. It is not accumulated into the unwrapped phase
+    bool setFrequencyByCorrectedTICCount(uint32_t captureCount, int32_t sawtoothPicoseconds, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16);
+
+    /// @brief Set the frequency according to the PPS-to-oscillator phase in picoseconds. Integer-only arithmetic
+    /// @param phase the phase in picoseconds. Positive means the oscillator is ahead (same sense as the clock bias)
+    /// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+    /// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+    /// @return true if the write is successful
+    /// Note: the frequency change will be limited by: the pull range capabilities of the device;
+    ///       and the setMaxFrequencyChangePPB.
+    bool setFrequencyByPhasePicoseconds(int32_t phase, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16);
+
+    /// @brief Set the frequency according to the PPS-to-oscillator phase, corrected for the PPS sawtooth
+    /// @param phase the phase in picoseconds. Positive means the oscillator is ahead
+    /// @param sawtoothPicoseconds the receiver-reported quantization (sawtooth) error for this PPS edge in picoseconds
+    /// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+    /// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+    /// @return true if the write is successful
+    /// Note: the sawtooth is subtracted from the phase before the loop sees it: phase - sawtooth
+    bool setFrequencyByCorrectedPhasePicoseconds(int32_t phase, int32_t sawtoothPicoseconds, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16);
+
+    /// @brief Get the unwrapped TIC phase from the most recent setFrequencyByTICCount
+    /// @return The phase in picoseconds
+    int64_t getTICPhasePicoseconds(void);
+
+    /// @brief Set the frequency according to a timestamped PPS-to-oscillator phase. Integer-only arithmetic
+    /// @param timestampMicros the time of the measurement in microseconds - e.g. micros() at the PPS edge
+    /// @param phase the phase in picoseconds. Positive means the oscillator is ahead
+    /// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+    /// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+    /// @return true if the write is successful. false if the timestamp is not after the previous one (no write)
+    /// Note: the integral step is scaled by dt - see setFrequencyByTimedBiasMillis
+    bool setFrequencyByTimedPhasePicoseconds(uint32_t timestampMicros, int32_t phase, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16);
+
+    /// @brief Set the longest time step the timed... calls integrate over
+    /// @param milliseconds the maximum time step (default 4000, limited to 1 - 60000)
+    void setMaxTimeStepMillis(uint32_t milliseconds);
+
+    /// @brief Get the time step used by the most recent timed... call
+    /// @return The time step in microseconds, after any gap limiting
+    uint32_t getTimeStepMicros(void);
+
+    /// @brief Get the number of timed samples dropped because their timestamp was not after the previous one
+    /// @return The number of samples
+    uint32_t getTimeStepRejections(void);
+
+    /// @brief Get the number of timed samples whose time step was limited by setMaxTimeStepMillis
+    /// @return The number of samples
+    uint32_t getTimeStepGaps(void);
+
+    /// @brief Apply queued samples with the time step between their queue timestamps
+    /// @param enable true to make serviceDiscipline behave like the timed... calls (default false: one second per sample)
+    void useSampleTimestamps(bool enable);
+
+
+    /// @brief Queue a raw TIC capture count for serviceDiscipline. Wait-free and ISR-safe
+    /// @param captureCount the raw capture count for this epoch
+    /// @param sawtoothPicoseconds the receiver-reported quantization (sawtooth) error for this PPS edge in picoseconds
+    /// @return true if the sample was queued. false if the queue is full (the sample is dropped)
+    /// Note: the queue has a single producer. Make all queue... calls from one context - e.g. the PPS interrupt.
+    ///       The sample is timestamped with micros(). No bus transaction is made
+    bool queueTICCount(uint32_t captureCount, int32_t sawtoothPicoseconds = 0);
+
+    /// @brief Queue the PPS-to-oscillator phase for serviceDiscipline. Wait-free and ISR-safe
+    /// @param phase the phase in picoseconds. Positive means the oscillator is ahead
+    /// @param sawtoothPicoseconds the receiver-reported quantization (sawtooth) error for this PPS edge in picoseconds
+    /// @return true if the sample was queued. false if the queue is full (the sample is dropped)
+    bool queuePhasePicoseconds(int32_t phase, int32_t sawtoothPicoseconds = 0);
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+    /// @brief Queue the GNSS receiver clock bias for serviceDiscipline (via updateDiscipline). Wait-free
+    /// @param bias the GNSS RX clock bias in milliseconds. Limited to +/-2.1ms
+    /// @param sawtoothNanos the receiver-reported quantization (sawtooth) error for this epoch in nanoseconds
+    /// @param biasValid false if the GNSS receiver could not provide a bias this epoch (enters holdover)
+    /// @return true if the sample was queued
+    /// Note: uses floating point - which is not ISR-safe on every core (e.g. ESP32). Call it from a task
+    bool queueBiasMillis(double bias, double sawtoothNanos = 0.0, bool biasValid = true);
+#endif
+
+    /// @brief Apply every queued sample, oldest first - writing the control word over I2C. Task context only
+    /// @return The number of samples applied
+    /// Note: TIC and phase samples use the gains set by setQueueGainsQ16; bias samples use updateDiscipline.
+    ///       Call it from loop(), or let startDisciplineTask call it
+    uint8_t serviceDiscipline(void);
+
+    /// @brief Set the gains serviceDiscipline uses for TIC and phase samples
+    /// @param PkQ16 the Proportional term in Q16 fixed-point (65536 == 1.0)
+    /// @param IkQ16 the Integral term in Q16 fixed-point (65536 == 1.0)
+    void setQueueGainsQ16(int32_t PkQ16, int32_t IkQ16);
+
+    /// @brief Get the longest time from queue... to the end of its write in serviceDiscipline
+    /// @return The maximum latency in microseconds
+    uint32_t getMaxSampleLatencyMicros(void);
+
+    /// @brief Get the number of samples dropped because the queue was full
+    /// @return The number of samples
+    uint16_t getSampleQueueOverflows(void);
+
+    /// @brief Get the number of queued samples whose write failed
+    /// @return The number of samples
+    uint32_t getSampleWriteFailures(void);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    /// @brief Start a FreeRTOS task which calls serviceDiscipline each time a sample is queued
+    /// @param priority the task priority
+    /// @param core the core to pin the task to. -1 for either core
+    /// @return true if the task is running
+    /// Note: the queue... calls notify the task - from an interrupt or from a task.
+    ///       With SfeSTP3593LFThreadSafe, call its serviceDiscipline from your own task instead
+    bool startDisciplineTask(uint8_t priority = 5, int8_t core = 1);
+#endif
+#endif // SFE_STP3593LF_ENABLE_PI_LOOP
 
 
     /// @brief Save the frequency control value - to be reloaded at start-up
     /// @return true if the write is successful
     bool saveFrequencyControlValue(void);
 
+
+    /// @brief Serialize the learned loop state - integrators, gains, state machine and estimators - for a warm start
+    /// @param buffer where to write the snapshot - e.g. then copy it to EEPROM, Preferences or a file
+    /// @param bufferSize the size of buffer. kSfeSTP3593LFSnapshotMaxSize is always enough
+    /// @return The length of the snapshot. 0 if buffer is too small
+    /// Note: the format is versioned and portable - see SparkFun_STP3593LF_Snapshot.h
+    size_t getSnapshot(uint8_t *buffer, size_t bufferSize);
+
+    /// @brief Restore a snapshot from getSnapshot - and write its control word
+    /// @param snapshot the snapshot
+    /// @param length the length of the snapshot
+    /// @return true if the snapshot is valid, was restored and the word was written. The loop state is unchanged if invalid
+    /// Note: a Locked, Tracking or Holdover loop resumes in Tracking: lock is re-confirmed, not assumed.
+    ///       Use the same calibration table as when the snapshot was taken. Restore after begin,
+    ///       or pass the snapshot to setWarmStart before begin
+    bool restoreSnapshot(const uint8_t *snapshot, size_t length);
+
+    /// @brief Choose what begin does on the bus. Call before begin
+    /// @param mode the begin mode. Default: kSfeSTP3593LFBeginVerified
+    /// Note: in the Probe and Lazy modes the word is read on first use - by getFrequencyControlWord,
+    ///       adjustFrequencyControlWord, the first setFrequencyBy... call or getSnapshot - unless a
+    ///       write comes first. A missing device is only reported then. A warm start writes the
+    ///       word in every mode
+    void setBeginMode(sfeSTP3593LFBeginMode_t mode);
+
+    /// @brief Get the begin mode
+    /// @return The begin mode
+    sfeSTP3593LFBeginMode_t getBeginMode(void);
+
+    /// @brief Have begin restore a snapshot - a warm start. begin falls back to a cold start if the snapshot is invalid
+    /// @param snapshot the snapshot. It must remain valid until begin returns. nullptr for a cold start
+    /// @param length the length of the snapshot
+    void setWarmStart(const uint8_t *snapshot, size_t length);
+
+    /// @brief Check if begin restored the warm-start snapshot
+    /// @return true if the most recent begin was a warm start
+    bool getWarmStarted(void);
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+
+    /// @brief Record every input to the loop - biases, phases, gains, temperatures and settings - with timestamps
+    /// @param recorder the recorder. nullptr stops recording
+    /// Note: the loop state is written as the recording header. For a bit-identical replay of the
+    ///       estimators, start recording before the first setFrequencyBy... call.
+    ///       Direct calls to setFrequencyControlWord and setCalibrationTable are not recorded.
+    void setRecorder(SfeSTP3593LFRecorder *recorder);
+#endif
+
 protected:
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    /// @brief Capture the loop state - for recording
+    /// @param state the state
+    void getLoopState(sfeSTP3593LFLoopState_t &state);
+
+    /// @brief Restore the loop state - for replay
+    /// @param state the state
+    void setLoopState(const sfeSTP3593LFLoopState_t &state);
+
+    /// @brief Set the time step of the next loop update - for replay
+    /// @param micros the time step in microseconds
+    void setTimeStepMicros(uint32_t micros);
+#endif
+
     /// @brief Sets the communication bus to the specified bus.
     /// @param theBus Bus to set as the communication devie.
     void setCommunicationBus(sfeTkArdI2C *theBus);
 
 private:
-    sfeTkArdI2C *_theBus; // Pointer to bus device.
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+    /// @brief Change the discipline state and reset the per-state counters
+    /// @param state the new discipline state
+    void enterDisciplineState(sfeSTP3593LFDisciplineState_t state);
+
+    /// @brief Add the feed-forward terms, limit to the pull range, round and write the control word
+    /// @param word the loop output (proportional plus integral) in control word LSBs
+    /// @return true if the write is successful
+    bool writeDisciplinedWord(double word);
+
+    /// @brief Recalculate _temperatureFeedForward from the temperature and the coefficient
+    void updateTemperatureFeedForward(void);
+#endif
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    /// @brief Update the temperature coefficient estimator with the loop's steady-state word
+    /// @param integral the loop's integrator in control word LSBs
+    void updateTemperatureModel(double integral);
+
+    /// @brief Update the resolution estimator with this epoch's bias
+    /// @param bias the GNSS RX clock bias in milliseconds
+    void updateResolutionModel(double bias);
+
+    /// @brief Add this step's control word to the pull-range trend
+    void updatePullRangeModel(void);
+
+    /// @brief Change the resolution used by the loop and recalculate the integer conversion factors
+    /// @param resolution the frequency control resolution (fractional frequency per LSB)
+    void setFreqControlResolution(double resolution);
+
+    /// @brief Change the resolution while the loop is running. With a calibration table, the integrators
+    ///        and the reference word are rescaled so they still convert to the same control word
+    /// @param resolution the frequency control resolution (fractional frequency per LSB)
+    void changeFreqControlResolution(double resolution);
+
+    /// @brief One step of two-parameter (instrumental-variable) recursive least squares with forgetting
+    /// @param theta the parameters: offset, slope
+    /// @param p the covariance: p00, p01, p10, p11
+    /// @param lambda the forgetting factor
+    /// @param x1 the regressor. The full regressor is x = [1, x1]
+    /// @param z1 the instrument. Pass x1 for ordinary recursive least squares
+    /// @param y the observation
+    /// @return The a-priori prediction error
+    static double updateRLS(double *theta, double *p, double lambda, double x1, double z1, double y);
+
+    /// @brief Close the current sweep point: calculate its frequency and move to the next point
+    /// @return true if the sweep continues
+    bool nextCalibrationSweepPoint(void);
+
+    /// @brief End the calibration sweep: restore the original word and record the outcome
+    /// @param result the outcome - if the original word is restored
+    void endCalibrationSweep(sfeSTP3593LFSweepResult_t result);
+#endif
+
+    /// @brief Check both columns of a calibration table are strictly increasing - as the binary search needs
+    /// @param table the table
+    /// @param numPoints the number of points in the table
+    /// @return true if the table is strictly increasing
+    static bool isCalibrationTableIncreasing(const sfeSTP3593LFCalPoint_t *table, uint8_t numPoints);
+
+    /// @brief Unwrap a raw TIC capture count into the continuous phase
+    /// @param captureCount the raw capture count for this epoch
+    /// @return The unwrapped phase in picoseconds, limited to the int32_t range
+    int32_t unwrapTICCount(uint32_t captureCount);
+
+    /// @brief Convert a control word to the linearized word the loop integrates - via the calibration table
+    /// @param word the frequency control word
+    /// @return The linearized word in LSBs, Q16. Equal to the word if no table is in use
+    int64_t wordToLinearQ16(uint32_t word);
+
+    /// @brief Convert a linearized word to the control word - via the calibration table
+    /// @param linearQ16 the linearized word in LSBs, Q16
+    /// @return The control word, limited to the pull range
+    uint32_t linearQ16ToWord(int64_t linearQ16);
+
+    /// @brief Seed the reference word from the control word, if it is not yet known
+    /// @return true if the reference word is known
+    bool ensureReferenceWord(void);
+
+    /// @brief Move the reference word one epoch of its time constant towards the integrator
+    /// @param integralQ16 the loop's integrator in linearized LSBs, Q16
+    void moveReferenceWord(int64_t integralQ16);
+
+    /// @brief Plan the linearized offset for the next steering epoch from the phase still to go
+    /// @return The offset in whole LSBs - limited to the maximum frequency change
+    int32_t nextPhaseSteeringOffset(void);
+
+    /// @brief End the phase steering: restore the original word
+    /// @return true if the word is restored. If not, the steering keeps running so that updatePhaseSteering retries
+    bool restorePhaseSteeringWord(void);
+
+    /// @brief Write the loop output: round it, or hand it to the dither with its fraction
+    /// @param linearQ16 the linearized word in LSBs, Q16
+    /// @return true if the write is successful
+    bool writeLinearQ16(int64_t linearQ16);
+
+    /// @brief Get the word the loop asked for - for the recorder
+    /// @param written the result of the loop's write
+    /// @return The control word, or the rounded dither target while dithering
+    uint32_t getLoopOutputWord(bool written);
+
+    /// @brief Measure dt from the previous timed sample and make it the time step of the next loop update
+    /// @param timestampMicros the time of the measurement in microseconds
+    /// @return true if the time step is valid. false if the timestamp is not after the previous one
+    bool beginTimeStep(uint32_t timestampMicros);
+
+    /// @brief Timestamp a sample, queue it and notify the discipline task
+    /// @param type the sample type
+    /// @param value the count, phase or bias
+    /// @param sawtoothPicoseconds the sawtooth error in picoseconds
+    /// @return true if the sample was queued
+    bool queueSample(sfeSTP3593LFSampleType_t type, int32_t value, int32_t sawtoothPicoseconds);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    /// @brief The discipline task: wait for a notification, then service the queue
+    /// @param driver the driver
+    static void disciplineTask(void *driver);
+#endif
+#endif // SFE_STP3593LF_ENABLE_PI_LOOP
+
+    /// @brief Read the frequency control word if the driver's copy is not valid yet - after a Probe or Lazy begin
+    /// @return true if the driver's copy is valid
+    bool ensureFrequencyControlWord(void);
+
+#if SFE_STP3593LF_ENABLE_DITHER
+    /// @brief Run one dither slot: advance the modulator and write the word if it has changed
+    /// @return true if successful
+    bool ditherStep(void);
+#endif
+
+    sfeTkArdI2C *_theBus{nullptr}; // Pointer to bus device.
+
+    uint32_t _frequencyControl{0}; // Local store for the frequency control word. 20-Bit
+    bool _frequencyControlValid{false}; // true once _frequencyControl has been read or written
+    sfeSTP3593LFBeginMode_t _beginMode{kSfeSTP3593LFBeginVerified}; // What begin does on the bus
+
+    const uint8_t *_warmStart{nullptr}; // The snapshot for begin to restore. nullptr for a cold start
+    size_t _warmStartLength{0}; // The length of _warmStart
+    bool _warmStarted{false}; // true if begin restored _warmStart
+
+#if SFE_STP3593LF_ENABLE_VERIFICATION
+    bool _writeVerification{false}; // true if setFrequencyControlWord reads the word back
+#endif
+
+#if SFE_STP3593LF_ENABLE_DITHER
+    bool _ditherEnabled{false}; // true if the control word is dithered
+    bool _ditherActive{false}; // true once a fractional word has been set
+    uint8_t _ditherSlots{kSfeSTP3593LFDefaultDitherSlots}; // The number of dither slots per epoch
+    uint32_t _ditherSlotMicros{kSfeSTP3593LFNominalTimeStepMicros / kSfeSTP3593LFDefaultDitherSlots}; // The duration of one slot
+    uint32_t _ditherWord{0}; // The fractional word: integer part
+    uint16_t _ditherFraction{0}; // The fractional word: fractional part in 1/65536 LSB
+    uint32_t _ditherAccumulator{0}; // The sigma-delta accumulator. Carries the residual from epoch to epoch
+    uint32_t _ditherEpochStart{0}; // micros() at the start of the dither epoch
+    uint32_t _ditherSlot{0}; // The next slot to run in this epoch
+    uint32_t _ditherWrites{0}; // The number of writes made by the dither
+    uint8_t _ditherEpochWrites{0}; // The number of dither writes so far this epoch
+    uint8_t _ditherLastEpochWrites{0}; // The number of dither writes in the previous epoch
+#endif
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+#if SFE_STP3593LF_FIXED_POINT
+    uint32_t _maxFrequencyChangePPB{400}; // The maximum frequency change in PPB
+#else
+    double _maxFrequencyChangePPB{400.0}; // The maximum frequency change in PPB for setFrequencyByBiasMillis
+
+    double _integral{0.0}; // The integral term of setFrequencyByBiasMillis, in control word LSBs
+    bool _integralInitialized{false}; // true once _integral has been seeded from _frequencyControl
+
+    sfeSTP3593LFDisciplineState_t _disciplineState{kSfeSTP3593LFStateWarmup}; // The current discipline state
+    bool _disciplineActive{false}; // true once updateDiscipline has run: the state applies to the loop
+    uint32_t _stateEpochs{0}; // The number of epochs spent in the current state
+    uint32_t _warmupEpochs{0}; // The number of epochs to hold the control word while the oven warms up
+    uint32_t _lockEpochs{60}; // The number of consecutive in-threshold epochs needed to change state
+    uint32_t _lockCount{0}; // The number of consecutive in-threshold epochs so far
+    uint32_t _epochMicros{0}; // Time accumulated towards the next whole epoch - by updateDisciplineTimed
+    double _lockThresholdMillis{20.0e-6}; // The RMS bias below which the loop is locked
+    double _acquisitionThresholdMillis{1.0e-3}; // The bias above which the loop returns to acquisition
+    double _biasMean{0.0}; // Exponentially-weighted mean of the bias (millis)
+    double _biasVariance{0.0}; // Exponentially-weighted variance of the bias (millis^2)
+    double _disciplinePk[kSfeSTP3593LFNumDisciplineStates]{4.0 * kSfeSTP3593LFDefaultPk, 4.0 * kSfeSTP3593LFDefaultPk, kSfeSTP3593LFDefaultPk, kSfeSTP3593LFDefaultPk / 4.0, kSfeSTP3593LFDefaultPk}; // The Pk for each discipline state
+    double _disciplineIk[kSfeSTP3593LFNumDisciplineStates]{16.0 * kSfeSTP3593LFDefaultIk, 16.0 * kSfeSTP3593LFDefaultIk, kSfeSTP3593LFDefaultIk, kSfeSTP3593LFDefaultIk / 16.0, kSfeSTP3593LFDefaultIk}; // The Ik for each discipline state
+
+    double _freqControlResolution{kSfeSTP3593LFFreqControlResolution}; // The resolution used by the loop. kSfeSTP3593LFFreqControlResolution unless estimated
+#endif
+    int32_t _maxChangeLSBs{(400 * 1000000) / kSfeSTP3593LFFreqControlResolutionE15}; // The maximum frequency change converted to LSBs
+    int32_t _lsbsPerPicosecondQ16{((65536 * 1000) + (kSfeSTP3593LFFreqControlResolutionE15 / 2)) / kSfeSTP3593LFFreqControlResolutionE15}; // Control word LSBs per picosecond of phase per epoch, Q16
+    int32_t _e15PerLSB{kSfeSTP3593LFFreqControlResolutionE15}; // Parts per 10^15 per control word LSB
+    int64_t _integralQ16{0}; // The integral term of setFrequencyByPhasePicoseconds, in LSBs, Q16
+    bool _integralQ16Initialized{false}; // true once _integralQ16 has been seeded from _frequencyControl
+    bool _errorFeedback{false}; // true if the rounding residual is carried into the next output
+    int32_t _quantizationResidualQ16{0}; // The remainder discarded by the most recent rounding, Q16
+    int64_t _referenceLinearQ16{0}; // The linearized word which gives zero frequency offset, Q16
+    bool _referenceValid{false}; // true once _referenceLinearQ16 has been seeded
+
+    bool _steering{false}; // true while phase steering is running
+    int64_t _steerBaseLinearQ16{0}; // The linearized word when steering started - restored at the end
+    int64_t _steerTotalQ16{0}; // The phase to steer out, in LSB-epochs, Q16
+    int64_t _steerAppliedQ16{0}; // The phase steered out so far, in LSB-epochs, Q16
+    uint32_t _steerEpochs{0}; // The planned duration in epochs
+    uint32_t _steerEpoch{0}; // The epochs completed so far
+    uint32_t _steerWrites{0}; // The writes made by the steering
+    sfeSTP3593LFSteeringResult_t _steerResult{kSfeSTP3593LFSteeringNone}; // The outcome of the last steering
+
+    uint32_t _ticTickPicoseconds{1}; // The duration of one TIC capture count in picoseconds
+    uint32_t _ticCountMask{0xFFFFFFFF}; // 2^counterBits - 1
+    uint32_t _ticCountsPerEpoch{0}; // The nominal count increment per epoch
+    uint32_t _ticReferenceCount{0}; // The capture count which corresponds to zero phase
+    uint32_t _ticLastCount{0}; // The previous capture count
+    int64_t _ticPhasePicoseconds{0}; // The unwrapped phase in picoseconds
+    bool _ticInitialized{false}; // true once the first capture has been seen
+
+    SfeSTP3593LFSPSCQueue<sfeSTP3593LFSample_t, SFE_STP3593LF_SAMPLE_QUEUE_CAPACITY> _sampleQueue; // PPS samples for serviceDiscipline
+    int32_t _queuePkQ16{kSfeSTP3593LFDefaultPkQ16}; // The gains serviceDiscipline uses for TIC and phase samples
+    int32_t _queueIkQ16{kSfeSTP3593LFDefaultIkQ16};
+    uint32_t _sampleMaxLatency{0}; // The longest queue-to-write latency (micros)
+    uint32_t _sampleWriteFailures{0}; // The number of queued samples whose write failed
+    bool _useSampleTimestamps{false}; // true if serviceDiscipline applies the time step between queued samples
+
+    uint32_t _timeStepMicros{kSfeSTP3593LFNominalTimeStepMicros}; // The time step of the loop update in progress
+    uint32_t _lastTimeStepMicros{kSfeSTP3593LFNominalTimeStepMicros}; // The time step of the most recent timed... call
+    uint32_t _maxTimeStepMicros{kSfeSTP3593LFDefaultMaxTimeStepMicros}; // Longer time steps are limited to this
+    uint32_t _lastTimestampMicros{0}; // The timestamp of the previous timed sample
+    bool _timestampValid{false}; // true once a timed sample has been seen
+    uint32_t _timeStepRejections{0}; // The number of timed samples dropped for a non-increasing timestamp
+    uint32_t _timeStepGaps{0}; // The number of timed samples whose time step was limited
+#if defined(ARDUINO_ARCH_ESP32)
+    TaskHandle_t _disciplineTask{nullptr}; // The discipline task. nullptr if not started
+#endif
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+    double _temperature{0.0}; // The most recent temperature (degC)
+    double _temperatureReference{0.0}; // The temperature at which the feed-forward is zero (degC)
+    bool _temperatureValid{false}; // true once a temperature has been provided
+    bool _temperatureCompensation{false}; // true if the temperature feed-forward is applied
+    double _temperatureTheta[2]{0.0, 0.0}; // The estimator parameters: offset (LSBs), coefficient (LSBs/degC)
+    double _temperatureFeedForward{0.0}; // The feed-forward currently applied (LSBs)
+#endif
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    double _temperatureLambda{0.9999}; // The forgetting factor of the temperature estimator
+    double _temperatureModelOrigin{0.0}; // The word subtracted from the estimator target, for conditioning
+    bool _temperatureModelInitialized{false}; // true once _temperatureModelOrigin has been set
+    double _temperatureCovariance[4]{kSfeSTP3593LFRLSInitialCovariance, 0.0, 0.0, kSfeSTP3593LFRLSInitialCovariance}; // The estimator covariance: p00, p01, p10, p11
+
+    bool _resolutionFeedback{false}; // true if the estimated resolution is fed back into the loop
+    double _resolutionLambda{0.999}; // The forgetting factor of the resolution estimator
+    uint32_t _resolutionOriginWord{0}; // The word subtracted from the estimator regressor, for conditioning
+    uint32_t _resolutionLastWord{0}; // The word in effect during the previous epoch - the instrument
+    double _resolutionLastBias{0.0}; // The previous bias (millis)
+    uint32_t _resolutionSamples{0}; // The number of biases seen by the estimator
+    uint8_t _resolutionRejections{0}; // The number of consecutive outliers rejected
+    double _resolutionTheta[2]{0.0, 1.0}; // The estimator parameters: offset, resolution as a ratio of 8E-13
+    double _resolutionCovariance[4]{kSfeSTP3593LFRLSInitialCovariance, 0.0, 0.0, kSfeSTP3593LFRLSInitialCovariance}; // The estimator covariance: p00, p01, p10, p11
+    double _resolutionResidualVariance{0.0}; // Exponentially-weighted variance of the prediction error
+    uint8_t _resolutionPrimeEpochs{0}; // The number of epochs to re-prime the estimator for, after a restore
+
+    double _pullRangeLambda{0.9995}; // The forgetting factor of the pull-range estimator (per hour)
+    uint32_t _pullRangeOriginWord{0}; // The word subtracted from the estimator target, for conditioning
+    uint32_t _pullRangeHours{0}; // The number of hours seen by the estimator - its time axis
+    uint32_t _pullRangeSamples{0}; // The number of samples in the hour in progress
+    uint32_t _pullRangeMicros{0}; // The time covered by the hour in progress
+    double _pullRangeSumWord{0.0}; // The sum of the words (less the origin) in the hour in progress
+    double _pullRangeTheta[2]{0.0, 0.0}; // The estimator parameters: word at the origin (LSBs), trend (LSBs/day)
+    double _pullRangeCovariance[4]{kSfeSTP3593LFRLSInitialCovariance, 0.0, 0.0, kSfeSTP3593LFRLSInitialCovariance}; // The estimator covariance: p00, p01, p10, p11
+    double _pullRangeResidualVariance{0.0}; // Exponentially-weighted variance of the hourly prediction error
+    double _pullRangeWarningDays{365.0}; // The warning threshold
+    bool _pullRangeWarning{false}; // true once the earliest time to a rail has fallen below the threshold
+#endif
+
+    const sfeSTP3593LFCalPoint_t *_calTable{nullptr}; // The calibration table in use. nullptr if none
+    uint8_t _calPoints{0}; // The number of points in _calTable
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+    SfeSTP3593LFAggregator *_aggregator{nullptr}; // The running statistics. nullptr if not aggregating
+    sfeSTP3593LFCalPoint_t *_sweepTable{nullptr}; // The table being filled by the calibration sweep. nullptr if not running
+    uint8_t _sweepPoints{0}; // The number of points in the sweep
+    uint8_t _sweepIndex{0}; // The point being measured
+    uint32_t _sweepFirstWord{0}; // The first control word of the sweep
+    uint32_t _sweepLastWord{0}; // The last control word of the sweep
+    uint16_t _sweepDwellEpochs{0}; // The number of epochs to measure at each point
+    uint16_t _sweepSettleEpochs{0}; // The number of epochs to wait after each step
+    uint16_t _sweepEpoch{0}; // The epoch within the current point
+    uint32_t _sweepSavedWord{0}; // The control word to restore at the end of the sweep
+    sfeSTP3593LFSweepResult_t _sweepResult{kSfeSTP3593LFSweepNone}; // The outcome of the last sweep
+    double _sweepFirstBias{0.0}; // The first bias measured at this point (millis) - subtracted for precision
+    double _sweepSumT{0.0}; // Linear regression sums of bias against epoch
+    double _sweepSumB{0.0};
+    double _sweepSumTT{0.0};
+    double _sweepSumTB{0.0};
+    double _sweepFirstFrequency{0.0}; // The fractional frequency at the first point
+#endif
+#endif // SFE_STP3593LF_ENABLE_PI_LOOP
 
-    uint32_t _frequencyControl; // Local store for the frequency control word. 20-Bit
-    double _maxFrequencyChangePPB; // The maximum frequency change in PPB for setFrequencyByBiasMillis
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+    SfeSTP3593LFRecorder *_recorder{nullptr}; // The recorder. nullptr if not recording
+#endif
 };
 
 class SfeSTP3593LFArdI2C : public SfeSTP3593LFDriver
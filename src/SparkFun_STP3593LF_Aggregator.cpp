@@ -0,0 +1,248 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_Aggregator.cpp
+
+    Description:
+    Fixed-memory running statistics of the frequency control word and the loop
+    input - per minute, per hour and per day.
+
+*/
+
+#include "SparkFun_STP3593LF_Aggregator.h"
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+
+// The length of each resolution's interval in seconds
+static const uint32_t kIntervalSeconds[kSfeSTP3593LFNumResolutions] = {60, 3600, 86400};
+
+// The size of each resolution's ring
+static const uint8_t kRingSize[kSfeSTP3593LFNumResolutions] = {SFE_STP3593LF_MINUTE_AGGREGATES, SFE_STP3593LF_HOUR_AGGREGATES,
+                                                                SFE_STP3593LF_DAY_AGGREGATES};
+
+/// @brief Discard every sample and every completed interval
+void SfeSTP3593LFAggregator::reset(void)
+{
+    for (uint8_t r = 0; r < kSfeSTP3593LFNumResolutions; r++)
+    {
+        for (uint8_t s = 0; s < kSfeSTP3593LFNumSeries; s++)
+            _open[r][s].count = 0;
+        _openSeconds[r] = 0;
+        _head[r] = 0;
+        _filled[r] = 0;
+    }
+    _samples = 0;
+    _seconds = 0;
+    _micros = 0;
+}
+
+/// @brief Add one loop step
+/// @param word the frequency control word after the step
+/// @param inputNanos the loop input in nanoseconds
+/// @param timeStepMicros the time the step covers in microseconds
+void SfeSTP3593LFAggregator::addSample(uint32_t word, double inputNanos, uint32_t timeStepMicros)
+{
+    // The sample belongs to the step which has just ended: add it, then move the time on
+    for (uint8_t r = 0; r < kSfeSTP3593LFNumResolutions; r++)
+    {
+        accumulate(_open[r][kSfeSTP3593LFSeriesWord], (double)word);
+        accumulate(_open[r][kSfeSTP3593LFSeriesInput], inputNanos);
+    }
+    _samples++;
+
+    _micros += timeStepMicros;
+    uint32_t seconds = _micros / 1000000;
+    _micros -= seconds * 1000000;
+    _seconds += seconds;
+
+    for (uint8_t r = 0; r < kSfeSTP3593LFNumResolutions; r++)
+    {
+        _openSeconds[r] += seconds;
+        if (_openSeconds[r] >= kIntervalSeconds[r])
+            closeInterval(r);
+    }
+}
+
+/// @brief Get the statistics of one interval
+/// @param series kSfeSTP3593LFSeriesWord or kSfeSTP3593LFSeriesInput
+/// @param resolution kSfeSTP3593LFPerMinute, kSfeSTP3593LFPerHour or kSfeSTP3593LFPerDay
+/// @param age 0 for the interval in progress, 1 for the most recent completed interval...
+/// @param aggregate returns the statistics
+/// @return true if the interval exists
+bool SfeSTP3593LFAggregator::getAggregate(sfeSTP3593LFSeries_t series, sfeSTP3593LFResolution_t resolution, uint8_t age,
+                                          sfeSTP3593LFAggregate_t &aggregate)
+{
+    if ((series >= kSfeSTP3593LFNumSeries) || (resolution >= kSfeSTP3593LFNumResolutions))
+        return false;
+
+    if (age == 0)
+    {
+        const sfeSTP3593LFWelford_t &open = _open[resolution][series];
+        aggregate.count = open.count;
+        aggregate.mean = open.count > 0 ? open.mean : 0.0;
+        aggregate.min = open.count > 0 ? (float)open.min : 0.0f;
+        aggregate.max = open.count > 0 ? (float)open.max : 0.0f;
+        aggregate.variance = open.count > 1 ? (float)(open.m2 / (double)(open.count - 1)) : 0.0f;
+        return true;
+    }
+
+    if (age > _filled[resolution])
+        return false;
+    aggregate = getCompleted(series, resolution, age);
+    return true;
+}
+
+/// @brief Get the statistics of several completed intervals combined
+/// @param series kSfeSTP3593LFSeriesWord or kSfeSTP3593LFSeriesInput
+/// @param resolution kSfeSTP3593LFPerMinute, kSfeSTP3593LFPerHour or kSfeSTP3593LFPerDay
+/// @param intervals the number of most recent completed intervals to combine
+/// @param aggregate returns the statistics
+/// @return true if at least one interval was combined
+bool SfeSTP3593LFAggregator::getSummary(sfeSTP3593LFSeries_t series, sfeSTP3593LFResolution_t resolution, uint8_t intervals,
+                                        sfeSTP3593LFAggregate_t &aggregate)
+{
+    if ((series >= kSfeSTP3593LFNumSeries) || (resolution >= kSfeSTP3593LFNumResolutions))
+        return false;
+    if (intervals > _filled[resolution])
+        intervals = _filled[resolution];
+
+    // Combine the intervals pairwise (Chan et al.): the result is the same as one pass over every sample
+    uint32_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    float min = 0.0f;
+    float max = 0.0f;
+    for (uint8_t age = 1; age <= intervals; age++)
+    {
+        const sfeSTP3593LFAggregate_t &interval = getCompleted(series, resolution, age);
+        if (interval.count == 0)
+            continue;
+        if (count == 0)
+        {
+            min = interval.min;
+            max = interval.max;
+        }
+        if (interval.min < min)
+            min = interval.min;
+        if (interval.max > max)
+            max = interval.max;
+
+        double total = (double)count + (double)interval.count;
+        double delta = interval.mean - mean;
+        mean += delta * (double)interval.count / total;
+        m2 += ((double)interval.variance * (double)(interval.count - 1)) + (delta * delta * (double)count * (double)interval.count / total);
+        count += interval.count;
+    }
+
+    if (count == 0)
+        return false;
+    aggregate.count = count;
+    aggregate.mean = mean;
+    aggregate.min = min;
+    aggregate.max = max;
+    aggregate.variance = count > 1 ? (float)(m2 / (double)(count - 1)) : 0.0f;
+    return true;
+}
+
+/// @brief Get the number of completed intervals held
+/// @param resolution kSfeSTP3593LFPerMinute, kSfeSTP3593LFPerHour or kSfeSTP3593LFPerDay
+/// @return The number of completed intervals held
+uint8_t SfeSTP3593LFAggregator::getAggregateCount(sfeSTP3593LFResolution_t resolution)
+{
+    if (resolution >= kSfeSTP3593LFNumResolutions)
+        return 0;
+    return _filled[resolution];
+}
+
+/// @brief Get the number of samples added since reset
+/// @return The number of samples
+uint32_t SfeSTP3593LFAggregator::getSampleCount(void)
+{
+    return _samples;
+}
+
+/// @brief Get the time covered by the samples since reset
+/// @return The time in seconds
+uint32_t SfeSTP3593LFAggregator::getElapsedSeconds(void)
+{
+    return _seconds;
+}
+
+/// @brief  PRIVATE: add a sample to an accumulator
+/// @param  accumulator the accumulator
+/// @param  value the sample
+void SfeSTP3593LFAggregator::accumulate(sfeSTP3593LFWelford_t &accumulator, double value)
+{
+    if (accumulator.count == 0)
+    {
+        accumulator.count = 1;
+        accumulator.min = value;
+        accumulator.max = value;
+        accumulator.mean = value;
+        accumulator.m2 = 0.0;
+        return;
+    }
+
+    accumulator.count++;
+    if (value < accumulator.min)
+        accumulator.min = value;
+    if (value > accumulator.max)
+        accumulator.max = value;
+    double delta = value - accumulator.mean;
+    accumulator.mean += delta / (double)accumulator.count;
+    accumulator.m2 += delta * (value - accumulator.mean);
+}
+
+/// @brief  PRIVATE: push the interval in progress into its ring and start the next
+/// @param  resolution the resolution
+void SfeSTP3593LFAggregator::closeInterval(uint8_t resolution)
+{
+    sfeSTP3593LFAggregate_t *ring;
+    if (resolution == kSfeSTP3593LFPerMinute)
+        ring = _minutes[_head[resolution]];
+    else if (resolution == kSfeSTP3593LFPerHour)
+        ring = _hours[_head[resolution]];
+    else
+        ring = _days[_head[resolution]];
+
+    for (uint8_t s = 0; s < kSfeSTP3593LFNumSeries; s++)
+    {
+        getAggregate((sfeSTP3593LFSeries_t)s, (sfeSTP3593LFResolution_t)resolution, 0, ring[s]);
+        _open[resolution][s].count = 0;
+    }
+
+    _head[resolution]++;
+    if (_head[resolution] >= kRingSize[resolution])
+        _head[resolution] = 0;
+    if (_filled[resolution] < kRingSize[resolution])
+        _filled[resolution]++;
+
+    // Stay aligned to the first sample. A gap longer than an interval restarts the alignment
+    _openSeconds[resolution] -= kIntervalSeconds[resolution];
+    if (_openSeconds[resolution] >= kIntervalSeconds[resolution])
+        _openSeconds[resolution] = 0;
+}
+
+/// @brief  PRIVATE: get a completed interval from a ring
+/// @param  series the series
+/// @param  resolution the resolution
+/// @param  age 1 for the most recent
+/// @return The interval
+const sfeSTP3593LFAggregate_t &SfeSTP3593LFAggregator::getCompleted(uint8_t series, uint8_t resolution, uint8_t age)
+{
+    uint16_t index = ((uint16_t)_head[resolution] + (uint16_t)kRingSize[resolution] - (uint16_t)age) % kRingSize[resolution];
+    if (resolution == kSfeSTP3593LFPerMinute)
+        return _minutes[index][series];
+    else if (resolution == kSfeSTP3593LFPerHour)
+        return _hours[index][series];
+    return _days[index][series];
+}
+
+#endif // SFE_STP3593LF_ENABLE_STATISTICS
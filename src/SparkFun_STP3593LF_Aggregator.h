@@ -0,0 +1,163 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_Aggregator.h
+
+    Description:
+    Fixed-memory running statistics of the frequency control word and the loop
+    input - per minute, per hour and per day - for watching the long-term
+    behavior of a disciplined oscillator without storing every sample.
+
+    SfeSTP3593LFAggregator keeps two series:
+      kSfeSTP3593LFSeriesWord  : the frequency control word after each loop step
+      kSfeSTP3593LFSeriesInput : the loop input in nanoseconds - the bias
+                                 (setFrequencyByBiasMillis) or the phase
+                                 (setFrequencyByPhasePicoseconds)
+
+    Each sample updates the count, min, max, mean and variance (Welford) of the
+    minute, the hour and the day in progress. When one ends, it is pushed into
+    a ring of completed intervals: SFE_STP3593LF_MINUTE_AGGREGATES minutes,
+    SFE_STP3593LF_HOUR_AGGREGATES hours and SFE_STP3593LF_DAY_AGGREGATES days.
+    An update costs a few microseconds; so does any query.
+
+    Time is the sum of the loop time steps (one second, or the step measured by
+    the timed... calls) - not millis - so a simulation or a replay aggregates
+    exactly as the live loop did. Intervals are aligned to the first sample.
+
+    Attach it with SfeSTP3593LFDriver::setAggregator. Or feed it directly with
+    addSample.
+
+*/
+
+#pragma once
+
+#include "SparkFun_STP3593LF.h"
+
+#if SFE_STP3593LF_ENABLE_STATISTICS
+
+///////////////////////////////////////////////////////////////////////////////
+
+// The series
+typedef enum
+{
+    kSfeSTP3593LFSeriesWord = 0, // The frequency control word (LSBs)
+    kSfeSTP3593LFSeriesInput, // The loop input: bias or phase (nanoseconds)
+    kSfeSTP3593LFNumSeries
+} sfeSTP3593LFSeries_t;
+
+// The resolutions
+typedef enum
+{
+    kSfeSTP3593LFPerMinute = 0,
+    kSfeSTP3593LFPerHour,
+    kSfeSTP3593LFPerDay,
+    kSfeSTP3593LFNumResolutions
+} sfeSTP3593LFResolution_t;
+
+// The statistics of one series over one interval
+typedef struct
+{
+    double mean; // The mean
+    uint32_t count; // The number of samples. 0 if the interval is empty
+    float min; // The smallest sample
+    float max; // The largest sample
+    float variance; // The sample variance. 0 with fewer than two samples
+} sfeSTP3593LFAggregate_t;
+
+///////////////////////////////////////////////////////////////////////////////
+
+class SfeSTP3593LFAggregator
+{
+public:
+    SfeSTP3593LFAggregator()
+    {
+        reset();
+    }
+
+    /// @brief Discard every sample and every completed interval
+    void reset(void);
+
+    /// @brief Add one loop step. Called by the driver once per setFrequencyBy... if attached
+    /// @param word the frequency control word after the step
+    /// @param inputNanos the loop input in nanoseconds
+    /// @param timeStepMicros the time the step covers in microseconds
+    void addSample(uint32_t word, double inputNanos, uint32_t timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros);
+
+    /// @brief Get the statistics of one interval
+    /// @param series kSfeSTP3593LFSeriesWord or kSfeSTP3593LFSeriesInput
+    /// @param resolution kSfeSTP3593LFPerMinute, kSfeSTP3593LFPerHour or kSfeSTP3593LFPerDay
+    /// @param age 0 for the interval in progress, 1 for the most recent completed interval, 2 for the one before...
+    /// @param aggregate returns the statistics
+    /// @return true if the interval exists. false if it is older than the ring holds - or has not happened yet
+    bool getAggregate(sfeSTP3593LFSeries_t series, sfeSTP3593LFResolution_t resolution, uint8_t age, sfeSTP3593LFAggregate_t &aggregate);
+
+    /// @brief Get the statistics of several completed intervals combined - e.g. the last 6 hours
+    /// @param series kSfeSTP3593LFSeriesWord or kSfeSTP3593LFSeriesInput
+    /// @param resolution kSfeSTP3593LFPerMinute, kSfeSTP3593LFPerHour or kSfeSTP3593LFPerDay
+    /// @param intervals the number of most recent completed intervals to combine
+    /// @param aggregate returns the statistics
+    /// @return true if at least one interval was combined. Fewer than requested are combined if the ring holds fewer
+    bool getSummary(sfeSTP3593LFSeries_t series, sfeSTP3593LFResolution_t resolution, uint8_t intervals, sfeSTP3593LFAggregate_t &aggregate);
+
+    /// @brief Get the number of completed intervals held
+    /// @param resolution kSfeSTP3593LFPerMinute, kSfeSTP3593LFPerHour or kSfeSTP3593LFPerDay
+    /// @return The number of completed intervals held - up to the ring size
+    uint8_t getAggregateCount(sfeSTP3593LFResolution_t resolution);
+
+    /// @brief Get the number of samples added since reset
+    /// @return The number of samples
+    uint32_t getSampleCount(void);
+
+    /// @brief Get the time covered by the samples since reset
+    /// @return The time in seconds
+    uint32_t getElapsedSeconds(void);
+
+private:
+    // A running (Welford) accumulator
+    typedef struct
+    {
+        uint32_t count;
+        double min;
+        double max;
+        double mean;
+        double m2; // The sum of squared differences from the mean
+    } sfeSTP3593LFWelford_t;
+
+    /// @brief Add a sample to an accumulator
+    /// @param accumulator the accumulator
+    /// @param value the sample
+    void accumulate(sfeSTP3593LFWelford_t &accumulator, double value);
+
+    /// @brief Push the interval in progress into its ring and start the next
+    /// @param resolution the resolution
+    void closeInterval(uint8_t resolution);
+
+    /// @brief Get a completed interval from a ring
+    /// @param series the series
+    /// @param resolution the resolution
+    /// @param age 1 for the most recent
+    /// @return The interval
+    const sfeSTP3593LFAggregate_t &getCompleted(uint8_t series, uint8_t resolution, uint8_t age);
+
+    sfeSTP3593LFWelford_t _open[kSfeSTP3593LFNumResolutions][kSfeSTP3593LFNumSeries]; // The intervals in progress
+    uint32_t _openSeconds[kSfeSTP3593LFNumResolutions]; // The time covered by each interval in progress
+
+    sfeSTP3593LFAggregate_t _minutes[SFE_STP3593LF_MINUTE_AGGREGATES][kSfeSTP3593LFNumSeries]; // The completed intervals
+    sfeSTP3593LFAggregate_t _hours[SFE_STP3593LF_HOUR_AGGREGATES][kSfeSTP3593LFNumSeries];
+    sfeSTP3593LFAggregate_t _days[SFE_STP3593LF_DAY_AGGREGATES][kSfeSTP3593LFNumSeries];
+    uint8_t _head[kSfeSTP3593LFNumResolutions]; // Where each ring's next interval goes
+    uint8_t _filled[kSfeSTP3593LFNumResolutions]; // The number of completed intervals in each ring
+
+    uint32_t _samples; // The number of samples since reset
+    uint32_t _seconds; // The time covered since reset
+    uint32_t _micros; // The part-second not yet counted in _seconds
+};
+
+#endif // SFE_STP3593LF_ENABLE_STATISTICS
@@ -0,0 +1,518 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_BusScheduler.h
+
+    Description:
+    Arbitration for an I2C bus shared by the STP3593LF and other peripherals.
+
+    SfeSTP3593LFBusScheduler grants the bus one transaction at a time. Each
+    client has a priority (higher is more urgent) and may reserve the bus with a
+    deadline - the latest time its next transaction must start, e.g. a few
+    milliseconds after the PPS edge. A client is held back while:
+      - another client owns the bus
+      - a client with a higher priority is waiting for it
+      - its transaction would still be running when a higher-priority
+        reservation falls due
+    so a time-critical DAC write is never stuck behind a long sensor read.
+
+    The scheduler can only arbitrate the clients which use it. Every transaction
+    on the shared port - from this library or any other - must be bracketed by
+    acquire / release (or tryAcquire / release):
+
+      if (myScheduler.tryAcquire(sensorClient, 4000)) // A 4ms read
+      {
+          mySensor.read();
+          myScheduler.release(sensorClient);
+      }
+
+    SfeSTP3593LFScheduledArdI2C is the STP3593LF driver on a scheduled port:
+    each of its transactions is acquired and released automatically.
+
+    Platforms: on ESP32 a waiting task sleeps on its own semaphore and is woken
+    by release; the decisions are made in a portMUX critical section, so clients
+    may run on either core. On host builds a std::mutex is used. Other Arduino
+    boards are single-threaded and need no lock - there, nothing can release the
+    bus while a client waits, so acquire does not wait: like tryAcquire, it fails
+    at once if the bus cannot be granted. tryAcquire is the useful call: it defers
+    a long transaction which would delay a reservation.
+    setDeadline is lock-free and ISR-safe. No other call is ISR-safe.
+
+*/
+
+#pragma once
+
+#include "SparkFun_STP3593LF.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#elif !defined(ARDUINO)
+#include <mutex>
+#include <thread>
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32) || !defined(ARDUINO)
+#define SFE_STP3593LF_HAVE_BUS_WAIT 1 // Another task can release the bus while acquire waits
+#else
+#define SFE_STP3593LF_HAVE_BUS_WAIT 0
+#endif
+
+const uint8_t kSfeSTP3593LFMaxBusClients = 8; // The maximum number of clients per scheduler
+const uint8_t kSfeSTP3593LFNoBusClient = 0xFF; // addClient returns this when the scheduler is full
+const uint32_t kSfeSTP3593LFDefaultTransactionMicros = 1000; // A 0x41 read at 100kHz, with margin
+const uint32_t kSfeSTP3593LFDefaultReservationGraceMicros = 10000; // How long a missed reservation still holds the bus
+
+// The statistics for one client
+typedef struct
+{
+    uint32_t grants; // The number of transactions granted
+    uint32_t deferrals; // The number of times the client was held back
+    uint32_t deadlineMisses; // The number of reserved transactions which started after their deadline
+    uint32_t timeouts; // The number of acquires which timed out - or failed at once, without SFE_STP3593LF_HAVE_BUS_WAIT
+    uint32_t maxWaitMicros; // The longest wait for the bus
+    uint32_t maxHoldMicros; // The longest time the client held the bus
+} sfeSTP3593LFBusClientStats_t;
+
+///////////////////////////////////////////////////////////////////////////////
+
+class SfeSTP3593LFBusScheduler
+{
+public:
+    SfeSTP3593LFBusScheduler() : _numClients{0}, _owner{kSfeSTP3593LFNoBusClient}, _graceMicros{kSfeSTP3593LFDefaultReservationGraceMicros}
+    {
+    }
+
+    /// @brief Add a client. Call before the clients start to run
+    /// @param priority the client priority. Higher is more urgent
+    /// @return The client number. kSfeSTP3593LFNoBusClient if the scheduler is full
+    uint8_t addClient(uint8_t priority)
+    {
+        if (_numClients >= kSfeSTP3593LFMaxBusClients)
+            return kSfeSTP3593LFNoBusClient;
+
+        uint8_t client = _numClients;
+        memset(&_clients[client], 0, sizeof(_clients[client]));
+        _clients[client].priority = priority;
+#if defined(ARDUINO_ARCH_ESP32)
+        _clients[client].wakeup = xSemaphoreCreateBinaryStatic(&_clients[client].wakeupBuffer);
+#endif
+        _numClients++;
+        return client;
+    }
+
+    /// @brief Reserve the bus: the client's next transaction must start by deadlineMicros. Lock-free and ISR-safe
+    /// @param client the client number
+    /// @param deadlineMicros the deadline - a micros() value, within the next 35 minutes
+    /// Note: the reservation is consumed by the client's next acquire. If the client is late, lower-priority
+    ///       clients are held back until it arrives - or until the grace period after the deadline expires
+    void setDeadline(uint8_t client, uint32_t deadlineMicros)
+    {
+        if (client >= _numClients)
+            return;
+        __atomic_store_n(&_clients[client].deadline, deadlineMicros, __ATOMIC_RELAXED);
+        __atomic_store_n(&_clients[client].reserved, (uint8_t)1, __ATOMIC_RELEASE);
+    }
+
+    /// @brief Cancel a reservation
+    /// @param client the client number
+    void clearDeadline(uint8_t client)
+    {
+        if (client >= _numClients)
+            return;
+        __atomic_store_n(&_clients[client].reserved, (uint8_t)0, __ATOMIC_RELEASE);
+    }
+
+    /// @brief Set how long a reservation still holds the bus after its deadline has passed
+    /// @param graceMicros the grace period in microseconds. Default: 10000
+    void setReservationGraceMicros(uint32_t graceMicros)
+    {
+        enterCritical();
+        _graceMicros = graceMicros;
+        exitCritical();
+    }
+
+    /// @brief Acquire the bus if it can be granted now. Does not wait
+    /// @param client the client number
+    /// @param durationMicros the expected length of the transaction. 0 uses the longest seen so far
+    /// @return true if the bus was granted. Call release when the transaction is complete
+    bool tryAcquire(uint8_t client, uint32_t durationMicros = 0)
+    {
+        if (client >= _numClients)
+            return false;
+
+        enterCritical();
+        bool granted = grant(client, durationMicros, micros());
+        if (!granted)
+            _clients[client].stats.deferrals++;
+        exitCritical();
+
+        return granted;
+    }
+
+    /// @brief Acquire the bus, waiting until it is granted or the timeout expires
+    /// @param client the client number
+    /// @param durationMicros the expected length of the transaction. 0 uses the longest seen so far
+    /// @param timeoutMicros the longest time to wait. Ignored on single-threaded boards: acquire does not wait
+    /// @return true if the bus was granted. Call release when the transaction is complete
+    bool acquire(uint8_t client, uint32_t durationMicros = 0, uint32_t timeoutMicros = 100000)
+    {
+        if (client >= _numClients)
+            return false;
+
+#if !SFE_STP3593LF_HAVE_BUS_WAIT
+        timeoutMicros = 0; // Nothing can release the bus while this client waits. Fail at once
+#endif
+
+        uint32_t start = micros();
+        bool deferred = false;
+
+        enterCritical();
+        _clients[client].waiting = true;
+        _clients[client].waitStart = start;
+        while (!grant(client, durationMicros, micros()))
+        {
+            if (!deferred)
+                _clients[client].stats.deferrals++;
+            deferred = true;
+
+            if ((micros() - start) >= timeoutMicros)
+            {
+                _clients[client].waiting = false;
+                _clients[client].stats.timeouts++;
+                exitCritical();
+                wakeNext(); // A lower-priority client may have been waiting for this one
+                return false;
+            }
+
+            exitCritical();
+            wait(client);
+            enterCritical();
+        }
+        exitCritical();
+
+        return true;
+    }
+
+    /// @brief Release the bus and wake the next client
+    /// @param client the client number. Must be the owner
+    void release(uint8_t client)
+    {
+        if (client >= _numClients)
+            return;
+
+        enterCritical();
+        if (_owner == client)
+        {
+            uint32_t held = micros() - _grantTime;
+            if (held > _clients[client].stats.maxHoldMicros)
+                _clients[client].stats.maxHoldMicros = held;
+            _owner = kSfeSTP3593LFNoBusClient;
+        }
+        exitCritical();
+
+        wakeNext();
+    }
+
+    /// @brief Get the statistics for a client
+    /// @param client the client number
+    /// @param stats returns the statistics
+    /// @return true if the client exists
+    bool getClientStats(uint8_t client, sfeSTP3593LFBusClientStats_t &stats)
+    {
+        if (client >= _numClients)
+            return false;
+
+        enterCritical();
+        stats = _clients[client].stats;
+        exitCritical();
+
+        return true;
+    }
+
+    /// @brief Reset the statistics for every client
+    void resetStats(void)
+    {
+        enterCritical();
+        for (uint8_t i = 0; i < _numClients; i++)
+            memset(&_clients[i].stats, 0, sizeof(_clients[i].stats));
+        exitCritical();
+    }
+
+private:
+    /// @brief Grant the bus to client if the rules allow it. Called in the critical section
+    /// @param client the client number
+    /// @param durationMicros the expected length of the transaction. 0 uses the longest seen so far
+    /// @param now micros()
+    /// @return true if the bus was granted
+    bool grant(uint8_t client, uint32_t durationMicros, uint32_t now)
+    {
+        if (_owner != kSfeSTP3593LFNoBusClient)
+            return false;
+
+        if (durationMicros == 0)
+            durationMicros = _clients[client].stats.maxHoldMicros;
+
+        for (uint8_t i = 0; i < _numClients; i++)
+        {
+            if ((i == client) || (_clients[i].priority <= _clients[client].priority))
+                continue;
+
+            if (_clients[i].waiting)
+                return false; // A more urgent client is waiting
+
+            if (__atomic_load_n(&_clients[i].reserved, __ATOMIC_ACQUIRE))
+            {
+                int32_t untilDeadline = (int32_t)(__atomic_load_n(&_clients[i].deadline, __ATOMIC_RELAXED) - now);
+                if (untilDeadline < 0)
+                {
+                    if ((uint32_t)(0 - untilDeadline) > _graceMicros)
+                        continue; // The reservation has lapsed
+                    return false; // The reserving client is late. Keep the bus clear for it
+                }
+                if (durationMicros > (uint32_t)untilDeadline)
+                    return false; // This transaction would still be running at the deadline
+            }
+        }
+
+        _owner = client;
+        _grantTime = now;
+
+        clientState &theClient = _clients[client];
+        if (__atomic_load_n(&theClient.reserved, __ATOMIC_ACQUIRE))
+        {
+            if ((int32_t)(now - __atomic_load_n(&theClient.deadline, __ATOMIC_RELAXED)) > 0)
+                theClient.stats.deadlineMisses++;
+            __atomic_store_n(&theClient.reserved, (uint8_t)0, __ATOMIC_RELEASE); // Consumed
+        }
+        if (theClient.waiting)
+        {
+            uint32_t waited = now - theClient.waitStart;
+            if (waited > theClient.stats.maxWaitMicros)
+                theClient.stats.maxWaitMicros = waited;
+            theClient.waiting = false;
+        }
+        theClient.stats.grants++;
+
+        return true;
+    }
+
+    /// @brief Wake the most urgent waiting client - if any
+    void wakeNext(void)
+    {
+#if defined(ARDUINO_ARCH_ESP32)
+        uint8_t next = kSfeSTP3593LFNoBusClient;
+        enterCritical();
+        for (uint8_t i = 0; i < _numClients; i++)
+        {
+            if (_clients[i].waiting && ((next == kSfeSTP3593LFNoBusClient) || (_clients[i].priority > _clients[next].priority)))
+                next = i;
+        }
+        exitCritical();
+        if (next != kSfeSTP3593LFNoBusClient)
+            xSemaphoreGive(_clients[next].wakeup);
+#endif
+    }
+
+    /// @brief Wait for the bus to be released - or for a reservation to lapse
+    /// @param client the client number
+    void wait(uint8_t client)
+    {
+#if defined(ARDUINO_ARCH_ESP32)
+        xSemaphoreTake(_clients[client].wakeup, 1); // At most one tick: reservations lapse without a release
+#elif !defined(ARDUINO)
+        (void)client;
+        std::this_thread::yield();
+#else
+        (void)client; // Not reached: acquire does not wait without SFE_STP3593LF_HAVE_BUS_WAIT
+#endif
+    }
+
+    void enterCritical(void)
+    {
+#if defined(ARDUINO_ARCH_ESP32)
+        portENTER_CRITICAL(&_mux);
+#elif !defined(ARDUINO)
+        _mutex.lock();
+#endif
+    }
+
+    void exitCritical(void)
+    {
+#if defined(ARDUINO_ARCH_ESP32)
+        portEXIT_CRITICAL(&_mux);
+#elif !defined(ARDUINO)
+        _mutex.unlock();
+#endif
+    }
+
+    struct clientState
+    {
+        uint8_t priority; // Higher is more urgent
+        volatile uint8_t reserved; // 1 if deadline is valid. Written by setDeadline (may be an ISR)
+        volatile uint32_t deadline; // The latest start time of the next transaction (micros)
+        bool waiting; // true while the client is in acquire
+        uint32_t waitStart; // micros() when the client started waiting
+        sfeSTP3593LFBusClientStats_t stats;
+#if defined(ARDUINO_ARCH_ESP32)
+        StaticSemaphore_t wakeupBuffer;
+        SemaphoreHandle_t wakeup; // Given by release
+#endif
+    };
+
+    clientState _clients[kSfeSTP3593LFMaxBusClients];
+    uint8_t _numClients; // The number of clients added
+    uint8_t _owner; // The client which owns the bus. kSfeSTP3593LFNoBusClient if it is free
+    uint32_t _grantTime{0}; // micros() when the bus was granted
+    uint32_t _graceMicros; // How long a missed reservation still holds the bus
+
+#if defined(ARDUINO_ARCH_ESP32)
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+#elif !defined(ARDUINO)
+    std::mutex _mutex;
+#endif
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// An sfeTkArdI2C which acquires the scheduler around each transaction on another sfeTkArdI2C
+class SfeSTP3593LFScheduledI2C : public sfeTkArdI2C
+{
+public:
+    SfeSTP3593LFScheduledI2C() : _theBus{nullptr}, _scheduler{nullptr}, _client{kSfeSTP3593LFNoBusClient}, _durationMicros{kSfeSTP3593LFDefaultTransactionMicros}
+    {
+    }
+
+    /// @brief Route the transactions through a scheduler
+    /// @param theBus the bus which makes the transactions
+    /// @param scheduler the scheduler
+    /// @param client the client number for these transactions
+    void configure(sfeTkArdI2C *theBus, SfeSTP3593LFBusScheduler *scheduler, uint8_t client)
+    {
+        _theBus = theBus;
+        _scheduler = scheduler;
+        _client = client;
+    }
+
+    /// @brief Set the expected length of one transaction
+    /// @param durationMicros the length in microseconds
+    void setTransactionMicros(uint32_t durationMicros)
+    {
+        _durationMicros = durationMicros;
+    }
+
+    sfeTkError_t ping()
+    {
+        if (!_scheduler->acquire(_client, _durationMicros))
+            return kSTkErrFail;
+        sfeTkError_t result = _theBus->ping();
+        _scheduler->release(_client);
+        return result;
+    }
+
+    sfeTkError_t writeByte(uint8_t data)
+    {
+        if (!_scheduler->acquire(_client, _durationMicros))
+            return kSTkErrFail;
+        sfeTkError_t result = _theBus->writeByte(data);
+        _scheduler->release(_client);
+        return result;
+    }
+
+    sfeTkError_t writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length)
+    {
+        if (!_scheduler->acquire(_client, _durationMicros))
+            return kSTkErrFail;
+        sfeTkError_t result = _theBus->writeRegisterRegion(devReg, data, length);
+        _scheduler->release(_client);
+        return result;
+    }
+
+    sfeTkError_t readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes)
+    {
+        if (!_scheduler->acquire(_client, _durationMicros))
+        {
+            readBytes = 0;
+            return kSTkErrFail;
+        }
+        sfeTkError_t result = _theBus->readRegisterRegion(devReg, data, numBytes, readBytes);
+        _scheduler->release(_client);
+        return result;
+    }
+
+private:
+    sfeTkArdI2C *_theBus; // The bus which makes the transactions
+    SfeSTP3593LFBusScheduler *_scheduler; // The scheduler
+    uint8_t _client; // The client number
+    uint32_t _durationMicros; // The expected length of one transaction
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class SfeSTP3593LFScheduledArdI2C : public SfeSTP3593LFDriver
+{
+public:
+    SfeSTP3593LFScheduledArdI2C() : _scheduler{nullptr}, _client{kSfeSTP3593LFNoBusClient}
+    {
+    }
+
+    /// @brief  Sets up Arduino I2C driver on a scheduled port then calls the super class begin.
+    /// @param  scheduler the scheduler for wirePort
+    /// @param  priority the client priority. Higher is more urgent
+    /// @param  wirePort the I2C port
+    /// @param  address the I2C address
+    /// @return True if successful, false otherwise.
+    bool begin(SfeSTP3593LFBusScheduler &scheduler, uint8_t priority, TwoWire &wirePort = Wire, const uint8_t &address = kDefaultSTP3593LFAddr)
+    {
+        if (_client == kSfeSTP3593LFNoBusClient)
+            _client = scheduler.addClient(priority);
+        if (_client == kSfeSTP3593LFNoBusClient)
+            return false;
+        _scheduler = &scheduler;
+
+        if (_theI2CBus.init(wirePort, address) != kSTkErrOk)
+            return false;
+
+        _theI2CBus.setStop(false); // Use restarts not stops for I2C reads
+
+        _theScheduledBus.configure(&_theI2CBus, &scheduler, _client);
+        setCommunicationBus(&_theScheduledBus);
+
+        return SfeSTP3593LFDriver::begin();
+    }
+
+    /// @brief Reserve the bus for the next transaction - e.g. from the PPS interrupt. ISR-safe
+    /// @param deadlineMicros the latest start time - a micros() value
+    void reserveBus(uint32_t deadlineMicros)
+    {
+        if (_scheduler != nullptr)
+            _scheduler->setDeadline(_client, deadlineMicros);
+    }
+
+    /// @brief Set the expected length of one transaction - the scheduler keeps other clients clear of it
+    /// @param durationMicros the length in microseconds. Default: 1000
+    void setTransactionMicros(uint32_t durationMicros)
+    {
+        _theScheduledBus.setTransactionMicros(durationMicros);
+    }
+
+    /// @brief Get the client number - e.g. for getClientStats
+    /// @return The client number
+    uint8_t getBusClient(void)
+    {
+        return _client;
+    }
+
+private:
+    sfeTkArdI2C _theI2CBus;
+    SfeSTP3593LFScheduledI2C _theScheduledBus;
+    SfeSTP3593LFBusScheduler *_scheduler;
+    uint8_t _client;
+};
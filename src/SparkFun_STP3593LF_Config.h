@@ -0,0 +1,93 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_Config.h
+
+    Description:
+    Compile-time feature selection for the STP3593LF library.
+
+    Each feature can be stripped from the build - to save flash and RAM on small
+    boards - by defining its switch as 0 for the whole build. Do not define them
+    in the sketch: the library .cpp files would not see them. Use e.g.:
+      arduino-cli: --build-property "compiler.cpp.extra_flags=-DSFE_STP3593LF_ENABLE_TELEMETRY=0"
+      PlatformIO : build_flags = -DSFE_STP3593LF_ENABLE_TELEMETRY=0
+    extras/footprint.sh reports the text / data / bss of each configuration.
+
+    SFE_STP3593LF_ENABLE_PI_LOOP      (1) The discipline loops, the calibration table and the TIC input.
+                                          0 leaves the register driver only
+    SFE_STP3593LF_FIXED_POINT         (0) 1 keeps only the integer-only loop (setFrequencyByPhasePicoseconds
+                                          and the TIC input). No floating-point code is linked
+    SFE_STP3593LF_ENABLE_STATISTICS   (1) The online estimators: the temperature coefficient, the frequency
+                                          control resolution, the calibration sweep and SfeSTP3593LFAggregator
+    SFE_STP3593LF_ENABLE_TELEMETRY    (1) The recorder hooks, SfeSTP3593LFRecorder and SfeSTP3593LFReplay
+    SFE_STP3593LF_ENABLE_VERIFICATION (1) Write read-back (setWriteVerification)
+    SFE_STP3593LF_ENABLE_DITHER       (1) Sub-LSB dithering of the control word (enableDither, serviceDither)
+
+    SFE_STP3593LF_SAMPLE_QUEUE_CAPACITY (8) The number of PPS samples the queue... calls can hold (2 - 128, a power of two)
+
+    SFE_STP3593LF_MINUTE_AGGREGATES (60) The number of completed minutes SfeSTP3593LFAggregator keeps (1 - 255)
+    SFE_STP3593LF_HOUR_AGGREGATES   (24) The number of completed hours it keeps (1 - 255)
+    SFE_STP3593LF_DAY_AGGREGATES     (7) The number of completed days it keeps (1 - 255)
+                                         Each costs 48 bytes of RAM (two series), and only if an aggregator is declared
+
+*/
+
+#pragma once
+
+#ifndef SFE_STP3593LF_ENABLE_PI_LOOP
+#define SFE_STP3593LF_ENABLE_PI_LOOP 1
+#endif
+
+#ifndef SFE_STP3593LF_FIXED_POINT
+#define SFE_STP3593LF_FIXED_POINT 0
+#endif
+
+#ifndef SFE_STP3593LF_ENABLE_STATISTICS
+#define SFE_STP3593LF_ENABLE_STATISTICS 1
+#endif
+
+#ifndef SFE_STP3593LF_ENABLE_TELEMETRY
+#define SFE_STP3593LF_ENABLE_TELEMETRY 1
+#endif
+
+#ifndef SFE_STP3593LF_ENABLE_VERIFICATION
+#define SFE_STP3593LF_ENABLE_VERIFICATION 1
+#endif
+
+#ifndef SFE_STP3593LF_ENABLE_DITHER
+#define SFE_STP3593LF_ENABLE_DITHER 1
+#endif
+
+#ifndef SFE_STP3593LF_SAMPLE_QUEUE_CAPACITY
+#define SFE_STP3593LF_SAMPLE_QUEUE_CAPACITY 8
+#endif
+
+#ifndef SFE_STP3593LF_MINUTE_AGGREGATES
+#define SFE_STP3593LF_MINUTE_AGGREGATES 60
+#endif
+
+#ifndef SFE_STP3593LF_HOUR_AGGREGATES
+#define SFE_STP3593LF_HOUR_AGGREGATES 24
+#endif
+
+#ifndef SFE_STP3593LF_DAY_AGGREGATES
+#define SFE_STP3593LF_DAY_AGGREGATES 7
+#endif
+
+// The estimators and the trace format are floating-point, and only make sense with the floating-point loop
+#if (!SFE_STP3593LF_ENABLE_PI_LOOP) || SFE_STP3593LF_FIXED_POINT
+#undef SFE_STP3593LF_ENABLE_STATISTICS
+#define SFE_STP3593LF_ENABLE_STATISTICS 0
+#undef SFE_STP3593LF_ENABLE_TELEMETRY
+#define SFE_STP3593LF_ENABLE_TELEMETRY 0
+#endif
+
+// The floating-point loop: setFrequencyByBiasMillis, the discipline state machine and the temperature feed-forward
+#define SFE_STP3593LF_FLOATING_POINT_LOOP (SFE_STP3593LF_ENABLE_PI_LOOP && (!SFE_STP3593LF_FIXED_POINT))
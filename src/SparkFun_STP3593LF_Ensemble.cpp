@@ -0,0 +1,338 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_Ensemble.cpp
+
+    Description:
+    An ensemble time scale across several STP3593LF oscillators.
+
+*/
+
+#include "SparkFun_STP3593LF_Ensemble.h"
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+
+/// @brief Add an oscillator to the ensemble
+/// @param driver the oscillator's driver
+/// @return true if added
+bool SfeSTP3593LFEnsemble::addMember(SfeSTP3593LFDriver &driver)
+{
+    if (_members >= kSfeSTP3593LFMaxEnsembleMembers)
+        return false;
+    if (!driver.readFrequencyControlWord())
+        return false;
+
+    sfeSTP3593LFEnsembleMember_t &member = _member[_members];
+    member.driver = &driver;
+    member.freeWord = driver.getFrequencyControlWord();
+    member.steeringPhase = 0.0;
+    member.measuredPhase = 0.0;
+    member.measured = false;
+    member.phase = 0.0;
+    member.frequency = 0.0;
+    member.variance = 0.0;
+    member.outputPhase = 0.0;
+    member.weight = 0.0;
+    member.predictions = 0;
+    member.initialized = false;
+    _members++;
+    return true;
+}
+
+/// @brief Get the number of members
+/// @return The number of members
+uint8_t SfeSTP3593LFEnsemble::getMemberCount(void)
+{
+    return _members;
+}
+
+/// @brief Provide one member's phase measurement for this epoch
+/// @param member the member index
+/// @param phase the phase of the member against the common reference, in picoseconds
+/// @return true if the member exists
+bool SfeSTP3593LFEnsemble::setMemberPhasePicoseconds(uint8_t member, int32_t phase)
+{
+    if (member >= _members)
+        return false;
+    _member[member].measuredPhase = (double)phase;
+    _member[member].measured = true;
+    return true;
+}
+
+/// @brief Run one epoch of the ensemble: compute the time scale and steer the members
+/// @return true if the ensemble time was computed and every steering write succeeded
+bool SfeSTP3593LFEnsemble::update(void)
+{
+    if (_members == 0)
+        return false;
+
+    // Remove the steering: the epoch which has just ended ran at each member's current word
+    for (uint8_t i = 0; i < _members; i++)
+    {
+        sfeSTP3593LFEnsembleMember_t &member = _member[i];
+        double picosPerLSB = member.driver->getFreqControlResolution() * 1.0e12; // For one epoch
+        member.steeringPhase += ((double)member.driver->getFrequencyControlWord() - (double)member.freeWord) * picosPerLSB;
+    }
+
+    if (!_initialized)
+    {
+        // Seed the ensemble time with the mean of the members measured
+        double sum = 0.0;
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < _members; i++)
+        {
+            if (_member[i].measured)
+            {
+                sum += _member[i].measuredPhase - _member[i].steeringPhase;
+                count++;
+            }
+        }
+        if (count == 0)
+            return false;
+        _ensemblePhase = sum / count;
+        _initialized = true;
+    }
+    else
+    {
+        // The ensemble time is the weighted mean of the members' readings of it: free-running phase minus
+        // the predicted phase relative to the ensemble. Weights are renormalized over the members measured
+        double sum = 0.0;
+        double sumWeights = 0.0;
+        double sumEqual = 0.0;
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < _members; i++)
+        {
+            sfeSTP3593LFEnsembleMember_t &member = _member[i];
+            if ((!member.measured) || (!member.initialized))
+                continue;
+            double reading = (member.measuredPhase - member.steeringPhase) - (member.phase + member.frequency);
+            sum += member.weight * reading;
+            sumWeights += member.weight;
+            sumEqual += reading;
+            count++;
+        }
+        if (count == 0)
+        {
+            // Nothing measured: every member coasts
+            for (uint8_t i = 0; i < _members; i++)
+            {
+                _member[i].phase += _member[i].frequency;
+                _member[i].measured = false;
+            }
+            return false;
+        }
+        if (sumWeights > 0.0)
+            _ensemblePhase = sum / sumWeights;
+        else
+            _ensemblePhase = sumEqual / count; // Only uncharacterized members were measured
+    }
+
+    // Update each member's phase, frequency and stability relative to the new ensemble time
+    for (uint8_t i = 0; i < _members; i++)
+    {
+        sfeSTP3593LFEnsembleMember_t &member = _member[i];
+        double predicted = member.phase + member.frequency;
+
+        if (!member.measured)
+        {
+            member.phase = predicted; // Coast
+            continue;
+        }
+
+        double phase = (member.measuredPhase - member.steeringPhase) - _ensemblePhase;
+        if (!member.initialized)
+        {
+            member.phase = phase;
+            member.initialized = true;
+            continue;
+        }
+
+        double error = phase - predicted;
+        member.predictions++;
+        uint32_t n = member.predictions < _stabilityTimeConstant ? member.predictions : _stabilityTimeConstant;
+        // A member is part of the ensemble it is measured against, so its error looks smaller than it is:
+        // by (1 - weight) for optimal weights. Correct for it - or the heaviest member takes all the weight
+        double visible = 1.0 - member.weight;
+        if (visible < 0.1)
+            visible = 0.1;
+        member.variance += (((error * error) / visible) - member.variance) / (double)n;
+        member.frequency += error / (double)(_frequencyTimeConstant + 1);
+        member.phase = phase;
+    }
+
+    updateWeights();
+
+    // Steer each member's output towards the ensemble time
+    bool result = true;
+    for (uint8_t i = 0; i < _members; i++)
+    {
+        sfeSTP3593LFEnsembleMember_t &member = _member[i];
+        if (!member.measured)
+            continue;
+        member.measured = false;
+
+        member.outputPhase = member.measuredPhase - _ensemblePhase;
+        if (!_steering)
+            continue;
+
+        double phase = member.outputPhase;
+        if (phase > 2147483647.0)
+            phase = 2147483647.0;
+        if (phase < -2147483648.0)
+            phase = -2147483648.0;
+        if (!member.driver->setFrequencyByPhasePicoseconds((int32_t)floor(phase + 0.5), _PkQ16, _IkQ16))
+            result = false;
+    }
+
+    return result;
+}
+
+/// @brief Enable or disable steering the members towards the ensemble time
+/// @param enable true to steer
+/// @param PkQ16 the Proportional term of the members' phase loops in Q16 fixed-point
+/// @param IkQ16 the Integral term of the members' phase loops in Q16 fixed-point
+void SfeSTP3593LFEnsemble::enableSteering(bool enable, int32_t PkQ16, int32_t IkQ16)
+{
+    _steering = enable;
+    _PkQ16 = PkQ16;
+    _IkQ16 = IkQ16;
+}
+
+/// @brief Set the time constants of the member estimates
+/// @param stabilityEpochs the averaging time of the stability estimate
+/// @param frequencyEpochs the averaging time of the frequency estimate
+void SfeSTP3593LFEnsemble::setTimeConstants(uint32_t stabilityEpochs, uint32_t frequencyEpochs)
+{
+    _stabilityTimeConstant = stabilityEpochs > 0 ? stabilityEpochs : 1;
+    _frequencyTimeConstant = frequencyEpochs > 0 ? frequencyEpochs : 1;
+}
+
+/// @brief Set the largest weight any one member can have
+/// @param maxWeight the largest weight, 0.0 - 1.0
+void SfeSTP3593LFEnsemble::setMaxWeight(double maxWeight)
+{
+    if (maxWeight > 1.0)
+        maxWeight = 1.0;
+    if (maxWeight < 0.0)
+        maxWeight = 0.0;
+    _maxWeight = maxWeight;
+}
+
+/// @brief Get the ensemble time
+/// @return The ensemble time relative to the common reference, in picoseconds
+double SfeSTP3593LFEnsemble::getEnsemblePhasePicoseconds(void)
+{
+    return _ensemblePhase;
+}
+
+/// @brief Get a member's output (steered) phase relative to the ensemble time
+/// @param member the member index
+/// @return The phase in picoseconds
+double SfeSTP3593LFEnsemble::getMemberPhasePicoseconds(uint8_t member)
+{
+    if (member >= _members)
+        return 0.0;
+    return _member[member].outputPhase;
+}
+
+/// @brief Get a member's free-running frequency relative to the ensemble
+/// @param member the member index
+/// @return The fractional frequency in ppb
+double SfeSTP3593LFEnsemble::getMemberFrequencyPPB(uint8_t member)
+{
+    if (member >= _members)
+        return 0.0;
+    return _member[member].frequency * 1.0e-3; // ps per one-second epoch to ppb
+}
+
+/// @brief Get a member's stability: the RMS error of its one-epoch phase prediction
+/// @param member the member index
+/// @return The RMS prediction error in picoseconds
+double SfeSTP3593LFEnsemble::getMemberStabilityPicoseconds(uint8_t member)
+{
+    if ((member >= _members) || (_member[member].predictions < kSfeSTP3593LFEnsembleWarmupEpochs))
+        return 0.0;
+    return sqrt(_member[member].variance);
+}
+
+/// @brief Get a member's weight in the ensemble
+/// @param member the member index
+/// @return The weight
+double SfeSTP3593LFEnsemble::getMemberWeight(uint8_t member)
+{
+    if (member >= _members)
+        return 0.0;
+    return _member[member].weight;
+}
+
+/// @brief  PRIVATE: compute the weights from the stability estimates
+void SfeSTP3593LFEnsemble::updateWeights(void)
+{
+    // Weight by 1 / variance once characterized. Until any member is, weight the seeded members equally
+    bool characterized = false;
+    for (uint8_t i = 0; i < _members; i++)
+    {
+        if ((_member[i].predictions >= kSfeSTP3593LFEnsembleWarmupEpochs) && (_member[i].variance > 0.0))
+            characterized = true;
+    }
+
+    double raw[kSfeSTP3593LFMaxEnsembleMembers];
+    uint8_t nonZero = 0;
+    for (uint8_t i = 0; i < _members; i++)
+    {
+        const sfeSTP3593LFEnsembleMember_t &member = _member[i];
+        if (characterized)
+            raw[i] = ((member.predictions >= kSfeSTP3593LFEnsembleWarmupEpochs) && (member.variance > 0.0)) ? 1.0 / member.variance : 0.0;
+        else
+            raw[i] = member.initialized ? 1.0 : 0.0;
+        if (raw[i] > 0.0)
+            nonZero++;
+    }
+
+    // Normalize. With a cap, members at the cap are fixed there and the rest share what is left - repeat
+    // until no member is over the cap. A cap the members cannot satisfy is ignored
+    bool capped[kSfeSTP3593LFMaxEnsembleMembers];
+    for (uint8_t i = 0; i < _members; i++)
+        capped[i] = false;
+    bool useCap = (_maxWeight < 1.0) && ((_maxWeight * (double)nonZero) >= 1.0);
+
+    for (uint8_t pass = 0; pass <= _members; pass++)
+    {
+        double remaining = 1.0;
+        double sumRaw = 0.0;
+        for (uint8_t i = 0; i < _members; i++)
+        {
+            if (capped[i])
+                remaining -= _maxWeight;
+            else
+                sumRaw += raw[i];
+        }
+
+        bool over = false;
+        for (uint8_t i = 0; i < _members; i++)
+        {
+            if (capped[i])
+            {
+                _member[i].weight = _maxWeight;
+                continue;
+            }
+            _member[i].weight = sumRaw > 0.0 ? remaining * raw[i] / sumRaw : 0.0;
+            if (useCap && (_member[i].weight > _maxWeight))
+            {
+                capped[i] = true;
+                over = true;
+            }
+        }
+        if (!over)
+            break;
+    }
+}
+
+#endif // SFE_STP3593LF_FLOATING_POINT_LOOP
@@ -0,0 +1,159 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_Ensemble.h
+
+    Description:
+    An ensemble time scale across several STP3593LF oscillators - for a chassis
+    with more than one part, to hold time through a GNSS outage better than any
+    one oscillator can.
+
+    SfeSTP3593LFEnsemble takes one phase measurement per member per epoch, each
+    against the same reference (e.g. a TIC channel per oscillator, all started by
+    the same local clock). The reference cancels: only the differences between
+    members matter.
+
+    Each epoch, in the manner of the AT1 algorithm:
+      - the steering applied to each member so far is removed from its phase, so
+        the ensemble sees the free-running oscillators
+      - each member's phase relative to the ensemble is predicted from its phase
+        and frequency at the previous epoch
+      - the ensemble time is the weighted mean of the members' readings of it
+      - each member's phase, frequency and stability (RMS prediction error) are
+        updated; its weight is proportional to 1 / stability^2, optionally capped
+      - each member's output is steered towards the ensemble time through its
+        phase loop (setFrequencyByPhasePicoseconds)
+
+    A member without a measurement this epoch coasts on its prediction and is left
+    out of the ensemble and the steering. A member added later starts with no
+    weight until it has been characterized.
+
+*/
+
+#pragma once
+
+#include "SparkFun_STP3593LF.h"
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+
+///////////////////////////////////////////////////////////////////////////////
+
+const uint8_t kSfeSTP3593LFMaxEnsembleMembers = 8;
+
+// A member is characterized - and given weight - after this many predictions
+const uint32_t kSfeSTP3593LFEnsembleWarmupEpochs = 10;
+
+///////////////////////////////////////////////////////////////////////////////
+
+class SfeSTP3593LFEnsemble
+{
+public:
+    SfeSTP3593LFEnsemble()
+        : _members{0}, _ensemblePhase{0.0}, _initialized{false}, _steering{true},
+          _PkQ16{kSfeSTP3593LFDefaultPkQ16}, _IkQ16{kSfeSTP3593LFDefaultIkQ16},
+          _stabilityTimeConstant{100}, _frequencyTimeConstant{1000}, _maxWeight{1.0}
+    {
+    }
+
+    /// @brief Add an oscillator to the ensemble
+    /// @param driver the oscillator's driver. It must stay valid while the ensemble is in use
+    /// @return true if added. false if the ensemble is full or the control word cannot be read
+    /// Note: the word in use now is the member's free-running word: steering is measured from it
+    bool addMember(SfeSTP3593LFDriver &driver);
+
+    /// @brief Get the number of members
+    /// @return The number of members
+    uint8_t getMemberCount(void);
+
+    /// @brief Provide one member's phase measurement for this epoch
+    /// @param member the member index - in the order added
+    /// @param phase the phase of the member against the common reference, in picoseconds. Positive means ahead
+    /// @return true if the member exists
+    bool setMemberPhasePicoseconds(uint8_t member, int32_t phase);
+
+    /// @brief Run one epoch of the ensemble: compute the time scale and steer the members. Call once per epoch
+    /// @return true if the ensemble time was computed and every steering write succeeded
+    /// Note: call it after setMemberPhasePicoseconds for each member measured this epoch
+    bool update(void);
+
+    /// @brief Enable or disable steering the members towards the ensemble time
+    /// @param enable true to steer (default)
+    /// @param PkQ16 the Proportional term of the members' phase loops in Q16 fixed-point
+    /// @param IkQ16 the Integral term of the members' phase loops in Q16 fixed-point
+    void enableSteering(bool enable, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16);
+
+    /// @brief Set the time constants of the member estimates
+    /// @param stabilityEpochs the averaging time of the stability (RMS prediction error) estimate (default 100)
+    /// @param frequencyEpochs the averaging time of the frequency estimate (default 1000)
+    /// Note: the frequency estimates start at zero - the members are assumed to be on frequency (e.g. disciplined)
+    ///       when the ensemble starts - and are averaged over frequencyEpochs from the first epoch
+    void setTimeConstants(uint32_t stabilityEpochs, uint32_t frequencyEpochs);
+
+    /// @brief Set the largest weight any one member can have
+    /// @param maxWeight the largest weight, 0.0 - 1.0 (default 1.0: no cap). Ignored if the members could not sum to 1
+    void setMaxWeight(double maxWeight);
+
+    /// @brief Get the ensemble time
+    /// @return The ensemble time relative to the common reference, in picoseconds
+    double getEnsemblePhasePicoseconds(void);
+
+    /// @brief Get a member's output (steered) phase relative to the ensemble time - at the most recent update
+    /// @param member the member index
+    /// @return The phase in picoseconds. Positive means ahead of the ensemble
+    double getMemberPhasePicoseconds(uint8_t member);
+
+    /// @brief Get a member's free-running frequency relative to the ensemble
+    /// @param member the member index
+    /// @return The fractional frequency in ppb
+    double getMemberFrequencyPPB(uint8_t member);
+
+    /// @brief Get a member's stability: the RMS error of its one-epoch phase prediction
+    /// @param member the member index
+    /// @return The RMS prediction error in picoseconds. 0 until the member has been characterized
+    double getMemberStabilityPicoseconds(uint8_t member);
+
+    /// @brief Get a member's weight in the ensemble
+    /// @param member the member index
+    /// @return The weight, 0.0 - 1.0. The weights of the members sum to 1
+    double getMemberWeight(uint8_t member);
+
+private:
+    /// @brief Compute the weights from the stability estimates
+    void updateWeights(void);
+
+    typedef struct
+    {
+        SfeSTP3593LFDriver *driver; // The oscillator
+        uint32_t freeWord; // The free-running word - steering is measured from it
+        double steeringPhase; // The phase added by steering so far (ps)
+        double measuredPhase; // This epoch's measurement (ps)
+        bool measured; // true if measuredPhase is this epoch's
+        double phase; // The free-running phase relative to the ensemble (ps)
+        double frequency; // The free-running frequency relative to the ensemble (ps per epoch)
+        double variance; // The mean square prediction error (ps^2)
+        double outputPhase; // The steered phase relative to the ensemble at the most recent update (ps)
+        double weight; // The weight in the ensemble
+        uint32_t predictions; // The number of predictions made - for the warm-up
+        bool initialized; // true once phase has been seeded
+    } sfeSTP3593LFEnsembleMember_t;
+
+    sfeSTP3593LFEnsembleMember_t _member[kSfeSTP3593LFMaxEnsembleMembers]; // The members
+    uint8_t _members; // The number of members
+    double _ensemblePhase; // The ensemble time relative to the common reference (ps)
+    bool _initialized; // true once the ensemble time has been seeded
+    bool _steering; // true to steer the members
+    int32_t _PkQ16; // The gains of the members' phase loops
+    int32_t _IkQ16;
+    uint32_t _stabilityTimeConstant; // Epochs
+    uint32_t _frequencyTimeConstant; // Epochs
+    double _maxWeight; // The largest weight any one member can have
+};
+
+#endif // SFE_STP3593LF_FLOATING_POINT_LOOP
@@ -0,0 +1,332 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_MockBus.h
+
+    Description:
+    An in-memory stand-in for the STP3593LF on the I2C bus.
+    It models registers 0x41, 0xA0 and 0xC2 and counts the bytes and
+    transactions the driver uses. No TwoWire port is touched.
+    SfeSTP3593LFMock is the driver on the in-memory bus.
+    SfeSTP3593LFMockPort is an in-memory I2C port with several devices, each at
+    its own address - for sweeping many oscillators on a host build.
+    Used by the replay runner and the benchmarks.
+
+*/
+
+#pragma once
+
+#include "SparkFun_STP3593LF.h"
+
+const uint8_t kSfeSTP3593LFMockMaxDevices = 16; // The maximum number of devices on one SfeSTP3593LFMockPort
+
+class SfeSTP3593LFMockBus : public sfeTkArdI2C
+{
+public:
+    /// @brief Constructor
+    /// @param word the initial (and saved) frequency control word
+    SfeSTP3593LFMockBus(uint32_t word = kSfeSTP3593LFFreqControlMaxValue / 2)
+        : _word{word}, _savedWord{word}, _failCount{0}, _transactions{0}, _bytesWritten{0}, _bytesRead{0}
+    {
+    }
+
+    /// @brief Check the mock device is present
+    /// @return kSTkErrOk unless a failure has been injected
+    sfeTkError_t ping()
+    {
+        _transactions++;
+        _bytesWritten++; // The address byte
+        return injectFailure();
+    }
+
+    /// @brief Write a single byte - the Save Frequency Control Value command (0xC2)
+    /// @param data the byte
+    /// @return kSTkErrOk if the command is recognised
+    sfeTkError_t writeByte(uint8_t data)
+    {
+        _transactions++;
+        _bytesWritten += 2;
+        if (injectFailure() != kSTkErrOk)
+            return kSTkErrFail;
+        if (data != kSfeSTP3593LFRegSaveFrequency)
+            return kSTkErrFail;
+        _savedWord = _word;
+        return kSTkErrOk;
+    }
+
+    /// @brief Write a register region - the Write DAC register (0xA0)
+    /// @param devReg the register
+    /// @param data the bytes, MSB first
+    /// @param length the number of bytes. Must be 4
+    /// @return kSTkErrOk if the write is recognised
+    sfeTkError_t writeRegisterRegion(uint8_t devReg, const uint8_t *data, size_t length)
+    {
+        _transactions++;
+        _bytesWritten += 2 + length;
+        if (injectFailure() != kSTkErrOk)
+            return kSTkErrFail;
+        if ((devReg != kSfeSTP3593LFRegWriteDAC) || (length != 4))
+            return kSTkErrFail;
+        uint32_t word = (((uint32_t)data[0]) << 24) | (((uint32_t)data[1]) << 16) | (((uint32_t)data[2]) << 8) | ((uint32_t)data[3]);
+        _word = (word > kSfeSTP3593LFFreqControlMaxValue) ? kSfeSTP3593LFFreqControlMaxValue : word;
+        return kSTkErrOk;
+    }
+
+    /// @brief Read a register region - the Read Frequency Control register (0x41)
+    /// @param devReg the register
+    /// @param data the buffer for the bytes, MSB first
+    /// @param numBytes the number of bytes to read. Must be 4
+    /// @param readBytes returns the number of bytes read
+    /// @return kSTkErrOk if the read is recognised
+    sfeTkError_t readRegisterRegion(uint8_t devReg, uint8_t *data, size_t numBytes, size_t &readBytes)
+    {
+        _transactions += 2; // Register write, then restart and read
+        _bytesWritten += 3;
+        readBytes = 0;
+        if (injectFailure() != kSTkErrOk)
+            return kSTkErrFail;
+        if ((devReg != kSfeSTP3593LFRegReadFrequencyControl) || (numBytes != 4))
+            return kSTkErrFail;
+        data[0] = (uint8_t)((_word >> 24) & 0xFF);
+        data[1] = (uint8_t)((_word >> 16) & 0xFF);
+        data[2] = (uint8_t)((_word >> 8) & 0xFF);
+        data[3] = (uint8_t)((_word >> 0) & 0xFF);
+        readBytes = 4;
+        _bytesRead += 4;
+        return kSTkErrOk;
+    }
+
+    /// @brief Make the next transactions fail
+    /// @param count the number of transactions to fail
+    void failNext(uint16_t count = 1)
+    {
+        _failCount = count;
+    }
+
+    /// @brief Get the frequency control word the mock device is using
+    /// @return The frequency control word
+    uint32_t getWord(void)
+    {
+        return _word;
+    }
+
+    /// @brief Set the frequency control word the mock device is using - e.g. to simulate a reset
+    /// @param word the frequency control word
+    void setWord(uint32_t word)
+    {
+        _word = word;
+    }
+
+    /// @brief Get the saved frequency control word
+    /// @return The saved frequency control word
+    uint32_t getSavedWord(void)
+    {
+        return _savedWord;
+    }
+
+    /// @brief Set the saved frequency control word - e.g. to simulate a device calibrated elsewhere
+    /// @param word the saved frequency control word
+    void setSavedWord(uint32_t word)
+    {
+        _savedWord = word;
+    }
+
+    /// @brief Get the number of bus transactions (START to STOP or RESTART) so far
+    /// @return The number of transactions
+    uint32_t getTransactions(void)
+    {
+        return _transactions;
+    }
+
+    /// @brief Get the number of bytes written to the bus so far - including address bytes
+    /// @return The number of bytes
+    uint32_t getBytesWritten(void)
+    {
+        return _bytesWritten;
+    }
+
+    /// @brief Get the number of bytes read from the bus so far
+    /// @return The number of bytes
+    uint32_t getBytesRead(void)
+    {
+        return _bytesRead;
+    }
+
+    /// @brief Reset the transaction and byte counters
+    void resetCounters(void)
+    {
+        _transactions = 0;
+        _bytesWritten = 0;
+        _bytesRead = 0;
+    }
+
+private:
+    /// @brief Consume one injected failure
+    /// @return kSTkErrFail if a failure was injected
+    sfeTkError_t injectFailure(void)
+    {
+        if (_failCount == 0)
+            return kSTkErrOk;
+        _failCount--;
+        return kSTkErrFail;
+    }
+
+    uint32_t _word; // The frequency control word (0x41 / 0xA0)
+    uint32_t _savedWord; // The saved frequency control word (0xC2)
+    uint16_t _failCount; // The number of transactions still to fail
+    uint32_t _transactions; // The number of transactions
+    uint32_t _bytesWritten; // The number of bytes written, including address bytes
+    uint32_t _bytesRead; // The number of bytes read
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// An in-memory I2C port with up to kSfeSTP3593LFMockMaxDevices devices, each at its own address.
+// The counters are those of the whole port: every device's transactions share the one bus
+class SfeSTP3593LFMockPort
+{
+public:
+    SfeSTP3593LFMockPort() : _numDevices{0}
+    {
+    }
+
+    /// @brief Add a device to the port
+    /// @param address the device's 7-bit I2C address
+    /// @param word the device's initial (and saved) frequency control word
+    /// @return true if the device was added. false if the port is full or the address is already in use
+    bool addDevice(uint8_t address, uint32_t word = kSfeSTP3593LFFreqControlMaxValue / 2)
+    {
+        if ((_numDevices >= kSfeSTP3593LFMockMaxDevices) || (getDevice(address) != nullptr))
+            return false;
+
+        _addresses[_numDevices] = address;
+        _devices[_numDevices].setWord(word);
+        _devices[_numDevices].setSavedWord(word);
+        _numDevices++;
+        return true;
+    }
+
+    /// @brief Get the device at an address - e.g. to inspect its word or inject failures
+    /// @param address the 7-bit I2C address
+    /// @return The device. nullptr if no device has that address
+    SfeSTP3593LFMockBus *getDevice(uint8_t address)
+    {
+        for (uint8_t i = 0; i < _numDevices; i++)
+        {
+            if (_addresses[i] == address)
+                return &_devices[i];
+        }
+        return nullptr;
+    }
+
+    /// @brief Get the number of devices on the port
+    /// @return The number of devices
+    uint8_t getNumDevices(void)
+    {
+        return _numDevices;
+    }
+
+    /// @brief Get the number of bus transactions (START to STOP or RESTART) so far - on every device
+    /// @return The number of transactions
+    uint32_t getTransactions(void)
+    {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < _numDevices; i++)
+            total += _devices[i].getTransactions();
+        return total;
+    }
+
+    /// @brief Get the number of bytes written to the bus so far - including address bytes - on every device
+    /// @return The number of bytes
+    uint32_t getBytesWritten(void)
+    {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < _numDevices; i++)
+            total += _devices[i].getBytesWritten();
+        return total;
+    }
+
+    /// @brief Get the number of bytes read from the bus so far - on every device
+    /// @return The number of bytes
+    uint32_t getBytesRead(void)
+    {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < _numDevices; i++)
+            total += _devices[i].getBytesRead();
+        return total;
+    }
+
+    /// @brief Get the time the bytes so far would have taken on a real bus: 9 bits per byte (8 data plus ACK)
+    /// @param clockHz the bus clock
+    /// @return The bus time in microseconds. START, STOP and clock stretching are not included
+    uint32_t getBusMicros(uint32_t clockHz)
+    {
+        uint64_t bits = ((uint64_t)getBytesWritten() + (uint64_t)getBytesRead()) * 9;
+        return (uint32_t)((bits * 1000000) / clockHz);
+    }
+
+    /// @brief Reset the transaction and byte counters of every device
+    void resetCounters(void)
+    {
+        for (uint8_t i = 0; i < _numDevices; i++)
+            _devices[i].resetCounters();
+    }
+
+private:
+    SfeSTP3593LFMockBus _devices[kSfeSTP3593LFMockMaxDevices]; // The devices
+    uint8_t _addresses[kSfeSTP3593LFMockMaxDevices]; // The address of each device
+    uint8_t _numDevices; // The number of devices added
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class SfeSTP3593LFMock : public SfeSTP3593LFDriver
+{
+public:
+    SfeSTP3593LFMock()
+    {
+    }
+
+    /// @brief  Sets up the in-memory bus then calls the super class begin.
+    /// @return True if successful, false otherwise.
+    bool begin(void)
+    {
+        _portDevice = nullptr;
+        setCommunicationBus(&_theMockBus);
+
+        return SfeSTP3593LFDriver::begin();
+    }
+
+    /// @brief  Sets up the device at address on an in-memory port then calls the super class begin.
+    /// @param  port the port. It must stay valid while the driver is in use
+    /// @param  address the device's 7-bit I2C address
+    /// @return True if successful, false otherwise - including when no device has that address
+    bool begin(SfeSTP3593LFMockPort &port, uint8_t address)
+    {
+        _portDevice = port.getDevice(address);
+        if (_portDevice == nullptr)
+            return false; // Not acknowledged
+
+        setCommunicationBus(_portDevice);
+
+        return SfeSTP3593LFDriver::begin();
+    }
+
+    /// @brief Get the mock bus - e.g. to inspect the bus counters or inject failures
+    /// @return The mock bus - the port's device if begun on a port
+    SfeSTP3593LFMockBus &getMockBus(void)
+    {
+        return (_portDevice != nullptr) ? *_portDevice : _theMockBus;
+    }
+
+protected:
+    SfeSTP3593LFMockBus _theMockBus;
+    SfeSTP3593LFMockBus *_portDevice{nullptr}; // The device on an SfeSTP3593LFMockPort. nullptr when _theMockBus is used
+};
@@ -0,0 +1,403 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_Recorder.cpp
+
+    Description:
+    Deterministic record and replay of the inputs to the STP3593LF discipline loop.
+
+*/
+
+#include "SparkFun_STP3593LF_Recorder.h"
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+
+/// @brief Write the trace header. Called by SfeSTP3593LFDriver::setRecorder
+/// @param state the loop state at the start of the recording
+void SfeSTP3593LFRecorder::writeHeader(const sfeSTP3593LFLoopState_t &state)
+{
+    const uint8_t magic[4] = {'S', 'T', 'P', 'R'};
+    writeBytes(magic, 4);
+    uint8_t version = kSfeSTP3593LFRecordVersion;
+    writeBytes(&version, 1);
+    uint8_t doubleSize = sizeof(double);
+    writeBytes(&doubleSize, 1);
+
+    writeBytes(&state.frequencyControl, 4);
+    writeBytes(&state.maxFrequencyChangePPB, sizeof(double));
+    writeBytes(&state.integral, sizeof(double));
+    writeBytes(&state.integralQ16, 8);
+    writeBytes(&state.quantizationResidualQ16, 4);
+    uint8_t flags = (state.integralInitialized ? 0x01 : 0x00) | (state.integralQ16Initialized ? 0x02 : 0x00) |
+                    (state.errorFeedback ? 0x04 : 0x00);
+    writeBytes(&flags, 1);
+    uint32_t now = millis();
+    writeBytes(&now, 4);
+
+    _gainsValid = false; // Force the first gains to be written
+    _gainsQ16Valid = false;
+    _timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros; // Replay starts at one second
+}
+
+/// @brief Record one setFrequencyByBiasMillis
+/// @param bias the GNSS RX clock bias in milliseconds
+/// @param Pk the Proportional term
+/// @param Ik the Integral term
+/// @param word the frequency control word after the call
+/// @param result the result of the call
+/// @param timeStepMicros the time step of the call
+void SfeSTP3593LFRecorder::recordBias(double bias, double Pk, double Ik, uint32_t word, bool result, uint32_t timeStepMicros)
+{
+    writeTimeStep(timeStepMicros);
+
+    if ((!_gainsValid) || (Pk != _Pk) || (Ik != _Ik))
+    {
+        uint8_t type = kSfeSTP3593LFRecordGains;
+        writeBytes(&type, 1);
+        writeBytes(&Pk, sizeof(double));
+        writeBytes(&Ik, sizeof(double));
+        _Pk = Pk;
+        _Ik = Ik;
+        _gainsValid = true;
+        _records++;
+    }
+
+    writeRecordStart(kSfeSTP3593LFRecordBias);
+    writeBytes(&bias, sizeof(double));
+    writeBytes(&word, 4);
+    uint8_t ok = result ? 1 : 0;
+    writeBytes(&ok, 1);
+}
+
+/// @brief Record one setFrequencyByPhasePicoseconds
+/// @param phase the phase in picoseconds
+/// @param PkQ16 the Proportional term in Q16 fixed-point
+/// @param IkQ16 the Integral term in Q16 fixed-point
+/// @param word the frequency control word after the call
+/// @param result the result of the call
+/// @param timeStepMicros the time step of the call
+void SfeSTP3593LFRecorder::recordPhase(int32_t phase, int32_t PkQ16, int32_t IkQ16, uint32_t word, bool result, uint32_t timeStepMicros)
+{
+    writeTimeStep(timeStepMicros);
+
+    if ((!_gainsQ16Valid) || (PkQ16 != _PkQ16) || (IkQ16 != _IkQ16))
+    {
+        uint8_t type = kSfeSTP3593LFRecordGainsQ16;
+        writeBytes(&type, 1);
+        writeBytes(&PkQ16, 4);
+        writeBytes(&IkQ16, 4);
+        _PkQ16 = PkQ16;
+        _IkQ16 = IkQ16;
+        _gainsQ16Valid = true;
+        _records++;
+    }
+
+    writeRecordStart(kSfeSTP3593LFRecordPhase);
+    writeBytes(&phase, 4);
+    writeBytes(&word, 4);
+    uint8_t ok = result ? 1 : 0;
+    writeBytes(&ok, 1);
+}
+
+/// @brief Record one setTemperature
+/// @param degC the temperature in degrees C
+void SfeSTP3593LFRecorder::recordTemperature(double degC)
+{
+    writeRecordStart(kSfeSTP3593LFRecordTemperature);
+    writeBytes(&degC, sizeof(double));
+}
+
+/// @brief Record one setMaxFrequencyChangePPB
+/// @param ppb the maximum frequency change in PPB
+void SfeSTP3593LFRecorder::recordMaxFrequencyChange(double ppb)
+{
+    writeRecordStart(kSfeSTP3593LFRecordMaxChange);
+    writeBytes(&ppb, sizeof(double));
+}
+
+/// @brief Record a change of setting
+/// @param setting the setting - kSfeSTP3593LFRecordTemperatureCompensation etc.
+/// @param value the new value
+void SfeSTP3593LFRecorder::recordSetting(uint8_t setting, bool value)
+{
+    writeRecordStart(kSfeSTP3593LFRecordSetting);
+    writeBytes(&setting, 1);
+    uint8_t v = value ? 1 : 0;
+    writeBytes(&v, 1);
+}
+
+/// @brief Get the number of records written (excluding the header)
+/// @return The number of records
+uint32_t SfeSTP3593LFRecorder::getRecordCount(void)
+{
+    return _records;
+}
+
+/// @brief Get the number of bytes written (including the header)
+/// @return The number of bytes
+uint32_t SfeSTP3593LFRecorder::getByteCount(void)
+{
+    return _bytes;
+}
+
+/// @brief  PRIVATE: write bytes to the trace
+/// @param  data the bytes
+/// @param  length the number of bytes
+void SfeSTP3593LFRecorder::writeBytes(const void *data, size_t length)
+{
+    _bytes += _out->write((const uint8_t *)data, length);
+}
+
+/// @brief  PRIVATE: write a record type and the timestamp
+/// @param  type the record type
+void SfeSTP3593LFRecorder::writeRecordStart(uint8_t type)
+{
+    writeBytes(&type, 1);
+    uint32_t now = millis();
+    writeBytes(&now, 4);
+    _records++;
+}
+
+/// @brief  PRIVATE: write a 'D' record if the time step has changed
+/// @param  timeStepMicros the time step in microseconds
+void SfeSTP3593LFRecorder::writeTimeStep(uint32_t timeStepMicros)
+{
+    if (timeStepMicros == _timeStepMicros)
+        return;
+    uint8_t type = kSfeSTP3593LFRecordTimeStep;
+    writeBytes(&type, 1);
+    writeBytes(&timeStepMicros, 4);
+    _timeStepMicros = timeStepMicros;
+    _records++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/// @brief Read the trace header and restore the loop state against the mock bus
+/// @param trace the trace - e.g. an SD File
+/// @return true if the header is valid
+bool SfeSTP3593LFReplay::begin(Stream &trace)
+{
+    _trace = &trace;
+    _records = 0;
+    _mismatches = 0;
+    _timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros;
+
+    uint8_t magic[4];
+    if (!readBytes(magic, 4))
+        return false;
+    if ((magic[0] != 'S') || (magic[1] != 'T') || (magic[2] != 'P') || (magic[3] != 'R'))
+        return false;
+    uint8_t version;
+    uint8_t doubleSize;
+    if ((!readBytes(&version, 1)) || (version != kSfeSTP3593LFRecordVersion))
+        return false;
+    if ((!readBytes(&doubleSize, 1)) || (doubleSize != sizeof(double)))
+        return false; // Recorded on a different architecture
+
+    sfeSTP3593LFLoopState_t state;
+    uint8_t flags;
+    if (!readBytes(&state.frequencyControl, 4))
+        return false;
+    if (!readBytes(&state.maxFrequencyChangePPB, sizeof(double)))
+        return false;
+    if (!readBytes(&state.integral, sizeof(double)))
+        return false;
+    if (!readBytes(&state.integralQ16, 8))
+        return false;
+    if (!readBytes(&state.quantizationResidualQ16, 4))
+        return false;
+    if (!readBytes(&flags, 1))
+        return false;
+    if (!readBytes(&_timestamp, 4))
+        return false;
+    state.integralInitialized = ((flags & 0x01) != 0);
+    state.integralQ16Initialized = ((flags & 0x02) != 0);
+    state.errorFeedback = ((flags & 0x04) != 0);
+
+    _theMockBus.setWord(state.frequencyControl);
+    setCommunicationBus(&_theMockBus);
+    setLoopState(state);
+    return true;
+}
+
+/// @brief Replay one record
+/// @return true if a record was replayed. false at the end of the trace or on a malformed record
+bool SfeSTP3593LFReplay::step(void)
+{
+    if (_trace == nullptr)
+        return false;
+    if (_trace->available() <= 0)
+        return false; // End of the trace
+
+    uint8_t type;
+    if (!readBytes(&type, 1))
+        return false;
+
+    if (type == kSfeSTP3593LFRecordGains)
+    {
+        if (!readBytes(&_Pk, sizeof(double)))
+            return false;
+        if (!readBytes(&_Ik, sizeof(double)))
+            return false;
+        _records++;
+        return true;
+    }
+
+    if (type == kSfeSTP3593LFRecordGainsQ16)
+    {
+        if (!readBytes(&_PkQ16, 4))
+            return false;
+        if (!readBytes(&_IkQ16, 4))
+            return false;
+        _records++;
+        return true;
+    }
+
+    if (type == kSfeSTP3593LFRecordTimeStep)
+    {
+        if (!readBytes(&_timeStepMicros, 4))
+            return false;
+        _records++;
+        return true;
+    }
+
+    if (!readBytes(&_timestamp, 4))
+        return false;
+
+    switch (type)
+    {
+    case kSfeSTP3593LFRecordBias:
+    {
+        double bias;
+        uint32_t word;
+        uint8_t ok;
+        if ((!readBytes(&bias, sizeof(double))) || (!readBytes(&word, 4)) || (!readBytes(&ok, 1)))
+            return false;
+        if (!ok)
+            _theMockBus.failNext(); // Reproduce the bus error
+        setTimeStepMicros(_timeStepMicros);
+        bool result = setFrequencyByBiasMillis(bias, _Pk, _Ik);
+        setTimeStepMicros(kSfeSTP3593LFNominalTimeStepMicros);
+        check(word, (result == (ok != 0)));
+    }
+    break;
+    case kSfeSTP3593LFRecordPhase:
+    {
+        int32_t phase;
+        uint32_t word;
+        uint8_t ok;
+        if ((!readBytes(&phase, 4)) || (!readBytes(&word, 4)) || (!readBytes(&ok, 1)))
+            return false;
+        if (!ok)
+            _theMockBus.failNext(); // Reproduce the bus error
+        setTimeStepMicros(_timeStepMicros);
+        bool result = setFrequencyByPhasePicoseconds(phase, _PkQ16, _IkQ16);
+        setTimeStepMicros(kSfeSTP3593LFNominalTimeStepMicros);
+        check(word, (result == (ok != 0)));
+    }
+    break;
+    case kSfeSTP3593LFRecordTemperature:
+    {
+        double degC;
+        if (!readBytes(&degC, sizeof(double)))
+            return false;
+        setTemperature(degC);
+    }
+    break;
+    case kSfeSTP3593LFRecordMaxChange:
+    {
+        double ppb;
+        if (!readBytes(&ppb, sizeof(double)))
+            return false;
+        setMaxFrequencyChangePPB(ppb);
+    }
+    break;
+    case kSfeSTP3593LFRecordSetting:
+    {
+        uint8_t setting;
+        uint8_t value;
+        if ((!readBytes(&setting, 1)) || (!readBytes(&value, 1)))
+            return false;
+        if (setting == kSfeSTP3593LFRecordTemperatureCompensation)
+            enableTemperatureCompensation(value != 0);
+        else if (setting == kSfeSTP3593LFRecordResolutionFeedback)
+        {
+#if SFE_STP3593LF_ENABLE_STATISTICS
+            useEstimatedFreqControlResolution(value != 0);
+#else
+            return false; // Recorded with the estimators. This build cannot reproduce them
+#endif
+        }
+        else if (setting == kSfeSTP3593LFRecordReset)
+            resetDiscipline();
+        else if (setting == kSfeSTP3593LFRecordErrorFeedback)
+            enableErrorFeedback(value != 0);
+        else
+            return false;
+    }
+    break;
+    default:
+        return false; // Malformed
+    }
+
+    _records++;
+    return true;
+}
+
+/// @brief Replay the rest of the trace
+/// @return The number of records replayed
+uint32_t SfeSTP3593LFReplay::run(void)
+{
+    while (step())
+        ;
+    return _records;
+}
+
+/// @brief Get the number of records replayed
+/// @return The number of records
+uint32_t SfeSTP3593LFReplay::getRecordCount(void)
+{
+    return _records;
+}
+
+/// @brief Get the number of control words (or write results) which did not match the recording
+/// @return The number of mismatches. Zero for a bit-identical replay
+uint32_t SfeSTP3593LFReplay::getMismatchCount(void)
+{
+    return _mismatches;
+}
+
+/// @brief Get the timestamp of the most recent record
+/// @return The recorded millis()
+uint32_t SfeSTP3593LFReplay::getTimestamp(void)
+{
+    return _timestamp;
+}
+
+/// @brief  PRIVATE: read bytes from the trace
+/// @param  data the buffer for the bytes
+/// @param  length the number of bytes
+/// @return true if all of the bytes were read
+bool SfeSTP3593LFReplay::readBytes(void *data, size_t length)
+{
+    return (_trace->readBytes((uint8_t *)data, length) == length);
+}
+
+/// @brief  PRIVATE: compare a replayed control word and write result with the recording
+/// @param  word the recorded control word
+/// @param  resultMatches true if the replayed write result matches the recorded result
+void SfeSTP3593LFReplay::check(uint32_t word, bool resultMatches)
+{
+    if ((word != getFrequencyControlWord()) || (!resultMatches))
+        _mismatches++;
+}
+
+#endif // SFE_STP3593LF_ENABLE_TELEMETRY
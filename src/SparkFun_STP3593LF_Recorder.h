@@ -0,0 +1,212 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_Recorder.h
+
+    Description:
+    Deterministic record and replay of the inputs to the STP3593LF discipline loop.
+
+    SfeSTP3593LFRecorder writes a compact binary trace to any Print (e.g. an SD File):
+    a header holding the loop state, then one record per loop input.
+
+    Header : "STPR", version (1), sizeof(double) (1),
+             frequencyControl (4), maxFrequencyChangePPB (double), integral (double),
+             integralQ16 (8), quantizationResidualQ16 (4), flags (1) - integral seeded,
+             integralQ16 seeded, error feedback - start millis (4)
+    Records: 'B' bias      : millis (4), bias (double), word (4), result (1)
+             'G' gains     : Pk (double), Ik (double) - only written when the gains change
+             'P' phase     : millis (4), phase (4), word (4), result (1)
+             'Q' gains Q16 : PkQ16 (4), IkQ16 (4) - only written when the gains change
+             'D' time step : micros (4) - only written when the time step of a 'B' or 'P' record
+                             is not the one before it. The trace starts at one second (1000000)
+             'T' temperature : millis (4), degC (double)
+             'M' max change : millis (4), ppb (double)
+             'S' setting   : millis (4), setting (1), value (1)
+
+    Values are written in the native byte order. Replay the trace on the same
+    architecture family (same endianness and sizeof(double)).
+
+    SfeSTP3593LFReplay streams a trace back through the driver against an
+    SfeSTP3593LFMockBus, as fast as the CPU allows, and checks that every
+    control word (and every write result) matches the recording bit for bit.
+
+*/
+
+#pragma once
+
+#include "SparkFun_STP3593LF.h"
+#include "SparkFun_STP3593LF_MockBus.h"
+
+#if SFE_STP3593LF_ENABLE_TELEMETRY
+
+///////////////////////////////////////////////////////////////////////////////
+
+const uint8_t kSfeSTP3593LFRecordVersion = 1;
+
+// Record types
+const uint8_t kSfeSTP3593LFRecordBias = 'B';
+const uint8_t kSfeSTP3593LFRecordGains = 'G';
+const uint8_t kSfeSTP3593LFRecordPhase = 'P';
+const uint8_t kSfeSTP3593LFRecordGainsQ16 = 'Q';
+const uint8_t kSfeSTP3593LFRecordTemperature = 'T';
+const uint8_t kSfeSTP3593LFRecordMaxChange = 'M';
+const uint8_t kSfeSTP3593LFRecordSetting = 'S';
+const uint8_t kSfeSTP3593LFRecordTimeStep = 'D';
+
+// Settings - for kSfeSTP3593LFRecordSetting
+const uint8_t kSfeSTP3593LFRecordTemperatureCompensation = 0; // enableTemperatureCompensation
+const uint8_t kSfeSTP3593LFRecordResolutionFeedback = 1; // useEstimatedFreqControlResolution
+const uint8_t kSfeSTP3593LFRecordReset = 2; // resetDiscipline
+const uint8_t kSfeSTP3593LFRecordErrorFeedback = 3; // enableErrorFeedback
+
+///////////////////////////////////////////////////////////////////////////////
+
+class SfeSTP3593LFRecorder
+{
+public:
+    /// @brief Constructor
+    /// @param out where to write the trace - e.g. an SD File
+    SfeSTP3593LFRecorder(Print &out)
+        : _out{&out}, _records{0}, _bytes{0}, _gainsValid{false}, _gainsQ16Valid{false},
+          _Pk{0.0}, _Ik{0.0}, _PkQ16{0}, _IkQ16{0}, _timeStepMicros{kSfeSTP3593LFNominalTimeStepMicros}
+    {
+    }
+
+    /// @brief Write the trace header. Called by SfeSTP3593LFDriver::setRecorder
+    /// @param state the loop state at the start of the recording
+    void writeHeader(const sfeSTP3593LFLoopState_t &state);
+
+    /// @brief Record one setFrequencyByBiasMillis
+    /// @param bias the GNSS RX clock bias in milliseconds
+    /// @param Pk the Proportional term
+    /// @param Ik the Integral term
+    /// @param word the frequency control word after the call
+    /// @param result the result of the call
+    /// @param timeStepMicros the time step of the call - see setFrequencyByTimedBiasMillis
+    void recordBias(double bias, double Pk, double Ik, uint32_t word, bool result, uint32_t timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros);
+
+    /// @brief Record one setFrequencyByPhasePicoseconds
+    /// @param phase the phase in picoseconds
+    /// @param PkQ16 the Proportional term in Q16 fixed-point
+    /// @param IkQ16 the Integral term in Q16 fixed-point
+    /// @param word the frequency control word after the call
+    /// @param result the result of the call
+    /// @param timeStepMicros the time step of the call - see setFrequencyByTimedPhasePicoseconds
+    void recordPhase(int32_t phase, int32_t PkQ16, int32_t IkQ16, uint32_t word, bool result, uint32_t timeStepMicros = kSfeSTP3593LFNominalTimeStepMicros);
+
+    /// @brief Record one setTemperature
+    /// @param degC the temperature in degrees C
+    void recordTemperature(double degC);
+
+    /// @brief Record one setMaxFrequencyChangePPB
+    /// @param ppb the maximum frequency change in PPB
+    void recordMaxFrequencyChange(double ppb);
+
+    /// @brief Record a change of setting
+    /// @param setting the setting - kSfeSTP3593LFRecordTemperatureCompensation etc.
+    /// @param value the new value
+    void recordSetting(uint8_t setting, bool value);
+
+    /// @brief Get the number of records written (excluding the header)
+    /// @return The number of records
+    uint32_t getRecordCount(void);
+
+    /// @brief Get the number of bytes written (including the header)
+    /// @return The number of bytes
+    uint32_t getByteCount(void);
+
+private:
+    /// @brief Write bytes to the trace
+    /// @param data the bytes
+    /// @param length the number of bytes
+    void writeBytes(const void *data, size_t length);
+
+    /// @brief Write a record type and the timestamp
+    /// @param type the record type
+    void writeRecordStart(uint8_t type);
+
+    /// @brief Write a 'D' record if the time step has changed
+    /// @param timeStepMicros the time step in microseconds
+    void writeTimeStep(uint32_t timeStepMicros);
+
+    Print *_out; // Where the trace is written
+    uint32_t _records; // The number of records written
+    uint32_t _bytes; // The number of bytes written
+    bool _gainsValid; // true once a 'G' record has been written
+    bool _gainsQ16Valid; // true once a 'Q' record has been written
+    double _Pk; // The gains in the last 'G' record
+    double _Ik;
+    int32_t _PkQ16; // The gains in the last 'Q' record
+    int32_t _IkQ16;
+    uint32_t _timeStepMicros; // The time step in the last 'D' record
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+class SfeSTP3593LFReplay : public SfeSTP3593LFMock
+{
+public:
+    SfeSTP3593LFReplay()
+        : _trace{nullptr}, _records{0}, _mismatches{0}, _timestamp{0},
+          _Pk{kSfeSTP3593LFDefaultPk}, _Ik{kSfeSTP3593LFDefaultIk},
+          _PkQ16{kSfeSTP3593LFDefaultPkQ16}, _IkQ16{kSfeSTP3593LFDefaultIkQ16},
+          _timeStepMicros{kSfeSTP3593LFNominalTimeStepMicros}
+    {
+    }
+
+    /// @brief Read the trace header and restore the loop state against the mock bus
+    /// @param trace the trace - e.g. an SD File
+    /// @return true if the header is valid
+    bool begin(Stream &trace);
+
+    /// @brief Replay one record
+    /// @return true if a record was replayed. false at the end of the trace or on a malformed record
+    bool step(void);
+
+    /// @brief Replay the rest of the trace
+    /// @return The number of records replayed
+    uint32_t run(void);
+
+    /// @brief Get the number of records replayed
+    /// @return The number of records
+    uint32_t getRecordCount(void);
+
+    /// @brief Get the number of control words (or write results) which did not match the recording
+    /// @return The number of mismatches. Zero for a bit-identical replay
+    uint32_t getMismatchCount(void);
+
+    /// @brief Get the timestamp of the most recent record
+    /// @return The recorded millis()
+    uint32_t getTimestamp(void);
+
+private:
+    /// @brief Read bytes from the trace
+    /// @param data the buffer for the bytes
+    /// @param length the number of bytes
+    /// @return true if all of the bytes were read
+    bool readBytes(void *data, size_t length);
+
+    /// @brief Compare a replayed control word and write result with the recording
+    /// @param word the recorded control word
+    /// @param resultMatches true if the replayed write result matches the recorded result
+    void check(uint32_t word, bool resultMatches);
+
+    Stream *_trace; // The trace being replayed
+    uint32_t _records; // The number of records replayed
+    uint32_t _mismatches; // The number of mismatches
+    uint32_t _timestamp; // The timestamp of the most recent record
+    double _Pk; // The gains from the most recent 'G' record
+    double _Ik;
+    int32_t _PkQ16; // The gains from the most recent 'Q' record
+    int32_t _IkQ16;
+    uint32_t _timeStepMicros; // The time step from the most recent 'D' record
+};
+
+#endif // SFE_STP3593LF_ENABLE_TELEMETRY
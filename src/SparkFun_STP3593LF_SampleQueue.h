@@ -0,0 +1,108 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_SampleQueue.h
+
+    Description:
+    A wait-free single-producer / single-consumer queue - for passing timestamped
+    PPS samples from interrupt context to the task which drives the I2C bus.
+
+    The producer (e.g. the PPS ISR) only writes the head index; the consumer only
+    writes the tail index. Each index is a single byte, so loads and stores are
+    atomic on every platform - including AVR. Neither side ever blocks or loops.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// The kinds of sample carried by the queue
+typedef enum
+{
+    kSfeSTP3593LFSampleTICCount = 0, // value is a raw TIC capture count
+    kSfeSTP3593LFSamplePhase, // value is the PPS-to-oscillator phase in picoseconds
+    kSfeSTP3593LFSampleBias, // value is the GNSS RX clock bias in picoseconds (+/-2.1ms)
+    kSfeSTP3593LFSampleNoBias // the GNSS receiver could not provide a bias this epoch
+} sfeSTP3593LFSampleType_t;
+
+// One timestamped sample
+typedef struct
+{
+    uint32_t timestamp; // micros() when the sample was queued
+    int32_t value; // The count, phase or bias - see type
+    int32_t sawtoothPicoseconds; // The receiver-reported quantization (sawtooth) error for this PPS edge
+    uint8_t type; // sfeSTP3593LFSampleType_t
+} sfeSTP3593LFSample_t;
+
+///////////////////////////////////////////////////////////////////////////////
+
+template <typename T, uint8_t Capacity>
+class SfeSTP3593LFSPSCQueue
+{
+    static_assert((Capacity >= 2) && (Capacity <= 128) && ((Capacity & (Capacity - 1)) == 0),
+                  "Capacity must be a power of two, 2 - 128");
+
+public:
+    SfeSTP3593LFSPSCQueue() : _head{0}, _tail{0}, _overflows{0}
+    {
+    }
+
+    /// @brief Add an item to the queue. Producer only. Wait-free and ISR-safe
+    /// @param item the item
+    /// @return true if the item was queued. false if the queue is full (the item is dropped)
+    bool push(const T &item)
+    {
+        uint8_t head = _head; // Only the producer writes _head
+        uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+        if ((uint8_t)(head - tail) >= Capacity)
+        {
+            _overflows++;
+            return false;
+        }
+        _items[head & (Capacity - 1)] = item;
+        __atomic_store_n(&_head, (uint8_t)(head + 1), __ATOMIC_RELEASE); // Publish the item
+        return true;
+    }
+
+    /// @brief Remove the oldest item from the queue. Consumer only. Wait-free
+    /// @param item returns the item
+    /// @return true if an item was removed. false if the queue is empty
+    bool pop(T &item)
+    {
+        uint8_t tail = _tail; // Only the consumer writes _tail
+        uint8_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+        if (head == tail)
+            return false;
+        item = _items[tail & (Capacity - 1)];
+        __atomic_store_n(&_tail, (uint8_t)(tail + 1), __ATOMIC_RELEASE); // Release the slot
+        return true;
+    }
+
+    /// @brief Get the number of items in the queue
+    /// @return The number of items. Exact from the consumer, a snapshot from anywhere else
+    uint8_t available(void)
+    {
+        return (uint8_t)(__atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE));
+    }
+
+    /// @brief Get the number of items dropped because the queue was full
+    /// @return The number of dropped items
+    uint16_t getOverflowCount(void)
+    {
+        return _overflows;
+    }
+
+private:
+    T _items[Capacity]; // The ring buffer
+    volatile uint8_t _head; // The next slot to write. Free-running, written by the producer
+    volatile uint8_t _tail; // The next slot to read. Free-running, written by the consumer
+    volatile uint16_t _overflows; // Written by the producer
+};
@@ -0,0 +1,269 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_Snapshot.h
+
+    Description:
+    The warm-start snapshot format - see SfeSTP3593LFDriver::getSnapshot.
+
+    The snapshot is a compact, portable byte string: little-endian, with every
+    floating-point value stored as a 32-bit IEEE float, so it can be written by
+    one board and restored by another. It holds the learned loop state only -
+    not the calibration table, which is plain data the application already owns.
+
+    Header  : "STPW", version (1), length (2) - of the whole snapshot
+    Sections: tag (1), length (1), payload
+      'W' word      : frequencyControl (4)
+      'F' fixed     : maxChangeLSBs (4), integralQ16 (8), flags (1), queuePkQ16 (4), queueIkQ16 (4),
+                      referenceLinearQ16 (8), referenceFlags (1)
+      'D' discipline: maxFrequencyChangePPB (f), integralQ16 (8), flags (1) - integrator seeded,
+                      temperature compensation, temperature channel in use - state (1),
+                      warmupEpochs (4), lockEpochs (4), lockThreshold (f), acquisitionThreshold (f),
+                      biasMean (f), biasVariance (f), Pk[5] (f), Ik[5] (f),
+                      temperatureReference (f), temperatureTheta[2] (f)
+      'S' statistics: freqControlResolution (f), temperatureLambda (f), temperatureModelOrigin (f),
+                      temperatureCovariance[4] (f), flags (1), resolutionLambda (f),
+                      resolutionOriginWord (4), resolutionSamples (4), resolutionTheta[2] (f),
+                      resolutionCovariance[4] (f), resolutionResidualVariance (f),
+                      pullRangeLambda (f), pullRangeOriginWord (4), pullRangeHours (4),
+                      pullRangeTheta[2] (f), pullRangeCovariance[4] (f), pullRangeResidualVariance (f),
+                      pullRangeWarningDays (f), pullRangeFlags (1)
+    Trailer : CRC-16/CCITT-FALSE (2) of everything before it
+
+    A section is only written when its feature is compiled in. Restore skips any
+    section it does not know, or whose feature is compiled out - so a snapshot
+    from a full build restores the integer loop of a fixed-point build. Sections
+    may grow at the end of their payload without a version change: a reader
+    uses the fields it knows and skips the rest. A full build writes 255 bytes,
+    which leaves 65 bytes of kSfeSTP3593LFSnapshotMaxSize for growth - a change
+    which needs more than that is a new version.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+const uint8_t kSfeSTP3593LFSnapshotVersion = 1;
+const size_t kSfeSTP3593LFSnapshotMaxSize = 320; // Every section, with room for the sections to grow
+
+// Section tags
+const uint8_t kSfeSTP3593LFSnapshotWord = 'W';
+const uint8_t kSfeSTP3593LFSnapshotFixed = 'F';
+const uint8_t kSfeSTP3593LFSnapshotDiscipline = 'D';
+const uint8_t kSfeSTP3593LFSnapshotStatistics = 'S';
+
+// The version 1 payload length of each section. A section may be longer - never shorter
+const uint8_t kSfeSTP3593LFSnapshotWordLength = 4;
+const uint8_t kSfeSTP3593LFSnapshotFixedLength = 30;
+const uint8_t kSfeSTP3593LFSnapshotDisciplineLength = 90;
+const uint8_t kSfeSTP3593LFSnapshotStatisticsLength = 114;
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Packs little-endian values into a caller-provided buffer. Overflow is sticky: check ok() at the end
+class SfeSTP3593LFSnapshotWriter
+{
+public:
+    SfeSTP3593LFSnapshotWriter(uint8_t *buffer, size_t size) : _buffer{buffer}, _size{size}, _length{0}, _sectionStart{0}, _ok{buffer != nullptr}
+    {
+    }
+
+    void putU8(uint8_t value)
+    {
+        if ((!_ok) || (_length >= _size))
+        {
+            _ok = false;
+            return;
+        }
+        _buffer[_length++] = value;
+    }
+
+    void putU16(uint16_t value)
+    {
+        putU8((uint8_t)(value & 0xFF));
+        putU8((uint8_t)(value >> 8));
+    }
+
+    void putU32(uint32_t value)
+    {
+        putU16((uint16_t)(value & 0xFFFF));
+        putU16((uint16_t)(value >> 16));
+    }
+
+    void putI64(int64_t value)
+    {
+        putU32((uint32_t)((uint64_t)value & 0xFFFFFFFF));
+        putU32((uint32_t)((uint64_t)value >> 32));
+    }
+
+    void putFloat(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, 4);
+        putU32(bits);
+    }
+
+    /// @brief Start a section. Its length is filled in by endSection
+    void beginSection(uint8_t tag)
+    {
+        putU8(tag);
+        _sectionStart = _length;
+        putU8(0);
+    }
+
+    void endSection(void)
+    {
+        size_t payload = _length - _sectionStart - 1;
+        if ((!_ok) || (payload > 0xFF))
+        {
+            _ok = false;
+            return;
+        }
+        _buffer[_sectionStart] = (uint8_t)payload;
+    }
+
+    /// @brief Write a value at an earlier position - for the header length
+    void patchU16(size_t position, uint16_t value)
+    {
+        if ((!_ok) || ((position + 2) > _length))
+            return;
+        _buffer[position] = (uint8_t)(value & 0xFF);
+        _buffer[position + 1] = (uint8_t)(value >> 8);
+    }
+
+    size_t length(void)
+    {
+        return _length;
+    }
+
+    bool ok(void)
+    {
+        return _ok;
+    }
+
+private:
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _length;
+    size_t _sectionStart;
+    bool _ok;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+// Unpacks little-endian values. Reading past the end is sticky: check ok() at the end
+class SfeSTP3593LFSnapshotReader
+{
+public:
+    SfeSTP3593LFSnapshotReader(const uint8_t *buffer, size_t length) : _buffer{buffer}, _length{length}, _position{0}, _ok{buffer != nullptr}
+    {
+    }
+
+    uint8_t getU8(void)
+    {
+        if ((!_ok) || (_position >= _length))
+        {
+            _ok = false;
+            return 0;
+        }
+        return _buffer[_position++];
+    }
+
+    uint16_t getU16(void)
+    {
+        uint16_t value = getU8();
+        return value | (((uint16_t)getU8()) << 8);
+    }
+
+    uint32_t getU32(void)
+    {
+        uint32_t value = getU16();
+        return value | (((uint32_t)getU16()) << 16);
+    }
+
+    int64_t getI64(void)
+    {
+        uint64_t value = getU32();
+        return (int64_t)(value | (((uint64_t)getU32()) << 32));
+    }
+
+    float getFloat(void)
+    {
+        uint32_t bits = getU32();
+        float value;
+        memcpy(&value, &bits, 4);
+        return value;
+    }
+
+    /// @brief Move to a position - e.g. the end of a section
+    void seek(size_t position)
+    {
+        if (position > _length)
+            _ok = false;
+        else
+            _position = position;
+    }
+
+    size_t position(void)
+    {
+        return _position;
+    }
+
+    bool ok(void)
+    {
+        return _ok;
+    }
+
+private:
+    const uint8_t *_buffer;
+    size_t _length;
+    size_t _position;
+    bool _ok;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+/// @brief CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+/// @param data the bytes
+/// @param length the number of bytes
+/// @return The CRC
+inline uint16_t sfeSTP3593LFSnapshotCRC(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= ((uint16_t)data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+/// @brief The version 1 payload length of a section
+/// @param tag the section tag
+/// @return The length. 0 for an unknown tag: any length is accepted, and the section is skipped
+inline uint8_t sfeSTP3593LFSnapshotSectionLength(uint8_t tag)
+{
+    switch (tag)
+    {
+    case kSfeSTP3593LFSnapshotWord:
+        return kSfeSTP3593LFSnapshotWordLength;
+    case kSfeSTP3593LFSnapshotFixed:
+        return kSfeSTP3593LFSnapshotFixedLength;
+    case kSfeSTP3593LFSnapshotDiscipline:
+        return kSfeSTP3593LFSnapshotDisciplineLength;
+    case kSfeSTP3593LFSnapshotStatistics:
+        return kSfeSTP3593LFSnapshotStatisticsLength;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,329 @@
+/*
+    SparkFun STP3593LF OCXO Arduino Library
+
+    Repository
+    https://github.com/sparkfun/SparkFun_STP3593LF_OCXO_Arduino_Library
+
+    SPDX-License-Identifier: MIT
+
+    Copyright (c) 2024 SparkFun Electronics
+
+    Name: SparkFun_STP3593LF_ThreadSafe.h
+
+    Description:
+    A thread-safe variant of the STP3593LF driver - for dual-core and RTOS targets
+    where more than one task uses the oscillator.
+
+    SfeSTP3593LFThreadSafe<Driver, Lock> owns a driver (SfeSTP3593LFArdI2C, or
+    SfeSTP3593LFMock for testing) and serializes every call - and so every bus
+    transaction and every change to the loop state - with the Lock policy:
+
+      SfeSTP3593LFNoLock    : no locking. Single-threaded builds pay nothing
+      SfeSTP3593LFStdLock   : std::mutex. Host builds and ESP32
+      SfeSTP3593LFRTOSLock  : FreeRTOS mutex (priority inheritance). ESP32, or any
+                              FreeRTOS build which includes FreeRTOS.h first
+
+    getFrequencyControlWord does not take the lock: the word is published
+    (atomically) each time a locked call returns, so a high-priority task can
+    read it without waiting for a bus transaction in progress.
+
+    Calls which are not wrapped below can be made through access():
+      myOCXO.access([](SfeSTP3593LFArdI2C &ocxo) { return ocxo.setLockEpochs(30); });
+    The function runs with the lock held. It must use the driver it is passed -
+    calling back into the wrapper would deadlock.
+
+    None of these calls are ISR-safe - except queueTICCount and queuePhasePicoseconds,
+    which only touch the wait-free sample queue and do not take the lock.
+
+*/
+
+#pragma once
+
+#include "SparkFun_STP3593LF.h"
+
+#if defined(ARDUINO_ARCH_ESP32) || (!defined(ARDUINO))
+#include <mutex>
+#define SFE_STP3593LF_HAVE_STD_LOCK 1
+#endif
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#define SFE_STP3593LF_HAVE_RTOS_LOCK 1
+#elif defined(INC_FREERTOS_H)
+#include <semphr.h>
+#define SFE_STP3593LF_HAVE_RTOS_LOCK 1
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// Lock Policies
+///////////////////////////////////////////////////////////////////////////////
+
+class SfeSTP3593LFNoLock
+{
+public:
+    void lock(void)
+    {
+    }
+
+    void unlock(void)
+    {
+    }
+};
+
+#if SFE_STP3593LF_HAVE_STD_LOCK
+class SfeSTP3593LFStdLock
+{
+public:
+    void lock(void)
+    {
+        _mutex.lock();
+    }
+
+    void unlock(void)
+    {
+        _mutex.unlock();
+    }
+
+private:
+    std::mutex _mutex;
+};
+#endif
+
+#if SFE_STP3593LF_HAVE_RTOS_LOCK
+class SfeSTP3593LFRTOSLock
+{
+public:
+    SfeSTP3593LFRTOSLock()
+    {
+        _mutex = xSemaphoreCreateMutexStatic(&_mutexBuffer); // Static: safe in a global constructor
+    }
+
+    void lock(void)
+    {
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+    }
+
+    void unlock(void)
+    {
+        xSemaphoreGive(_mutex);
+    }
+
+private:
+    StaticSemaphore_t _mutexBuffer;
+    SemaphoreHandle_t _mutex;
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+
+template <class Driver, class Lock = SfeSTP3593LFNoLock>
+class SfeSTP3593LFThreadSafe
+{
+public:
+    SfeSTP3593LFThreadSafe() : _published{0}
+    {
+    }
+
+    /// @brief Begin the driver - with the lock held. Takes the same arguments as Driver::begin
+    /// @return true if successful
+    template <typename... Args>
+    bool begin(Args &&...args)
+    {
+        Guard guard(*this);
+        return _driver.begin(args...);
+    }
+
+    /// @brief Get the 20-bit frequency control word - lock-free
+    /// @return The word published by the most recent call to return
+    uint32_t getFrequencyControlWord(void)
+    {
+#if defined(__AVR__)
+        uint8_t sreg = SREG; // AVR has no 32-bit atomic load. AVR builds have no threads, but may have interrupts
+        cli();
+        uint32_t word = _published;
+        SREG = sreg;
+        return word;
+#else
+        return __atomic_load_n(&_published, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    /// @brief Read the frequency control register - with the lock held
+    /// @return true if the read is successful
+    bool readFrequencyControlWord(void)
+    {
+        Guard guard(*this);
+        return _driver.readFrequencyControlWord();
+    }
+
+    /// @brief Set the frequency control word - with the lock held
+    /// @param freq the frequency control word
+    /// @return true if the write is successful
+    bool setFrequencyControlWord(uint32_t freq)
+    {
+        Guard guard(*this);
+        return _driver.setFrequencyControlWord(freq);
+    }
+
+    /// @brief Add a signed step to the frequency control word - read, modify and write with the lock held
+    /// @param delta the step in LSBs
+    /// @return true if the write is successful
+    bool adjustFrequencyControlWord(int32_t delta)
+    {
+        Guard guard(*this);
+        return _driver.adjustFrequencyControlWord(delta);
+    }
+
+    /// @brief Save the frequency control value - with the lock held
+    /// @return true if the write is successful
+    bool saveFrequencyControlValue(void)
+    {
+        Guard guard(*this);
+        return _driver.saveFrequencyControlValue();
+    }
+
+#if SFE_STP3593LF_ENABLE_DITHER
+    /// @brief Write the control word for the current dither slot - with the lock held
+    /// @return true if successful
+    bool serviceDither(void)
+    {
+        Guard guard(*this);
+        return _driver.serviceDither();
+    }
+#endif
+
+#if SFE_STP3593LF_FLOATING_POINT_LOOP
+    /// @brief Set the frequency according to the GNSS receiver clock bias - with the lock held
+    /// @return true if the write is successful
+    bool setFrequencyByBiasMillis(double bias, double Pk = kSfeSTP3593LFDefaultPk, double Ik = kSfeSTP3593LFDefaultIk)
+    {
+        Guard guard(*this);
+        return _driver.setFrequencyByBiasMillis(bias, Pk, Ik);
+    }
+
+    /// @brief Run one epoch of the discipline state machine - with the lock held
+    /// @return true if successful
+    bool updateDiscipline(double bias, bool biasValid = true)
+    {
+        Guard guard(*this);
+        return _driver.updateDiscipline(bias, biasValid);
+    }
+
+    /// @brief Set the frequency according to a timestamped clock bias - with the lock held
+    /// @return true if the write is successful
+    bool setFrequencyByTimedBiasMillis(uint32_t timestampMicros, double bias, double Pk = kSfeSTP3593LFDefaultPk, double Ik = kSfeSTP3593LFDefaultIk)
+    {
+        Guard guard(*this);
+        return _driver.setFrequencyByTimedBiasMillis(timestampMicros, bias, Pk, Ik);
+    }
+
+    /// @brief Run one step of the discipline state machine with a timestamped bias - with the lock held
+    /// @return true if successful
+    bool updateDisciplineTimed(uint32_t timestampMicros, double bias, bool biasValid = true)
+    {
+        Guard guard(*this);
+        return _driver.updateDisciplineTimed(timestampMicros, bias, biasValid);
+    }
+#endif
+
+#if SFE_STP3593LF_ENABLE_PI_LOOP
+    /// @brief Set the frequency according to the PPS-to-oscillator phase - with the lock held
+    /// @return true if the write is successful
+    bool setFrequencyByPhasePicoseconds(int32_t phase, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16)
+    {
+        Guard guard(*this);
+        return _driver.setFrequencyByPhasePicoseconds(phase, PkQ16, IkQ16);
+    }
+
+    /// @brief Set the frequency according to a timestamped phase - with the lock held
+    /// @return true if the write is successful
+    bool setFrequencyByTimedPhasePicoseconds(uint32_t timestampMicros, int32_t phase, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16)
+    {
+        Guard guard(*this);
+        return _driver.setFrequencyByTimedPhasePicoseconds(timestampMicros, phase, PkQ16, IkQ16);
+    }
+
+    /// @brief Set the frequency according to a raw TIC capture count - with the lock held
+    /// @return true if the write is successful
+    bool setFrequencyByTICCount(uint32_t captureCount, int32_t PkQ16 = kSfeSTP3593LFDefaultPkQ16, int32_t IkQ16 = kSfeSTP3593LFDefaultIkQ16)
+    {
+        Guard guard(*this);
+        return _driver.setFrequencyByTICCount(captureCount, PkQ16, IkQ16);
+    }
+
+    /// @brief Queue a raw TIC capture count - lock-free, wait-free and ISR-safe. One producer only
+    /// @return true if the sample was queued
+    bool queueTICCount(uint32_t captureCount, int32_t sawtoothPicoseconds = 0)
+    {
+        return _driver.queueTICCount(captureCount, sawtoothPicoseconds);
+    }
+
+    /// @brief Queue the PPS-to-oscillator phase - lock-free, wait-free and ISR-safe. One producer only
+    /// @return true if the sample was queued
+    bool queuePhasePicoseconds(int32_t phase, int32_t sawtoothPicoseconds = 0)
+    {
+        return _driver.queuePhasePicoseconds(phase, sawtoothPicoseconds);
+    }
+
+    /// @brief Apply every queued sample - with the lock held
+    /// @return The number of samples applied
+    uint8_t serviceDiscipline(void)
+    {
+        Guard guard(*this);
+        return _driver.serviceDiscipline();
+    }
+#endif
+
+    /// @brief Call any driver method with the lock held
+    /// @param function called with the driver: function(Driver &)
+    /// @return Whatever function returns
+    template <typename Function>
+    auto access(Function function) -> decltype(function(*(Driver *)nullptr))
+    {
+        Guard guard(*this);
+        return function(_driver);
+    }
+
+private:
+    /// @brief Holds the lock for its lifetime. Publishes the control word before releasing it
+    class Guard
+    {
+    public:
+        Guard(SfeSTP3593LFThreadSafe &owner) : _owner(owner)
+        {
+            _owner._lock.lock();
+        }
+
+        ~Guard()
+        {
+            _owner.publish();
+            _owner._lock.unlock();
+        }
+
+    private:
+        SfeSTP3593LFThreadSafe &_owner;
+    };
+
+    /// @brief Publish the driver's control word for the lock-free getFrequencyControlWord
+    /// Publishes the driver's copy - no bus I/O under the lock. Until the driver has a
+    /// valid word (a failed or deferred read) the previously published word is kept
+    void publish(void)
+    {
+        uint32_t word;
+        if (!_driver.getCachedFrequencyControlWord(word))
+            return;
+#if defined(__AVR__)
+        uint8_t sreg = SREG;
+        cli();
+        _published = word;
+        SREG = sreg;
+#else
+        __atomic_store_n(&_published, word, __ATOMIC_RELEASE);
+#endif
+    }
+
+    Driver _driver; // The driver. Only touched with the lock held
+    Lock _lock; // The lock policy
+    volatile uint32_t _published; // The control word, published for lock-free reads
+};